@@ -31,6 +31,24 @@ else()
   message(FATAL_ERROR "${PICO_RUNTIME_SYSTEM} is not a supported runtime system.")
 endif()
 
+# optional compression libraries
+find_package(ZLIB)
+if (ZLIB_FOUND)
+  message(STATUS "gzip support enabled.")
+  add_definitions(-DPICO_HAVE_ZLIB)
+  include_directories(${ZLIB_INCLUDE_DIRS})
+  list(APPEND PICO_RUNTIME_LIB ${ZLIB_LIBRARIES})
+endif()
+
+find_path(ZSTD_INCLUDE_DIR zstd.h)
+find_library(ZSTD_LIBRARY zstd)
+if (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+  message(STATUS "zstd support enabled.")
+  add_definitions(-DPICO_HAVE_ZSTD)
+  include_directories(${ZSTD_INCLUDE_DIR})
+  list(APPEND PICO_RUNTIME_LIB ${ZSTD_LIBRARY})
+endif()
+
 if (PICO_ENABLE_UNIT_TEST)
   include_directories(tests/include)
 endif()
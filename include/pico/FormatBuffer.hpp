@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FORMATBUFFER_HPP_
+#define FORMATBUFFER_HPP_
+
+#include <unistd.h>
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "pico/ff_implementation/ff_config.hpp"
+
+namespace pico {
+
+/**
+ * \ingroup op-api
+ *
+ * A growable character buffer for formatting collection items.
+ *
+ * Output operators (e.g., WriteToDisk) format items directly into their
+ * output buffer, that is passed to user formatting kernels:
+ *
+ *   [](KV &kv, FormatBuffer &out) { out << kv.Key() << ',' << kv.Value(); }
+ *
+ * Arithmetic values are formatted by std::to_chars, with no allocation nor
+ * locale handling, and print as by a default-configured std::ostream.
+ * Strings and characters are copied verbatim.
+ * Any other type with an std::ostream output operator can be formatted by
+ * pico::format(), through the (slower) ostream() adapter.
+ */
+class FormatBuffer {
+ public:
+  FormatBuffer(size_t capacity_ = 4096)
+      : buf(allocate(capacity_)), capacity(capacity_) {}
+
+  FormatBuffer(FormatBuffer &&other) { *this = std::move(other); }
+
+  FormatBuffer &operator=(FormatBuffer &&other) {
+    swap(other);
+    return *this;
+  }
+
+  FormatBuffer(const FormatBuffer &) = delete;
+  FormatBuffer &operator=(const FormatBuffer &) = delete;
+
+  ~FormatBuffer() {
+    if (os_adapter) delete os_adapter;
+    if (buf) FREE(buf);
+  }
+
+  /* exchanges the contents of two buffers, with no copy */
+  void swap(FormatBuffer &other) {
+    std::swap(buf, other.buf);
+    std::swap(used, other.used);
+    std::swap(capacity, other.capacity);
+    std::swap(os_adapter, other.os_adapter);
+    if (os_adapter) os_adapter->rebind(this);
+    if (other.os_adapter) other.os_adapter->rebind(&other);
+  }
+
+  inline const char *data() const { return buf; }
+  inline size_t size() const { return used; }
+  inline bool empty() const { return used == 0; }
+  inline void clear() { used = 0; }
+
+  /*
+   * Returns a pointer to at least n writable bytes at the end of the buffer,
+   * to be committed by commit().
+   */
+  inline char *reserve(size_t n) {
+    if (used + n > capacity) grow(used + n);
+    return buf + used;
+  }
+
+  inline void commit(size_t n) {
+    assert(used + n <= capacity);
+    used += n;
+  }
+
+  inline void append(const char *data, size_t size) {
+    memcpy(reserve(size), data, size);
+    used += size;
+  }
+
+  inline void put(char c) {
+    if (used == capacity) grow(used + 1);
+    buf[used++] = c;
+  }
+
+  /*
+   * strings and characters
+   */
+  FormatBuffer &operator<<(char c) {
+    put(c);
+    return *this;
+  }
+
+  FormatBuffer &operator<<(signed char c) { return *this << (char)c; }
+
+  FormatBuffer &operator<<(unsigned char c) { return *this << (char)c; }
+
+  FormatBuffer &operator<<(const char *s) {
+    append(s, strlen(s));
+    return *this;
+  }
+
+  FormatBuffer &operator<<(const std::string &s) {
+    append(s.data(), s.size());
+    return *this;
+  }
+
+  FormatBuffer &operator<<(std::string_view s) {
+    append(s.data(), s.size());
+    return *this;
+  }
+
+  FormatBuffer &operator<<(bool b) {
+    put(b ? '1' : '0');
+    return *this;
+  }
+
+  /*
+   * numbers
+   */
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, FormatBuffer &>::type
+  operator<<(T x) {
+    /* large enough for any integer and any 6-digit floating point */
+    constexpr size_t max_chars = 64;
+    char *p = reserve(max_chars);
+    std::to_chars_result res;
+    if constexpr (std::is_floating_point<T>::value)
+      /* as std::ostream with default flags (%g with 6 digits) */
+      res = std::to_chars(p, p + max_chars, x, std::chars_format::general,
+                          default_precision);
+    else
+      res = std::to_chars(p, p + max_chars, x);
+    assert(res.ec == std::errc());
+    used += res.ptr - p;
+    return *this;
+  }
+
+  /*
+   * An std::ostream writing into the buffer, for types lacking a native
+   * formatter.
+   */
+  std::ostream &ostream() {
+    if (!os_adapter) os_adapter = new ostream_adapter(this);
+    return os_adapter->os;
+  }
+
+ private:
+  /* the default precision of std::ostream */
+  static constexpr int default_precision = 6;
+
+  char *buf = nullptr;
+  size_t used = 0, capacity = 0;
+
+  class ostream_adapter : public std::streambuf {
+   public:
+    ostream_adapter(FormatBuffer *fb_) : os(this), fb(fb_) {}
+
+    void rebind(FormatBuffer *fb_) { fb = fb_; }
+
+    std::ostream os;
+
+   protected:
+    int_type overflow(int_type c) {
+      if (c != traits_type::eof()) fb->put((char)c);
+      return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) {
+      fb->append(s, n);
+      return n;
+    }
+
+   private:
+    FormatBuffer *fb;
+  };
+
+  ostream_adapter *os_adapter = nullptr;
+
+  /* large buffers are page-aligned, for efficient writing */
+  static char *allocate(size_t size) {
+    size_t page = getpagesize();
+    if (size < page) return (char *)MALLOC(size);
+    char *res;
+    int err = POSIX_MEMALIGN((void **)&res, page, size);
+    assert(!err);
+    (void)err;
+    return res;
+  }
+
+  void grow(size_t min_capacity) {
+    size_t new_capacity = capacity ? capacity : 1;
+    while (new_capacity < min_capacity) new_capacity *= 2;
+    char *tmp = allocate(new_capacity);
+    memcpy(tmp, buf, used);
+    FREE(buf);
+    buf = tmp;
+    capacity = new_capacity;
+  }
+};
+
+/*
+ * detects types with a native FormatBuffer formatter
+ */
+template <typename T, typename = void>
+struct has_formatter : std::false_type {};
+
+template <typename T>
+struct has_formatter<T, decltype(void(std::declval<FormatBuffer &>()
+                                      << std::declval<const T &>()))>
+    : std::true_type {};
+
+/**
+ * \ingroup op-api
+ *
+ * Formats an item into a buffer, by the native formatter if any, otherwise
+ * by operator<< on std::ostream.
+ */
+template <typename T>
+inline void format(FormatBuffer &out, const T &x) {
+  if constexpr (has_formatter<T>::value)
+    out << x;
+  else
+    out.ostream() << x;
+}
+
+} /* namespace pico */
+
+#endif /* FORMATBUFFER_HPP_ */
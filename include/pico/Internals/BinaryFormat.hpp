@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_BINARYFORMAT_HPP_
+#define INTERNALS_BINARYFORMAT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "pico/KeyValue.hpp"
+
+namespace pico {
+
+/*
+ * The PiCo binary file format.
+ *
+ * A binary file consists of a file header followed by a sequence of
+ * self-contained blocks:
+ *
+ *   | file header | block | block | ... | block |
+ *
+ * Each block consists of a block header, an optional key range (minimum and
+ * maximum key of the block records), and the payload:
+ *
+ *   | block header | [min key | max key] | payload | padding |
+ *
+ * Records are stored raw, with no encoding:
+ * - trivially-copyable records are stored as an array of records
+ * - key-value records are stored column-wise: the array of keys, followed by
+ *   the array of values
+ *
+ * Blocks are 8-byte aligned and can be located by only reading block headers,
+ * so that a file can be split at block boundaries among parallel readers.
+ * Key ranges allow skipping whole blocks when filtering by key.
+ */
+
+#define PICO_BINARY_MAGIC "PICOBIN"
+#define PICO_BINARY_VERSION 1
+
+/* default size (in bytes) of the payload of a block */
+#define BINARY_BLOCK_SIZE (1 << 20)
+
+enum binary_kind : uint32_t { BINARY_PLAIN = 1, BINARY_KV = 2 };
+
+struct binary_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t kind;
+  uint32_t key_size;    // 0 for plain records
+  uint32_t value_size;  // record size for plain records
+};
+
+#define BINARY_HAS_RANGE 1u
+
+struct binary_block_header {
+  uint64_t bytes;  // size of the whole block, including this header
+  uint64_t count;  // number of records
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(binary_file_header) % 8 == 0, "unaligned file header");
+static_assert(sizeof(binary_block_header) % 8 == 0, "unaligned block header");
+
+static inline size_t binary_align(size_t n) { return (n + 7) & ~size_t(7); }
+
+/*
+ * detects key types with a strict weak ordering
+ */
+template <typename T, typename = void>
+struct is_less_comparable : std::false_type {};
+
+template <typename T>
+struct is_less_comparable<
+    T, decltype(void(std::declval<const T &>() < std::declval<const T &>()))>
+    : std::true_type {};
+
+/*
+ * A binary_codec<T> describes how T records are laid out within blocks:
+ * - block: accumulates records and serializes them as a block
+ * - read(): builds the i-th record of a block payload at a given location
+ *
+ * Only defined for trivially-copyable types and for key-value types with
+ * trivially-copyable keys and values.
+ */
+template <typename T, typename = void>
+struct binary_codec {
+  static constexpr bool supported = false;
+};
+
+template <typename T>
+struct binary_codec<T, typename std::enable_if<
+                           std::is_trivially_copyable<T>::value>::type> {
+  static constexpr bool supported = true;
+  static constexpr bool ranged = false;
+  static constexpr uint32_t kind = BINARY_PLAIN;
+  static constexpr uint32_t key_size = 0;
+  static constexpr uint32_t value_size = sizeof(T);
+
+  class block {
+   public:
+    inline void add(const T &x) { records.push_back(x); }
+    inline size_t count() const { return records.size(); }
+    inline size_t payload_size() const { return count() * sizeof(T); }
+    inline void clear() { records.clear(); }
+
+    /* serialized size, including the block header */
+    size_t bytes() const {
+      return binary_align(sizeof(binary_block_header) + payload_size());
+    }
+
+    void serialize(char *out) const {
+      auto h = new (out) binary_block_header();
+      h->bytes = bytes();
+      h->count = count();
+      h->flags = 0;
+      out += sizeof(binary_block_header);
+      memcpy(out, records.data(), payload_size());
+      out += payload_size();
+      memset(out, 0, h->bytes - (out - (char *)h));  // padding
+    }
+
+   private:
+    std::vector<T> records;
+  };
+
+  static inline void read(const char *payload, size_t, size_t i, T *dst) {
+    memcpy((void *)dst, payload + i * sizeof(T), sizeof(T));
+  }
+};
+
+template <typename K, typename V>
+struct binary_codec<KeyValue<K, V>,
+                    typename std::enable_if<
+                        std::is_trivially_copyable<K>::value &&
+                        std::is_trivially_copyable<V>::value>::type> {
+  typedef KeyValue<K, V> T;
+  static constexpr bool supported = true;
+  static constexpr bool ranged = is_less_comparable<K>::value;
+  static constexpr uint32_t kind = BINARY_KV;
+  static constexpr uint32_t key_size = sizeof(K);
+  static constexpr uint32_t value_size = sizeof(V);
+
+  class block {
+   public:
+    inline void add(const T &x) {
+      if constexpr (ranged) {
+        if (keys.empty() || x.Key() < min) min = x.Key();
+        if (keys.empty() || max < x.Key()) max = x.Key();
+      }
+      keys.push_back(x.Key());
+      values.push_back(x.Value());
+    }
+
+    inline size_t count() const { return keys.size(); }
+    inline size_t payload_size() const {
+      return count() * (sizeof(K) + sizeof(V));
+    }
+
+    inline void clear() {
+      keys.clear();
+      values.clear();
+    }
+
+    size_t bytes() const {
+      size_t range = ranged ? 2 * sizeof(K) : 0;
+      return binary_align(sizeof(binary_block_header) + range +
+                          payload_size());
+    }
+
+    void serialize(char *out) const {
+      auto h = new (out) binary_block_header();
+      h->bytes = bytes();
+      h->count = count();
+      h->flags = ranged ? BINARY_HAS_RANGE : 0;
+      out += sizeof(binary_block_header);
+      if (ranged) {
+        memcpy(out, &min, sizeof(K));
+        memcpy(out + sizeof(K), &max, sizeof(K));
+        out += 2 * sizeof(K);
+      }
+      memcpy(out, keys.data(), count() * sizeof(K));
+      out += count() * sizeof(K);
+      memcpy(out, values.data(), count() * sizeof(V));
+      out += count() * sizeof(V);
+      memset(out, 0, h->bytes - (out - (char *)h));  // padding
+    }
+
+   private:
+    std::vector<K> keys;
+    std::vector<V> values;
+    K min, max;
+  };
+
+  static inline void read(const char *payload, size_t count, size_t i,
+                          T *dst) {
+    K k;
+    V v;
+    memcpy((void *)&k, payload + i * sizeof(K), sizeof(K));
+    memcpy((void *)&v, payload + count * sizeof(K) + i * sizeof(V),
+           sizeof(V));
+    new (dst) T(std::move(k), std::move(v));
+  }
+
+  /* the key of the i-th record of a block payload */
+  static inline K key(const char *payload, size_t i) {
+    K k;
+    memcpy((void *)&k, payload + i * sizeof(K), sizeof(K));
+    return k;
+  }
+};
+
+/*
+ * Fills a file header for T records.
+ */
+template <typename T>
+static binary_file_header binary_header() {
+  typedef binary_codec<T> codec;
+  binary_file_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, PICO_BINARY_MAGIC, sizeof(PICO_BINARY_MAGIC));
+  h.version = PICO_BINARY_VERSION;
+  h.kind = codec::kind;
+  h.key_size = codec::key_size;
+  h.value_size = codec::value_size;
+  return h;
+}
+
+/*
+ * Checks that a file header matches T records.
+ */
+template <typename T>
+static bool binary_header_matches(const binary_file_header &h) {
+  auto expected = binary_header<T>();
+  return !memcmp(&h, &expected, sizeof(h));
+}
+
+/*
+ * A view on a serialized block.
+ */
+struct binary_block {
+  binary_block(const char *ptr_) : ptr(ptr_) {}
+
+  inline const binary_block_header &header() const {
+    return *reinterpret_cast<const binary_block_header *>(ptr);
+  }
+
+  inline size_t count() const { return header().count; }
+
+  inline bool has_range() const { return header().flags & BINARY_HAS_RANGE; }
+
+  /* the key range, only valid if has_range() */
+  inline const char *range() const {
+    return ptr + sizeof(binary_block_header);
+  }
+
+  inline const char *payload(size_t key_size) const {
+    return range() + (has_range() ? 2 * key_size : 0);
+  }
+
+  const char *ptr;
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_BINARYFORMAT_HPP_ */
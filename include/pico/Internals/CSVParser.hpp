@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_CSVPARSER_HPP_
+#define INTERNALS_CSVPARSER_HPP_
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pico {
+
+/*
+ * Format of a delimited text file.
+ */
+struct csv_format {
+  char delimiter = ',';
+  bool header = false;           // skip the first line
+  std::vector<unsigned> columns;  // the columns to be parsed, empty for all
+};
+
+/*
+ * Finds the first delimiter, quote or newline in [p, end), or end.
+ * With SSE2, 16 bytes are checked at once against the three characters.
+ */
+static inline const char *csv_find(const char *p, const char *end,
+                                   char delim) {
+#ifdef __SSE2__
+  const __m128i d = _mm_set1_epi8(delim);
+  const __m128i q = _mm_set1_epi8('"');
+  const __m128i n = _mm_set1_epi8('\n');
+  for (; p + 16 <= end; p += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, d), _mm_cmpeq_epi8(x, q));
+    int mask = _mm_movemask_epi8(_mm_or_si128(m, _mm_cmpeq_epi8(x, n)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for (; p < end; ++p)
+    if (*p == delim || *p == '"' || *p == '\n') return p;
+  return end;
+}
+
+/*
+ * Field conversions, with no allocation except for strings.
+ * Return false on malformed fields.
+ */
+template <typename T>
+static inline typename std::enable_if<std::is_arithmetic<T>::value, bool>::type
+csv_convert(const char *p, size_t len, T &x) {
+  const char *end = p + len;
+  if (p < end && *p == '+') ++p;
+  auto res = std::from_chars(p, end, x);
+  return res.ec == std::errc() && res.ptr == end;
+}
+
+static inline bool csv_convert(const char *p, size_t len, bool &x) {
+  if (len == 1 && (*p == '0' || *p == '1')) {
+    x = (*p == '1');
+    return true;
+  }
+  if (len == 4 && !memcmp(p, "true", 4)) {
+    x = true;
+    return true;
+  }
+  if (len == 5 && !memcmp(p, "false", 5)) {
+    x = false;
+    return true;
+  }
+  return false;
+}
+
+static inline bool csv_convert(const char *p, size_t len, char &x) {
+  if (len != 1) return false;
+  x = *p;
+  return true;
+}
+
+static inline bool csv_convert(const char *p, size_t len, std::string &x) {
+  x.assign(p, len);
+  return true;
+}
+
+/*
+ * Parses delimited records into std::tuple<Ts...> objects.
+ *
+ * Fields may be enclosed in double quotes, in which case they may contain
+ * delimiters and escaped quotes (""), but not newlines.
+ * Only the projected columns are converted: the i-th tuple element is parsed
+ * from the columns[i]-th column (by default, the i-th column).
+ */
+template <typename... Ts>
+class csv_parser {
+ public:
+  typedef std::tuple<Ts...> record_t;
+  typedef csv_format format_t;
+
+  csv_parser(const csv_format &format)
+      : delim(format.delimiter),
+        header(format.header),
+        converters(make_converters()) {
+    auto columns = format.columns;
+    if (columns.empty())
+      for (unsigned i = 0; i < sizeof...(Ts); ++i) columns.push_back(i);
+    assert(columns.size() == sizeof...(Ts));
+    for (unsigned i = 0; i < columns.size(); ++i) {
+      if (columns[i] >= target.size()) target.resize(columns[i] + 1, -1);
+      assert(target[columns[i]] == -1);
+      target[columns[i]] = i;
+    }
+  }
+
+  bool skip_header() const { return header; }
+
+  /*
+   * Parses the record starting at p into rec.
+   *
+   * Returns the pointer past the end of the record, or nullptr if the record
+   * is not complete within [p, end) and more data may follow (!at_eof).
+   * The record is valid only if ok is set.
+   */
+  const char *parse(const char *p, const char *end, bool at_eof,
+                    record_t &rec, bool &ok) {
+    unsigned col = 0, parsed = 0;
+    ok = true;
+    while (true) {
+      const char *fbegin, *fend;
+      bool escaped = false;
+      if (p < end && *p == '"') {
+        /* quoted field */
+        const char *q = p + 1;
+        while (true) {
+          q = (const char *)memchr(q, '"', end - q);
+          if (!q || (q + 1 == end && !at_eof)) {
+            if (!at_eof) return nullptr;
+            ok = false;
+            return end;
+          }
+          if (q + 1 < end && q[1] == '"') {
+            escaped = true;
+            q += 2;
+          } else
+            break;
+        }
+        fbegin = p + 1;
+        fend = q;
+        /* skip trailing characters up to the field end */
+        for (p = q + 1; p < end && *p != delim && *p != '\n'; ++p)
+          ;
+      } else {
+        /* unquoted field: quotes are plain characters */
+        const char *s = p;
+        while ((s = csv_find(s, end, delim)) < end && *s == '"') ++s;
+        fbegin = p;
+        fend = p = s;
+        if (fend > fbegin && fend[-1] == '\r' && (p == end || *p == '\n'))
+          --fend;
+      }
+      if (p == end && !at_eof) return nullptr;
+
+      if (col < target.size() && target[col] >= 0) {
+        if (escaped) {
+          unescape(fbegin, fend);
+          fbegin = tmp.data();
+          fend = fbegin + tmp.size();
+        }
+        ok &= converters[target[col]](fbegin, fend - fbegin, rec);
+        ++parsed;
+      }
+      ++col;
+
+      if (p == end) break;
+      if (*p++ == '\n') break;
+    }
+    ok &= (parsed == sizeof...(Ts));
+    return p;
+  }
+
+ private:
+  typedef bool (*convert_f)(const char *, size_t, record_t &);
+
+  char delim;
+  bool header;
+  std::array<convert_f, sizeof...(Ts)> converters;
+  std::vector<int> target;  // column -> tuple element
+  std::string tmp;
+
+  template <size_t I>
+  static bool convert(const char *p, size_t len, record_t &rec) {
+    return csv_convert(p, len, std::get<I>(rec));
+  }
+
+  template <size_t... I>
+  static std::array<convert_f, sizeof...(Ts)> make_converters(
+      std::index_sequence<I...>) {
+    return {{&convert<I>...}};
+  }
+
+  static std::array<convert_f, sizeof...(Ts)> make_converters() {
+    return make_converters(std::index_sequence_for<Ts...>());
+  }
+
+  void unescape(const char *p, const char *end) {
+    tmp.clear();
+    for (; p < end; ++p) {
+      tmp.push_back(*p);
+      if (*p == '"') ++p;  // skip the escaping quote
+    }
+  }
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_CSVPARSER_HPP_ */
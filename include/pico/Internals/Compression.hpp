@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_COMPRESSION_HPP_
+#define INTERNALS_COMPRESSION_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef PICO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef PICO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace pico {
+
+/*
+ * Compressed files.
+ *
+ * Files are written as sequences of independent blocks:
+ * - gzip files are written in the BGZF format, i.e., as a sequence of gzip
+ *   members of at most 64KB, each recording its size in a header field
+ * - zstd files are written as a sequence of independent frames
+ * Either way, the result can be read by standard tools, and can be split at
+ * block boundaries among parallel readers.
+ *
+ * gzip support requires zlib (PICO_HAVE_ZLIB), zstd support requires libzstd
+ * (PICO_HAVE_ZSTD).
+ */
+enum class compression { NONE, GZIP, ZSTD };
+
+/* maximum uncompressed size of a BGZF block */
+#define BGZF_BLOCK_DATA 0xff00
+/* maximum size of a BGZF block */
+#define BGZF_MAX_BLOCK 0x10000
+#define BGZF_HEADER_SIZE 18
+#define BGZF_FOOTER_SIZE 8
+
+/* maximum uncompressed size of a zstd frame */
+#define ZSTD_FRAME_DATA (1 << 20)
+
+/* size of the reads from a compressed file */
+#define COMPRESSED_READ_SIZE (1 << 16)
+
+/* compression format by file name suffix, for writing */
+static inline compression compression_from_name(const std::string &fname) {
+  auto ends_with = [&](const std::string &suffix) {
+    return fname.size() > suffix.size() &&
+           !fname.compare(fname.size() - suffix.size(), suffix.size(), suffix);
+  };
+  if (ends_with(".gz")) return compression::GZIP;
+  if (ends_with(".zst")) return compression::ZSTD;
+  return compression::NONE;
+}
+
+/* compression format by magic number, for reading */
+static inline compression compression_from_file(const std::string &fname) {
+  unsigned char m[4] = {0, 0, 0, 0};
+  int fd = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0) return compression::NONE;  // reported by the reader
+  ssize_t n = pread(fd, m, sizeof(m), 0);
+  ::close(fd);
+  if (n >= 2 && m[0] == 0x1f && m[1] == 0x8b) return compression::GZIP;
+  if (n == 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd)
+    return compression::ZSTD;
+  return compression::NONE;
+}
+
+/* exits if the compression format is not supported by this build */
+static inline void compression_check(compression c) {
+#ifndef PICO_HAVE_ZLIB
+  if (c == compression::GZIP) {
+    fprintf(stderr, "gzip files are not supported (zlib not found)\n");
+    exit(1);
+  }
+#endif
+#ifndef PICO_HAVE_ZSTD
+  if (c == compression::ZSTD) {
+    fprintf(stderr, "zstd files are not supported (libzstd not found)\n");
+    exit(1);
+  }
+#endif
+  (void)c;
+}
+
+/*
+ * Locates the independent blocks of a compressed file.
+ *
+ * Returns the offsets of the blocks, followed by the file size, or an empty
+ * vector if the file cannot be split (e.g., a plain gzip file).
+ * Only block headers are read.
+ */
+static std::vector<off_t> compressed_blocks(int fd, compression c) {
+  std::vector<off_t> res;
+  struct stat st;
+  if (fstat(fd, &st)) return res;
+  off_t fsize = st.st_size, off = 0;
+
+  if (c == compression::GZIP) {
+    /* BGZF: the block size is in the first extra subfield ("BC") */
+    unsigned char h[BGZF_HEADER_SIZE];
+    while (off < fsize) {
+      if (pread(fd, h, BGZF_HEADER_SIZE, off) != BGZF_HEADER_SIZE ||
+          h[0] != 0x1f || h[1] != 0x8b || !(h[3] & 4) || h[12] != 'B' ||
+          h[13] != 'C' || h[14] != 2 || h[15] != 0)
+        return std::vector<off_t>();
+      res.push_back(off);
+      off += (h[16] | (h[17] << 8)) + 1;
+    }
+  }
+
+#ifdef PICO_HAVE_ZSTD
+  if (c == compression::ZSTD && fsize) {
+    auto p = (const char *)mmap(nullptr, fsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return res;
+    while (off < fsize) {
+      size_t n = ZSTD_findFrameCompressedSize(p + off, fsize - off);
+      if (ZSTD_isError(n)) {
+        res.clear();
+        break;
+      }
+      res.push_back(off);
+      off += n;
+    }
+    munmap((void *)p, fsize);
+    if (res.empty()) return res;
+  }
+#endif
+
+  if (!res.empty()) res.push_back(fsize);
+  return res;
+}
+
+/*
+ * Compresses data into independent blocks.
+ */
+class block_compressor {
+ public:
+  block_compressor(compression c_) : c(c_) {
+    compression_check(c);
+#ifdef PICO_HAVE_ZLIB
+    if (c == compression::GZIP) {
+      memset(&zs, 0, sizeof(zs));
+      if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                       Z_DEFAULT_STRATEGY) != Z_OK)
+        error();
+    }
+#endif
+#ifdef PICO_HAVE_ZSTD
+    if (c == compression::ZSTD) cctx = ZSTD_createCCtx();
+#endif
+  }
+
+  ~block_compressor() {
+#ifdef PICO_HAVE_ZLIB
+    if (c == compression::GZIP) deflateEnd(&zs);
+#endif
+#ifdef PICO_HAVE_ZSTD
+    if (c == compression::ZSTD) ZSTD_freeCCtx(cctx);
+#endif
+  }
+
+  block_compressor(const block_compressor &) = delete;
+  block_compressor &operator=(const block_compressor &) = delete;
+
+  /* appends the compressed data to out */
+  void compress(const char *data, size_t size, std::vector<char> &out) {
+    size_t max = (c == compression::GZIP) ? BGZF_BLOCK_DATA : ZSTD_FRAME_DATA;
+    while (size) {
+      size_t n = std::min(size, max);
+      block(data, n, out);
+      data += n;
+      size -= n;
+    }
+  }
+
+  /* appends the end-of-file marker, if any */
+  void finish(std::vector<char> &out) {
+    static const unsigned char bgzf_eof[] = {
+        0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C',
+        2,    0,    27, 0, 3, 0, 0, 0, 0, 0,    0, 0, 0,   0};
+    if (c == compression::GZIP)
+      out.insert(out.end(), bgzf_eof, bgzf_eof + sizeof(bgzf_eof));
+  }
+
+ private:
+  compression c;
+#ifdef PICO_HAVE_ZLIB
+  z_stream zs;
+#endif
+#ifdef PICO_HAVE_ZSTD
+  ZSTD_CCtx *cctx = nullptr;
+#endif
+
+  void block(const char *data, size_t size, std::vector<char> &out) {
+#ifdef PICO_HAVE_ZLIB
+    if (c == compression::GZIP) {
+      static const unsigned char header[BGZF_HEADER_SIZE] = {
+          0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0};
+      size_t base = out.size();
+      out.resize(base + BGZF_MAX_BLOCK);
+      auto h = (unsigned char *)out.data() + base;
+      memcpy(h, header, BGZF_HEADER_SIZE);
+      deflateReset(&zs);
+      zs.next_in = (Bytef *)data;
+      zs.avail_in = size;
+      zs.next_out = h + BGZF_HEADER_SIZE;
+      zs.avail_out = BGZF_MAX_BLOCK - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+      if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        /* incompressible data overflowing the block: split */
+        out.resize(base);
+        assert(size > 1);
+        block(data, size / 2, out);
+        block(data + size / 2, size - size / 2, out);
+        return;
+      }
+      size_t bsize = BGZF_HEADER_SIZE + zs.total_out + BGZF_FOOTER_SIZE;
+      put_le(h + 16, bsize - 1, 2);
+      auto f = h + BGZF_HEADER_SIZE + zs.total_out;
+      put_le(f, crc32(crc32(0, Z_NULL, 0), (const Bytef *)data, size), 4);
+      put_le(f + 4, size, 4);
+      out.resize(base + bsize);
+    }
+#endif
+#ifdef PICO_HAVE_ZSTD
+    if (c == compression::ZSTD) {
+      size_t base = out.size();
+      out.resize(base + ZSTD_compressBound(size));
+      size_t n = ZSTD_compressCCtx(cctx, out.data() + base, out.size() - base,
+                                   data, size, ZSTD_CLEVEL_DEFAULT);
+      if (ZSTD_isError(n)) error();
+      out.resize(base + n);
+    }
+#endif
+    (void)data;
+    (void)size;
+    (void)out;
+  }
+
+  static void put_le(unsigned char *p, unsigned long x, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; ++i) p[i] = (x >> (8 * i)) & 0xff;
+  }
+
+  static void error() {
+    fprintf(stderr, "ERROR compressing output file\n");
+    exit(1);
+  }
+};
+
+/*
+ * Decompresses a range of a compressed file, by read(2)-like calls.
+ * The range must begin at a block boundary (e.g., the beginning of the file),
+ * and may span any number of blocks.
+ */
+class block_decompressor {
+ public:
+  block_decompressor(int fd_, compression c_)
+      : fd(fd_), c(c_), in(COMPRESSED_READ_SIZE) {
+    compression_check(c);
+#ifdef PICO_HAVE_ZLIB
+    if (c == compression::GZIP) {
+      memset(&zs, 0, sizeof(zs));
+      if (inflateInit2(&zs, 15 + 16) != Z_OK) error();  // gzip wrapper
+    }
+#endif
+#ifdef PICO_HAVE_ZSTD
+    if (c == compression::ZSTD) dctx = ZSTD_createDStream();
+#endif
+  }
+
+  ~block_decompressor() {
+#ifdef PICO_HAVE_ZLIB
+    if (c == compression::GZIP) inflateEnd(&zs);
+#endif
+#ifdef PICO_HAVE_ZSTD
+    if (c == compression::ZSTD) ZSTD_freeDStream(dctx);
+#endif
+  }
+
+  block_decompressor(const block_decompressor &) = delete;
+  block_decompressor &operator=(const block_decompressor &) = delete;
+
+  void open(off_t begin, off_t end_) {
+    pos = begin;
+    end = end_;
+    in_begin = in_end = 0;
+#ifdef PICO_HAVE_ZLIB
+    if (c == compression::GZIP) inflateReset(&zs);
+#endif
+#ifdef PICO_HAVE_ZSTD
+    if (c == compression::ZSTD) ZSTD_initDStream(dctx);
+#endif
+  }
+
+  /* moves the end of the range forward */
+  void extend(off_t end_) {
+    assert(end_ >= end);
+    end = end_;
+  }
+
+  /*
+   * Returns the number of decompressed bytes, 0 at the end of the range.
+   * Once the input is over, the decompressor is still run until it flushes
+   * the output it holds (e.g., the tail of a frame larger than out).
+   */
+  ssize_t read(char *out, size_t size) {
+    while (true) {
+      bool drained = false;
+      if (in_begin == in_end) {
+        ssize_t n = pread(fd, in.data(), std::min<off_t>(in.size(), end - pos),
+                          pos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+          perror("ERROR reading input file");
+          exit(1);
+        }
+        drained = !n;
+        pos += n;
+        in_begin = 0;
+        in_end = n;
+      }
+      size_t consumed = in_begin, produced = 0;
+#ifdef PICO_HAVE_ZLIB
+      if (c == compression::GZIP) {
+        zs.next_in = (Bytef *)in.data() + in_begin;
+        zs.avail_in = in_end - in_begin;
+        zs.next_out = (Bytef *)out;
+        zs.avail_out = size;
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) error();
+        if (ret == Z_STREAM_END) inflateReset(&zs);  // next member
+        in_begin = in_end - zs.avail_in;
+        produced = size - zs.avail_out;
+      }
+#endif
+#ifdef PICO_HAVE_ZSTD
+      if (c == compression::ZSTD) {
+        ZSTD_inBuffer ib = {in.data(), in_end, in_begin};
+        ZSTD_outBuffer ob = {out, size, 0};
+        if (ZSTD_isError(ZSTD_decompressStream(dctx, &ob, &ib))) error();
+        in_begin = ib.pos;
+        produced = ob.pos;
+      }
+#endif
+      if (produced) return produced;
+      if (drained) return 0;
+      if (in_begin == consumed) error();  // no progress
+    }
+  }
+
+ private:
+  int fd;
+  compression c;
+  std::vector<char> in;
+  size_t in_begin = 0, in_end = 0;
+  off_t pos = 0, end = 0;
+#ifdef PICO_HAVE_ZLIB
+  z_stream zs;
+#endif
+#ifdef PICO_HAVE_ZSTD
+  ZSTD_DStream *dctx = nullptr;
+#endif
+
+  static void error() {
+    fprintf(stderr, "ERROR decompressing input file\n");
+    exit(1);
+  }
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_COMPRESSION_HPP_ */
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_JSONPARSER_HPP_
+#define INTERNALS_JSONPARSER_HPP_
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pico {
+
+/*
+ * Fields to be extracted from JSON-lines records.
+ * Each path is a dot-separated sequence of object keys (e.g., "user.name").
+ */
+struct json_format {
+  std::vector<std::string> paths;
+};
+
+/*
+ * Finds the first occurrence of any of the characters Cs in [p, end), or end.
+ * With SSE2, 16 bytes are checked at once.
+ */
+template <char... Cs>
+static inline const char *json_find(const char *p, const char *end) {
+#ifdef __SSE2__
+  for (; p + 16 <= end; p += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_setzero_si128();
+    ((m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(Cs)))), ...);
+    int mask = _mm_movemask_epi8(m);
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for (; p < end; ++p)
+    if (((*p == Cs) || ...)) return p;
+  return end;
+}
+
+static inline const char *json_ws(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+  return p;
+}
+
+/* p is past the opening quote; returns the closing quote, or nullptr */
+static inline const char *json_string_end(const char *p, const char *end) {
+  while ((p = json_find<'"', '\\'>(p, end)) < end) {
+    if (*p == '"') return p;
+    p += 2;  // skip the escaped character
+  }
+  return nullptr;
+}
+
+/* returns the pointer past the value starting at p, or nullptr */
+static inline const char *json_skip(const char *p, const char *end) {
+  if (p == end) return nullptr;
+  if (*p == '"') {
+    p = json_string_end(p + 1, end);
+    return p ? p + 1 : nullptr;
+  }
+  if (*p == '{' || *p == '[') {
+    unsigned depth = 0;
+    while ((p = json_find<'"', '{', '}', '[', ']'>(p, end)) < end) {
+      if (*p == '"') {
+        p = json_string_end(p + 1, end);
+        if (!p) return nullptr;
+      } else if (*p == '{' || *p == '[')
+        ++depth;
+      else if (!--depth)
+        return p + 1;
+      ++p;
+    }
+    return nullptr;
+  }
+  /* number or literal */
+  const char *begin = p;
+  p = json_find<',', '}', ']', ' ', '\t', '\r'>(p, end);
+  return p > begin ? p : nullptr;
+}
+
+/*
+ * Unescapes the content of a JSON string into out.
+ */
+static inline bool json_unescape(const char *p, const char *end,
+                                 std::string &out) {
+  out.clear();
+  const char *q;
+  while ((q = (const char *)memchr(p, '\\', end - p))) {
+    out.append(p, q - p);
+    if (++q == end) return false;
+    switch (*q++) {
+      case '"': out.push_back('"'); break;
+      case '\\': out.push_back('\\'); break;
+      case '/': out.push_back('/'); break;
+      case 'b': out.push_back('\b'); break;
+      case 'f': out.push_back('\f'); break;
+      case 'n': out.push_back('\n'); break;
+      case 'r': out.push_back('\r'); break;
+      case 't': out.push_back('\t'); break;
+      case 'u': {
+        unsigned cp = 0;
+        if (end - q < 4 || std::from_chars(q, q + 4, cp, 16).ptr != q + 4)
+          return false;
+        q += 4;
+        /* surrogate pair */
+        if (cp >= 0xD800 && cp < 0xDC00 && end - q >= 6 && q[0] == '\\' &&
+            q[1] == 'u') {
+          unsigned lo = 0;
+          if (std::from_chars(q + 2, q + 6, lo, 16).ptr == q + 6 &&
+              lo >= 0xDC00 && lo < 0xE000) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            q += 6;
+          }
+        }
+        /* encode as UTF-8 */
+        if (cp < 0x80)
+          out.push_back(cp);
+        else if (cp < 0x800) {
+          out.push_back(0xC0 | (cp >> 6));
+          out.push_back(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+          out.push_back(0xE0 | (cp >> 12));
+          out.push_back(0x80 | ((cp >> 6) & 0x3F));
+          out.push_back(0x80 | (cp & 0x3F));
+        } else {
+          out.push_back(0xF0 | (cp >> 18));
+          out.push_back(0x80 | ((cp >> 12) & 0x3F));
+          out.push_back(0x80 | ((cp >> 6) & 0x3F));
+          out.push_back(0x80 | (cp & 0x3F));
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+    p = q;
+  }
+  out.append(p, end - p);
+  return true;
+}
+
+/*
+ * Value conversions. Values are given as raw JSON text.
+ * Return false on type mismatch.
+ */
+template <typename T>
+static inline typename std::enable_if<std::is_arithmetic<T>::value, bool>::type
+json_convert(const char *p, const char *end, T &x) {
+  /* also accept numbers encoded as strings */
+  if (end - p >= 2 && *p == '"') {
+    ++p;
+    --end;
+  }
+  auto res = std::from_chars(p, end, x);
+  return res.ec == std::errc() && res.ptr == end;
+}
+
+static inline bool json_convert(const char *p, const char *end, bool &x) {
+  if (end - p == 4 && !memcmp(p, "true", 4)) {
+    x = true;
+    return true;
+  }
+  if (end - p == 5 && !memcmp(p, "false", 5)) {
+    x = false;
+    return true;
+  }
+  return false;
+}
+
+/* strings are unescaped, other values are returned as raw JSON text */
+static inline bool json_convert(const char *p, const char *end,
+                                std::string &x) {
+  if (*p == '"') return json_unescape(p + 1, end - 1, x);
+  x.assign(p, end - p);
+  return true;
+}
+
+static inline bool json_convert(const char *p, const char *end, char &x) {
+  if (end - p != 3 || *p != '"') return false;
+  x = p[1];
+  return true;
+}
+
+/*
+ * Parses JSON-lines records into std::tuple<Ts...> objects, by extracting the
+ * value at the i-th path into the i-th tuple element.
+ *
+ * Parsing is on-demand: only the requested fields are converted, all other
+ * values are skipped by locating structural characters, and parsing stops as
+ * soon as all the requested fields are found. No document tree is built.
+ * Records lacking any of the requested fields are dropped.
+ */
+template <typename... Ts>
+class json_parser {
+ public:
+  typedef std::tuple<Ts...> record_t;
+  typedef json_format format_t;
+
+  json_parser(const json_format &format) : converters(make_converters()) {
+    assert(format.paths.size() == sizeof...(Ts));
+    for (unsigned i = 0; i < format.paths.size(); ++i)
+      add_path(format.paths[i], i);
+  }
+
+  bool skip_header() const { return false; }
+
+  /*
+   * Parses the line starting at p into rec (see text_range_reader).
+   */
+  const char *parse(const char *p, const char *end, bool at_eof,
+                    record_t &rec, bool &ok) {
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    if (!nl && !at_eof) return nullptr;
+    const char *line_end = nl ? nl : end;
+    unsigned found = 0;
+    const char *q = json_ws(p, line_end);
+    ok = q < line_end && *q == '{' && object(q, line_end, root, rec, found) &&
+         found == sizeof...(Ts);
+    return nl ? nl + 1 : end;
+  }
+
+ private:
+  typedef bool (*convert_f)(const char *, const char *, record_t &);
+
+  struct path_node {
+    std::string key;
+    int target = -1;  // tuple element, if a path ends here
+    std::vector<path_node> children;
+
+    const path_node *child(const char *k, size_t len) const {
+      for (auto &c : children)
+        if (c.key.size() == len && !memcmp(c.key.data(), k, len)) return &c;
+      return nullptr;
+    }
+  };
+
+  std::array<convert_f, sizeof...(Ts)> converters;
+  path_node root;
+
+  void add_path(const std::string &path, int target) {
+    path_node *n = &root;
+    size_t begin = 0;
+    while (true) {
+      size_t dot = path.find('.', begin);
+      auto key = path.substr(begin, dot - begin);
+      auto c = const_cast<path_node *>(n->child(key.data(), key.size()));
+      if (!c) {
+        n->children.emplace_back();
+        c = &n->children.back();
+        c->key = key;
+      }
+      n = c;
+      if (dot == std::string::npos) break;
+      begin = dot + 1;
+    }
+    assert(n->target == -1);
+    n->target = target;
+  }
+
+  /* parses the object starting at p, advancing p past its end */
+  bool object(const char *&p, const char *end, const path_node &node,
+              record_t &rec, unsigned &found) {
+    p = json_ws(p + 1, end);
+    if (p < end && *p == '}') {
+      ++p;
+      return true;
+    }
+    while (p < end && *p == '"') {
+      const char *key = p + 1, *key_end = json_string_end(key, end);
+      if (!key_end) return false;
+      p = json_ws(key_end + 1, end);
+      if (p == end || *p != ':') return false;
+      p = json_ws(p + 1, end);
+
+      const path_node *c = node.child(key, key_end - key);
+      const char *value = p;
+      if (c && !c->children.empty() && p < end && *p == '{') {
+        if (!object(p, end, *c, rec, found)) return false;
+      } else if (!(p = json_skip(p, end)))
+        return false;
+      if (c && c->target >= 0) {
+        if (!converters[c->target](value, p, rec)) return false;
+        ++found;
+      }
+      if (found == sizeof...(Ts)) return true;  // stop as soon as possible
+
+      p = json_ws(p, end);
+      if (p < end && *p == ',') {
+        p = json_ws(p + 1, end);
+        continue;
+      }
+      if (p < end && *p == '}') {
+        ++p;
+        return true;
+      }
+      return false;
+    }
+    return false;
+  }
+
+  template <size_t I>
+  static bool convert(const char *p, const char *end, record_t &rec) {
+    return json_convert(p, end, std::get<I>(rec));
+  }
+
+  template <size_t... I>
+  static std::array<convert_f, sizeof...(Ts)> make_converters(
+      std::index_sequence<I...>) {
+    return {{&convert<I>...}};
+  }
+
+  static std::array<convert_f, sizeof...(Ts)> make_converters() {
+    return make_converters(std::index_sequence_for<Ts...>());
+  }
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_JSONPARSER_HPP_ */
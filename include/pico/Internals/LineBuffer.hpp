@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_LINEBUFFER_HPP_
+#define INTERNALS_LINEBUFFER_HPP_
+
+#include <sys/types.h>
+#include <cassert>
+#include <cstring>
+
+#include "pico/ff_implementation/ff_config.hpp"
+
+namespace pico {
+
+/*
+ * A reusable buffer for splitting a byte stream into delimited records.
+ *
+ * Raw bytes are appended at the tail of the buffer by a user-provided read
+ * function (e.g., read(2) on a file descriptor), then complete records are
+ * located by memchr and returned as views (pointer + length) into the buffer.
+ * Before each read, the unterminated remainder is moved to the head of the
+ * buffer, so records are never copied nor the buffer cleared on the hot path.
+ *
+ * The buffer only grows if a single record does not fit into it.
+ */
+class LineBuffer {
+ public:
+  LineBuffer(size_t capacity_) : capacity(capacity_) {
+    assert(capacity);
+    buf = (char *)MALLOC(capacity);
+  }
+
+  ~LineBuffer() { FREE(buf); }
+
+  LineBuffer(const LineBuffer &) = delete;
+  LineBuffer &operator=(const LineBuffer &) = delete;
+
+  /*
+   * Appends raw bytes by calling read_f(ptr, size), with the same semantics
+   * as read(2). Returns the value returned by read_f.
+   */
+  template <typename ReadF>
+  ssize_t fill(ReadF &&read_f) {
+    compact();
+    if (end == capacity) grow();
+    ssize_t n = read_f(buf + end, capacity - end);
+    if (n > 0) end += n;
+    return n;
+  }
+
+  /*
+   * Extracts the next complete record, if any.
+   * The returned view is valid until the next call to fill().
+   */
+  inline bool next(char delimiter, const char *&rec, size_t &len) {
+    char *p = (char *)memchr(buf + scan, delimiter, end - scan);
+    if (!p) {
+      scan = end;  // do not scan again the partial record
+      return false;
+    }
+    rec = buf + begin;
+    len = p - rec;
+    begin = scan = p - buf + 1;
+    return true;
+  }
+
+  /*
+   * Extracts the unterminated remainder, if any (e.g., at end of stream).
+   */
+  inline bool remainder(const char *&rec, size_t &len) {
+    if (begin == end) return false;
+    rec = buf + begin;
+    len = end - begin;
+    begin = scan = end;
+    return true;
+  }
+
+  /* raw access for block-oriented consumers */
+  inline const char *data() const { return buf + begin; }
+  inline size_t size() const { return end - begin; }
+  inline void consume(size_t n) {
+    assert(n <= size());
+    begin += n;
+    if (scan < begin) scan = begin;
+  }
+
+ private:
+  char *buf;
+  size_t capacity;
+  size_t begin = 0, scan = 0, end = 0;
+
+  void compact() {
+    if (begin) {
+      memmove(buf, buf + begin, end - begin);
+      end -= begin;
+      scan -= begin;
+      begin = 0;
+    }
+  }
+
+  void grow() {
+    char *tmp = (char *)MALLOC(2 * capacity);
+    memcpy(tmp, buf, end);
+    FREE(buf);
+    buf = tmp;
+    capacity *= 2;
+  }
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_LINEBUFFER_HPP_ */
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_LINEFILTER_HPP_
+#define INTERNALS_LINEFILTER_HPP_
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <regex>
+#include <string>
+
+namespace pico {
+
+/*
+ * Finds the first occurrence of a non-empty needle in [p, end), or nullptr.
+ * With SSE2, 16 candidate positions are checked at once against the first
+ * and the last character of the needle, then candidates are verified.
+ */
+static inline const char *line_filter_find(const char *p, const char *end,
+                                           const std::string &needle) {
+  size_t k = needle.size();
+  assert(k);
+  if ((size_t)(end - p) < k) return nullptr;
+#ifdef __SSE2__
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[k - 1]);
+  const char *lim = end - k + 1;  // candidate positions are in [p, lim)
+  for (; p + 16 <= lim; p += 16) {
+    __m128i f = _mm_loadu_si128((const __m128i *)p);
+    __m128i l = _mm_loadu_si128((const __m128i *)(p + k - 1));
+    int mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(f, first), _mm_cmpeq_epi8(l, last)));
+    while (mask) {
+      const char *c = p + __builtin_ctz(mask);
+      if (!memcmp(c, needle.data(), k)) return c;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  return (const char *)memmem(p, end - p, needle.data(), k);
+}
+
+/*
+ * A predicate on text lines, evaluated by file readers on the raw read
+ * buffer, so that only matching lines are built as strings.
+ *
+ * Substring filters search the whole buffer rather than each line: lines
+ * with no occurrence are skipped without being looked at.
+ */
+class line_filter {
+ public:
+  /* matches all the lines */
+  line_filter() {}
+
+  /* matches lines containing a (non-empty, single-line) substring */
+  static line_filter contains(std::string needle) {
+    assert(!needle.empty() && needle.find('\n') == std::string::npos);
+    line_filter res;
+    res.needle = needle;
+    return res;
+  }
+
+  /* matches lines containing a match of a regular expression */
+  static line_filter matches(std::string pattern) {
+    line_filter res;
+    res.re = std::make_shared<std::regex>(pattern, std::regex::optimize);
+    return res;
+  }
+
+  inline bool empty() const { return needle.empty() && !re; }
+
+  inline bool match(const char *p, size_t len) const {
+    if (!needle.empty()) return line_filter_find(p, p + len, needle);
+    if (re) return std::regex_search(p, p + len, *re);
+    return true;
+  }
+
+  /*
+   * Calls f(line, len) on each matching line of a buffer of
+   * newline-terminated lines (except for the last one, possibly).
+   */
+  template <typename F>
+  void for_each(const char *p, size_t size, F &&f) const {
+    const char *end = p + size, *l, *e;
+    if (!needle.empty()) {
+      /* from each occurrence to the enclosing line */
+      while (p < end && (l = line_filter_find(p, end, needle))) {
+        const char *b = (const char *)memrchr(p, '\n', l - p);
+        b = b ? b + 1 : p;
+        e = (const char *)memchr(l, '\n', end - l);
+        if (!e) e = end;
+        f(b, e - b);
+        p = e + 1;
+      }
+      return;
+    }
+    for (l = p; l < end; l = e + 1) {
+      e = (const char *)memchr(l, '\n', end - l);
+      if (!e) e = end;
+      if (!re || std::regex_search(l, e, *re)) f(l, e - l);
+      if (e == end) break;
+    }
+  }
+
+ private:
+  std::string needle;
+  std::shared_ptr<std::regex> re;
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_LINEFILTER_HPP_ */
@@ -21,14 +21,30 @@
 #ifndef INTERNALS_PEGOPTIMIZATION_DEFS_HPP_
 #define INTERNALS_PEGOPTIMIZATION_DEFS_HPP_
 
+#include <vector>
+
+namespace ff {
+class ff_node;  // forward
+}
+
 namespace pico {
 
-class Operator;  // forward
+class Operator;     // forward
+class fused_stage;  // forward
 
-enum PEGOptimization_t { MAP_PREDUCE, FMAP_PREDUCE, PJFMAP_PREDUCE };
+enum PEGOptimization_t {
+  MAP_PREDUCE,
+  FMAP_PREDUCE,
+  PJFMAP_PREDUCE,
+  FUSED_CHAIN,
+  FUSED_PREDUCE,
+  FUSED_SOURCE
+};
 
 union opt_args_t {
   Operator *op;
+  const std::vector<fused_stage *> *stages;
+  ff::ff_node *node;
 };
 
 } /* namespace pico */
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_SEGMENTEDLOG_HPP_
+#define INTERNALS_SEGMENTEDLOG_HPP_
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace pico {
+
+/*
+ * The PiCo segmented log format.
+ *
+ * A log is a directory with one sub-directory per partition, numbered from 0.
+ * Each partition is an append-only sequence of records, identified by their
+ * offset (i.e., their position within the partition), and stored as a series
+ * of segments:
+ *
+ *   <log>/<partition>/<base offset>.log      records
+ *   <log>/<partition>/<base offset>.index    sparse offset index
+ *   <log>/<partition>/<group>.committed      offset committed by a group
+ *
+ * where the base offset is the offset of the first record of the segment.
+ * Records are stored as | length (32 bits) | bytes |.
+ * The index maps some record offsets (one every LOG_INDEX_INTERVAL bytes) to
+ * byte positions within the segment, so that reading can start from any
+ * offset by only scanning a few records.
+ */
+
+/* default maximum size (in bytes) of a segment */
+#define LOG_SEGMENT_SIZE (1 << 26)
+
+/* the distance (in bytes) between consecutive index entries */
+#define LOG_INDEX_INTERVAL (1 << 12)
+
+/* size (in bytes) of the write buffers */
+#define LOG_WRITE_SIZE (1 << 16)
+
+typedef uint64_t log_offset_t;
+
+struct log_index_entry {
+  uint32_t offset;    // relative to the segment base offset
+  uint32_t position;  // byte position within the segment
+};
+
+static inline std::string log_partition_dir(const std::string &log,
+                                            unsigned p) {
+  return log + "/" + std::to_string(p);
+}
+
+static inline std::string log_segment_file(const std::string &dir,
+                                           log_offset_t base,
+                                           const char *ext) {
+  char name[32];
+  snprintf(name, sizeof(name), "%020llu", (unsigned long long)base);
+  return dir + "/" + name + ext;
+}
+
+static inline void log_mkdir(const std::string &path) {
+  if (mkdir(path.c_str(), 0755) && errno != EEXIST) {
+    fprintf(stderr, "Unable to create log directory %s\n", path.c_str());
+    exit(1);
+  }
+}
+
+/* the number of partitions of a log */
+static unsigned log_partitions(const std::string &log) {
+  struct stat st;
+  unsigned n = 0;
+  while (!stat(log_partition_dir(log, n).c_str(), &st) && S_ISDIR(st.st_mode))
+    ++n;
+  return n;
+}
+
+/* the base offsets of the segments of a partition, sorted */
+static std::vector<log_offset_t> log_segments(const std::string &dir) {
+  std::vector<log_offset_t> res;
+  DIR *d = opendir(dir.c_str());
+  if (!d) return res;
+  while (struct dirent *e = readdir(d)) {
+    size_t len = strlen(e->d_name);
+    if (len > 4 && !strcmp(e->d_name + len - 4, ".log"))
+      res.push_back(strtoull(e->d_name, nullptr, 10));
+  }
+  closedir(d);
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+/* the size (in bytes) of the segments of a partition */
+static size_t log_partition_size(const std::string &dir) {
+  size_t res = 0;
+  for (auto base : log_segments(dir)) {
+    struct stat st;
+    if (!stat(log_segment_file(dir, base, ".log").c_str(), &st))
+      res += st.st_size;
+  }
+  return res;
+}
+
+static std::vector<log_index_entry> log_load_index(const std::string &dir,
+                                                   log_offset_t base) {
+  std::vector<log_index_entry> res;
+  FILE *f = fopen(log_segment_file(dir, base, ".index").c_str(), "rb");
+  if (!f) return res;
+  log_index_entry e;
+  while (fread(&e, sizeof(e), 1, f) == 1) res.push_back(e);
+  fclose(f);
+  return res;
+}
+
+/*
+ * Committed offsets: the offset a group of readers would resume from.
+ * Offsets are written to a temporary file then renamed, so that a committed
+ * offset is never found half-written.
+ */
+static bool log_load_committed(const std::string &log, unsigned p,
+                               const std::string &group, log_offset_t &off) {
+  std::string path = log_partition_dir(log, p) + "/" + group + ".committed";
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  unsigned long long o;
+  bool res = (fscanf(f, "%llu", &o) == 1);
+  fclose(f);
+  if (res) off = o;
+  return res;
+}
+
+static void log_store_committed(const std::string &log, unsigned p,
+                                const std::string &group, log_offset_t off) {
+  std::string path = log_partition_dir(log, p) + "/" + group + ".committed";
+  std::string tmp = path + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "w");
+  if (!f) {
+    perror("ERROR committing log offset");
+    exit(1);
+  }
+  fprintf(f, "%llu\n", (unsigned long long)off);
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  if (rename(tmp.c_str(), path.c_str())) {
+    perror("ERROR committing log offset");
+    exit(1);
+  }
+}
+
+/*
+ * Appends records to a partition.
+ *
+ * Opening an existing partition recovers its last segment: a trailing
+ * incomplete record (e.g., from a crashed writer) is truncated away, as well
+ * as index entries beyond the end of the records.
+ * A closed writer may be opened again, to append after the current end.
+ */
+class log_partition_writer {
+ public:
+  log_partition_writer(std::string log, unsigned p, size_t segment_size_)
+      : dir(log_partition_dir(log, p)), segment_size(segment_size_) {
+    assert(segment_size <= UINT32_MAX);
+    log_mkdir(dir);
+    open();
+  }
+
+  ~log_partition_writer() { close(); }
+
+  log_partition_writer(const log_partition_writer &) = delete;
+  log_partition_writer &operator=(const log_partition_writer &) = delete;
+
+  void append(const char *data, uint32_t len) {
+    if (size && size + sizeof(len) + len > segment_size) {
+      close();
+      create_segment(next);
+    }
+    if (size - last_indexed >= LOG_INDEX_INTERVAL) {
+      index_buf.push_back({(uint32_t)(next - base), (uint32_t)size});
+      last_indexed = size;
+    }
+    buf.insert(buf.end(), (const char *)&len, (const char *)&len + sizeof(len));
+    buf.insert(buf.end(), data, data + len);
+    size += sizeof(len) + len;
+    ++next;
+    if (buf.size() >= LOG_WRITE_SIZE) flush();
+  }
+
+  /* opens the partition for appending, unless already open */
+  void open() {
+    if (log_fd >= 0) return;
+    auto segments = log_segments(dir);
+    if (segments.empty())
+      create_segment(0);
+    else
+      recover_segment(segments.back());
+  }
+
+  /* the offset of the next appended record */
+  log_offset_t next_offset() const { return next; }
+
+  void flush() {
+    write_all(log_fd, buf.data(), buf.size());
+    write_all(index_fd, (const char *)index_buf.data(),
+              index_buf.size() * sizeof(log_index_entry));
+    buf.clear();
+    index_buf.clear();
+  }
+
+  void close() {
+    if (log_fd < 0) return;
+    flush();
+    ::close(log_fd);
+    ::close(index_fd);
+    log_fd = index_fd = -1;
+  }
+
+ private:
+  std::string dir;
+  size_t segment_size;
+  int log_fd = -1, index_fd = -1;
+  log_offset_t base = 0, next = 0;
+  size_t size = 0;          // size of the segment, including buffered data
+  size_t last_indexed = 0;  // position of the last index entry
+  std::vector<char> buf;
+  std::vector<log_index_entry> index_buf;
+
+  void open_segment(log_offset_t base_, int flags) {
+    base = base_;
+    log_fd = ::open(log_segment_file(dir, base, ".log").c_str(),
+                    O_WRONLY | O_CREAT | flags, 0644);
+    index_fd = ::open(log_segment_file(dir, base, ".index").c_str(),
+                      O_WRONLY | O_CREAT | flags, 0644);
+    if (log_fd < 0 || index_fd < 0) {
+      fprintf(stderr, "Unable to open log segment in %s\n", dir.c_str());
+      exit(1);
+    }
+  }
+
+  void create_segment(log_offset_t base_) {
+    open_segment(base_, O_TRUNC);
+    next = base;
+    size = last_indexed = 0;
+  }
+
+  void recover_segment(log_offset_t base_) {
+    open_segment(base_, 0);
+    struct stat st;
+    fstat(log_fd, &st);
+    size_t fsize = st.st_size;
+
+    /* scan from the last valid index entry */
+    auto index = log_load_index(dir, base_);
+    while (!index.empty() && index.back().position >= fsize) index.pop_back();
+    size = index.empty() ? 0 : index.back().position;
+    next = base + (index.empty() ? 0 : index.back().offset);
+    last_indexed = size;
+    int fd = ::open(log_segment_file(dir, base, ".log").c_str(), O_RDONLY);
+    uint32_t len;
+    while (size + sizeof(len) <= fsize &&
+           pread(fd, &len, sizeof(len), size) == sizeof(len) &&
+           size + sizeof(len) + len <= fsize) {
+      size += sizeof(len) + len;
+      ++next;
+    }
+    ::close(fd);
+
+    if (ftruncate(log_fd, size) ||
+        ftruncate(index_fd, index.size() * sizeof(log_index_entry))) {
+      perror("ERROR recovering log segment");
+      exit(1);
+    }
+    lseek(log_fd, 0, SEEK_END);
+    lseek(index_fd, 0, SEEK_END);
+  }
+
+  void write_all(int fd, const char *data, size_t n) {
+    while (n) {
+      ssize_t w = ::write(fd, data, n);
+      if (w < 0) {
+        if (errno == EINTR) continue;
+        perror("ERROR writing log segment");
+        exit(1);
+      }
+      data += w;
+      n -= w;
+    }
+  }
+};
+
+/*
+ * Reads the records of a partition, from a given offset on.
+ * Segments are memory-mapped, and records are returned as views into the
+ * mapping, valid until the next call to next().
+ */
+class log_partition_reader {
+ public:
+  log_partition_reader(std::string log, unsigned p)
+      : dir(log_partition_dir(log, p)), segments(log_segments(dir)) {}
+
+  ~log_partition_reader() { unmap(); }
+
+  log_partition_reader(const log_partition_reader &) = delete;
+  log_partition_reader &operator=(const log_partition_reader &) = delete;
+
+  /* positions the reader at a given offset */
+  void seek(log_offset_t off) {
+    if (segments.empty()) return;
+    auto it = std::upper_bound(segments.begin(), segments.end(), off);
+    if (it != segments.begin()) --it;
+    map(it - segments.begin());
+
+    /* the last index entry not after the offset */
+    for (auto &e : log_load_index(dir, segments[segment])) {
+      if (segments[segment] + e.offset > off || e.position >= size) break;
+      pos = e.position;
+      cur = segments[segment] + e.offset;
+    }
+
+    const char *rec;
+    uint32_t len;
+    while (cur < off && next(rec, len)) {
+    }
+  }
+
+  /* extracts the next record, if any */
+  bool next(const char *&rec, uint32_t &len) {
+    while (segment < segments.size()) {
+      if (pos + sizeof(len) <= size) {
+        memcpy(&len, ptr + pos, sizeof(len));
+        if (pos + sizeof(len) + len <= size) {
+          rec = ptr + pos + sizeof(len);
+          pos += sizeof(len) + len;
+          ++cur;
+          return true;
+        }
+      }
+      if (segment + 1 == segments.size()) break;
+      map(segment + 1);
+    }
+    return false;
+  }
+
+  /* the offset of the next record */
+  log_offset_t offset() const { return cur; }
+
+ private:
+  std::string dir;
+  std::vector<log_offset_t> segments;
+  size_t segment = 0;
+  char *ptr = nullptr;
+  size_t size = 0, pos = 0;
+  log_offset_t cur = 0;
+
+  void map(size_t s) {
+    unmap();
+    segment = s;
+    cur = segments[s];
+    pos = 0;
+    std::string fname = log_segment_file(dir, cur, ".log");
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+      fprintf(stderr, "Unable to open log segment %s\n", fname.c_str());
+      exit(1);
+    }
+    size = st.st_size;
+    if (size) {
+      ptr = (char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr == MAP_FAILED) {
+        perror("ERROR mapping log segment");
+        exit(1);
+      }
+      madvise(ptr, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  void unmap() {
+    if (ptr) munmap(ptr, size);
+    ptr = nullptr;
+    size = 0;
+  }
+};
+
+} /* namespace pico */
+
+#endif /* INTERNALS_SEGMENTEDLOG_HPP_ */
@@ -25,6 +25,8 @@
 #include <iostream>
 #include <sstream>
 
+#include "pico/FormatBuffer.hpp"
+
 namespace pico {
 
 /**
@@ -99,6 +101,15 @@ class KeyValue {
     return os;
   }
 
+  friend FormatBuffer& operator<<(FormatBuffer& out, const KeyValue& kv) {
+    out << '<';
+    format(out, kv.key);
+    out << ", ";
+    format(out, kv.val);
+    out << '>';
+    return out;
+  }
+
   KeyValue& operator+=(const KeyValue& rhs) {
     val += rhs.val;  // reuse compound assignment
     return *this;    // return the result by value (uses move constructor)
@@ -120,9 +131,9 @@ class KeyValue {
   bool sameKey(const KeyValue& kv) const { return key == kv.key; }
 
   std::string to_string() const {
-    std::stringstream res;
+    FormatBuffer res(64);
     res << *this;
-    return res.str();
+    return std::string(res.data(), res.size());
   }
 
   static KeyValue from_string(std::string s) {
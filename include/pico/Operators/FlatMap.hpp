@@ -30,6 +30,8 @@
 
 #include "pico/ff_implementation/OperatorsFFNodes/FMapBatch.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/FMapPReduceBatch.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/WorkStealingBatch.hpp"
 
 /**
  * This file defines an operator performing a FlatMap, taking in input one
@@ -61,7 +63,7 @@ class FlatMapBase : public UnaryOperator<In, Out> {
    * Creates a new FlatMap operator by defining its kernel function.
    */
   FlatMapBase(std::function<void(In &, FlatMapCollector<Out> &)> flatmapf_,
-              unsigned par = def_par()) {
+              unsigned par = auto_par) {
     flatmapf = flatmapf_;
     this->set_input_degree(1);
     this->set_output_degree(1);
@@ -71,7 +73,9 @@ class FlatMapBase : public UnaryOperator<In, Out> {
   }
 
   FlatMapBase(const FlatMapBase &copy)
-      : UnaryOperator<In, Out>(copy), flatmapf(copy.flatmapf) {}
+      : UnaryOperator<In, Out>(copy),
+        flatmapf(copy.flatmapf),
+        ws(copy.ws) {}
 
   /**
    * Returns the name of the operator, consisting in the name of the class.
@@ -81,8 +85,16 @@ class FlatMapBase : public UnaryOperator<In, Out> {
  protected:
   const OpClass operator_class() { return OpClass::FMAP; }
 
+  bool stealing() const { return ws; }
+
   ff::ff_node *node_operator(int parallelism, StructureType st) {
     // todo assert unique stype
+    if (ws) {
+      auto stage = fused_kernel();
+      auto res = make_WorkStealingBatch(parallelism, fused_stages{stage}, st);
+      delete stage;
+      return res;
+    }
     if (st == StructureType::STREAM) {
       using impl_t = FMapBatchStream<In, Out, Token<In>, Token<Out>>;
       return new impl_t(parallelism, flatmapf);
@@ -92,7 +104,12 @@ class FlatMapBase : public UnaryOperator<In, Out> {
     return new impl_t(parallelism, flatmapf);
   }
 
+  fused_stage *fused_kernel() {
+    return new flatmap_stage<Token<In>, Token<Out>>(flatmapf);
+  }
+
   std::function<void(In &, FlatMapCollector<Out> &)> flatmapf;
+  bool ws = false;
 };
 
 /*
@@ -110,11 +127,22 @@ class FlatMap : public FlatMapBase<In, Out> {
    * Creates a new FlatMap operator by defining its kernel function.
    */
   FlatMap(std::function<void(In &, FlatMapCollector<Out> &)> flatmapf_,
-          unsigned par = def_par())
+          unsigned par = auto_par)
       : FlatMapBase<In, Out>(flatmapf_, par) {}
 
   FlatMap(const FlatMap &copy) : FlatMapBase<In, Out>(copy) {}
 
+  /*
+   * Balances the workers by work stealing: idle workers take micro-batches
+   * queued to busy ones, for kernels with irregular cost per micro-batch.
+   * The order of STREAM collections is preserved.
+   */
+  FlatMap work_stealing() {
+    FlatMap res(*this);
+    res.ws = true;
+    return res;
+  }
+
  protected:
   FlatMap *clone() { return new FlatMap(*this); }
 };
@@ -136,12 +164,19 @@ class FlatMap<In, KeyValue<K, V>> : public FlatMapBase<In, KeyValue<K, V>> {
    */
   FlatMap(
       std::function<void(In &, FlatMapCollector<KeyValue<K, V>> &)> flatmapf_,
-      unsigned par = def_par())
+      unsigned par = auto_par)
       : FlatMapBase<In, KeyValue<K, V>>(flatmapf_, par) {}
 
   FlatMap(const FlatMapBase<In, KeyValue<K, V>> &copy)
       : FlatMapBase<In, KeyValue<K, V>>(copy) {}
 
+  /* balances the workers by work stealing */
+  FlatMap work_stealing() {
+    FlatMap res(*this);
+    res.ws = true;
+    return res;
+  }
+
  protected:
   FlatMap *clone() { return new FlatMap(*this); }
 
@@ -40,7 +40,7 @@ class FoldReduce : public UnaryOperator<In, Out> {
    */
   FoldReduce(std::function<void(const In&, State&)> foldf_,
              std::function<void(const State&, State&)> reducef_,  //
-             unsigned par = def_par()) {
+             unsigned par = auto_par) {
     foldf = foldf_;
     reducef = reducef_;
     this->set_input_degree(1);
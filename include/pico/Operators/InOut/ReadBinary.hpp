@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATORS_INOUT_READBINARY_HPP_
+#define OPERATORS_INOUT_READBINARY_HPP_
+
+#include <cstring>
+#include <string>
+
+#include "pico/Internals/BinaryFormat.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadBinaryFFNode.hpp"
+
+#include "InputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that reads a file written by WriteBinary and produces
+ * an unordered bounded collection (i.e., BAG).
+ *
+ * The file is memory-mapped and split at block boundaries among the workers.
+ * Records are copied from the mapped blocks straight into micro-batches.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+template <typename T>
+class ReadBinary : public InputOperator<T> {
+  static_assert(binary_codec<T>::supported,
+                "ReadBinary requires trivially-copyable records");
+
+ public:
+  /**
+   * \ingroup op-api
+   *
+   * ReadBinary Constructor
+   *
+   * Creates a new ReadBinary operator reading from fname.
+   */
+  ReadBinary(std::string fname_, unsigned par = auto_par)
+      : InputOperator<T>(StructureType::BAG), fname(fname_) {
+    this->pardeg(par);
+  }
+
+  /**
+   * Copy constructor.
+   */
+  ReadBinary(const ReadBinary &copy)
+      : InputOperator<T>(copy), fname(copy.fname), filters(copy.filters) {}
+
+  /*
+   * Only reads the key-value pairs with key in [lo, hi].
+   * Blocks with no key in the range are skipped with no copying.
+   */
+  template <typename U = T>
+  ReadBinary key_range(typename U::keytype lo, typename U::keytype hi) {
+    typedef typename U::keytype K;
+    static_assert(binary_codec<U>::ranged, "key_range requires ordered keys");
+    ReadBinary res(*this);
+    res.filters.block = [lo, hi](const binary_block &b) {
+      if (!b.has_range()) return true;
+      K min, max;
+      memcpy((void *)&min, b.range(), sizeof(K));
+      memcpy((void *)&max, b.range() + sizeof(K), sizeof(K));
+      return !(max < lo || hi < min);
+    };
+    res.filters.record = [lo, hi](const T &kv) {
+      return !(kv.Key() < lo || hi < kv.Key());
+    };
+    return res;
+  }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("ReadBinary");
+    std::ostringstream address;
+    address << (void const *)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "ReadBinary\n[" + fname + "]"; }
+
+ protected:
+  ReadBinary *clone() { return new ReadBinary(*this); }
+
+  ff::ff_node *node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::BAG);
+    return make_ReadBinaryFFNode<T>(parallelism, fname, filters);
+  }
+
+ private:
+  std::string fname;
+  binary_filters<T> filters;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_READBINARY_HPP_ */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATORS_INOUT_READCSV_HPP_
+#define OPERATORS_INOUT_READCSV_HPP_
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "pico/Internals/CSVParser.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadTextRecordsFFNode.hpp"
+
+#include "InputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that reads a delimited text file (e.g., CSV or TSV)
+ * and produces an unordered bounded collection (i.e., BAG) of typed records,
+ * one std::tuple<Ts...> per line.
+ *
+ * Fields are converted with no intermediate strings: numbers by
+ * std::from_chars, characters and booleans (0/1/true/false) directly.
+ * Fields may be quoted, but may not span multiple lines.
+ * Lines that cannot be converted are dropped.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+template <typename... Ts>
+class ReadCSV : public InputOperator<std::tuple<Ts...>> {
+ public:
+  /**
+   * \ingroup op-api
+   *
+   * ReadCSV Constructor
+   *
+   * Creates a new ReadCSV operator, with comma as the field delimiter.
+   */
+  ReadCSV(std::string fname_, unsigned par = auto_par)
+      : InputOperator<std::tuple<Ts...>>(StructureType::BAG), fname(fname_) {
+    this->pardeg(par);
+  }
+
+  /**
+   * Copy constructor.
+   */
+  ReadCSV(const ReadCSV &copy)
+      : InputOperator<std::tuple<Ts...>>(copy),
+        fname(copy.fname),
+        format(copy.format) {}
+
+  /*
+   * Sets the field delimiter (e.g., '\t' for TSV files).
+   */
+  ReadCSV delimiter(char delim) {
+    assert(delim != '"' && delim != '\n');
+    ReadCSV res(*this);
+    res.format.delimiter = delim;
+    return res;
+  }
+
+  /*
+   * Skips the first line of the file.
+   */
+  ReadCSV skip_header() {
+    ReadCSV res(*this);
+    res.format.header = true;
+    return res;
+  }
+
+  /*
+   * Only parses the given columns (counting from 0): the i-th record field
+   * is parsed from the columns[i]-th column.
+   */
+  ReadCSV columns(std::vector<unsigned> columns_) {
+    assert(columns_.size() == sizeof...(Ts));
+    ReadCSV res(*this);
+    res.format.columns = columns_;
+    return res;
+  }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("ReadCSV");
+    std::ostringstream address;
+    address << (void const *)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "ReadCSV\n[" + fname + "]"; }
+
+ protected:
+  ReadCSV *clone() { return new ReadCSV(*this); }
+
+  ff::ff_node *node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::BAG);
+    return make_ReadTextRecordsFFNode<csv_parser<Ts...>>(parallelism, fname,
+                                                         format);
+  }
+
+ private:
+  std::string fname;
+  csv_format format;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_READCSV_HPP_ */
@@ -29,8 +29,16 @@
 
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "pico/Internals/Compression.hpp"
+#include "pico/Internals/LineFilter.hpp"
+#include "pico/Param.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/FollowFileFFNode.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadCompressedFileFFNode.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadFromFileFFNode.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadFromFilesFFNode.hpp"
 
 #include "InputOperator.hpp"
 
@@ -42,6 +50,27 @@ namespace pico {
  *
  * The operator returns a std::string to the user containing a single line read.
  *
+ * Compressed files (gzip, zstd) are detected and decompressed transparently.
+ * Files made of independent blocks (BGZF, multiple zstd frames), such as those
+ * written by WriteToDisk, are decompressed in parallel.
+ *
+ * The input can also be a set of files, given as a directory, a glob pattern
+ * or a list of paths. Files and ranges of large files are distributed to the
+ * reader workers dynamically, largest first.
+ *
+ * Lines can be filtered at reading time, by where_contains() or
+ * where_matches(): only the matching lines are built as strings.
+ *
+ * With follow(), the operator follows a growing file (as tail -F does) and
+ * produces a Stream of its lines.
+ *
+ * The input can be given by a Param, bound before each run (e.g., of a
+ * CompiledPipe).
+ *
+ * When reading uncompressed files, the stateless operators following the
+ * operator in a pipeline are fused into the reader workers, so that lines are
+ * processed by the same thread that read them.
+ *
  * The operator is global and unique for the Pipe it refers to.
  */
 
@@ -54,9 +83,40 @@ class ReadFromFile : public InputOperator<std::string> {
    *
    * Creates a new ReadFromFile operator,
    * yielding an unordered bounded collection.
+   *
+   * The input is a file, a directory or a glob pattern
+   * (e.g., "logs/day??.txt").
+   */
+  ReadFromFile(std::string fname_, unsigned par = auto_par)
+      : InputOperator<std::string>(StructureType::BAG),
+        fname(fname_),
+        paths{fname_} {
+    this->pardeg(par);
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Creates a new ReadFromFile operator, reading from a list of paths
+   * (each being a file, a directory or a glob pattern).
    */
-  ReadFromFile(std::string fname_, unsigned par = def_par())
-      : InputOperator<std::string>(StructureType::BAG), fname(fname_) {
+  ReadFromFile(std::vector<std::string> paths_, unsigned par = auto_par)
+      : InputOperator<std::string>(StructureType::BAG), paths(paths_) {
+    for (auto &p : paths) fname += (fname.empty() ? "" : " ") + p;
+    this->pardeg(par);
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Creates a new ReadFromFile operator, reading from the file, directory or
+   * glob pattern bound to a parameter upon each run.
+   */
+  ReadFromFile(Param<std::string> fparam_, unsigned par = auto_par)
+      : InputOperator<std::string>(StructureType::BAG),
+        fname("<param>"),
+        fparam(fparam_),
+        parametric(true) {
     this->pardeg(par);
   }
 
@@ -64,7 +124,78 @@ class ReadFromFile : public InputOperator<std::string> {
    * Copy constructor.
    */
   ReadFromFile(const ReadFromFile &copy)
-      : InputOperator<std::string>(copy), fname(copy.fname) {}
+      : InputOperator<std::string>(copy),
+        fname(copy.fname),
+        paths(copy.paths),
+        fparam(copy.fparam),
+        parametric(copy.parametric),
+        filter(copy.filter),
+        following(copy.following),
+        idle_ms(copy.idle_ms),
+        checkpoint_path(copy.checkpoint_path) {}
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the operator that only reads the lines containing a
+   * given (non-empty) string.
+   * It replaces a filtering FlatMap, with no string built for other lines.
+   */
+  ReadFromFile where_contains(std::string needle) {
+    ReadFromFile res(*this);
+    res.filter = line_filter::contains(needle);
+    return res;
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the operator that only reads the lines containing a
+   * match of a given regular expression (ECMAScript syntax).
+   */
+  ReadFromFile where_matches(std::string pattern) {
+    ReadFromFile res(*this);
+    res.filter = line_filter::matches(pattern);
+    return res;
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the operator that follows the file as it grows,
+   * yielding a stream.
+   * The file may be rotated (renamed or removed, then created again) or
+   * truncated. The stream ends once the file has been idle for idle_ms
+   * milliseconds, if idle_ms is not zero.
+   * Only a single file, not given by a Param, can be followed.
+   */
+  ReadFromFile follow(unsigned idle_ms_ = 0) {
+    if (parametric || paths.size() != 1 || is_file_set(fname)) {
+      fprintf(stderr, "Cannot follow %s: not a single file\n", fname.c_str());
+      exit(1);
+    }
+    ReadFromFile res(*this);
+    res.following = true;
+    res.idle_ms = idle_ms_;
+    res.stype(StructureType::BAG, false);
+    res.stype(StructureType::STREAM, true);
+    return res;
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the (following) operator that periodically stores its
+   * position into a checkpoint file, and resumes from the stored position
+   * when restarted.
+   * Lines are checkpointed once sent downstream, so a crash may lose the
+   * lines still in flight.
+   */
+  ReadFromFile checkpoint(std::string path) {
+    ReadFromFile res(*this);
+    res.checkpoint_path = path;
+    return res;
+  }
 
   /**
    * Returns a unique name for the operator.
@@ -85,12 +216,72 @@ class ReadFromFile : public InputOperator<std::string> {
   ReadFromFile *clone() { return new ReadFromFile(*this); }
 
   ff::ff_node *node_operator(int parallelism, StructureType st) {
+    if (following) {
+      assert(st == StructureType::STREAM);
+      assert(!parametric && paths.size() == 1 && !is_file_set(fname));
+      return new FollowFileFFNode(fname, checkpoint_path, idle_ms, filter);
+    }
     assert(st == StructureType::BAG);
-    return ReadFromFileFFNode(parallelism, fname);
+    return reader_node(parallelism, fused_stages());
+  }
+
+  /* a followed file is read by a single node */
+  bool sequential() const { return following; }
+
+  /* compressed files are read by dedicated nodes */
+  bool source_fusion(StructureType st) {
+    if (following || st != StructureType::BAG) return false;
+    if (parametric) return true;
+    auto files = expand_file_set(paths);
+    return files.size() != 1 ||
+           compression_from_file(files[0]) == compression::NONE;
+  }
+
+  ff::ff_node *opt_node(int parallelism, PEGOptimization_t opt,
+                        StructureType st, opt_args_t a) {
+    assert(opt == FUSED_SOURCE);
+    assert(source_fusion(st));
+    return reader_node(parallelism, *a.stages);
   }
 
  private:
+  /* reading workers run the given fused stages, if any */
+  ff::ff_node *reader_node(int parallelism, const fused_stages &stages) {
+    if (parametric) {
+      /* the input is known at each run only: read it as a set of files */
+      auto p = fparam;
+      auto files = [p]() { return expand_file_set({p.get()}); };
+      return new ReadFromFilesFFNode(parallelism, files, filter, stages);
+    }
+    if (paths.size() != 1 || is_file_set(fname) || !filter.empty()) {
+      auto files = expand_file_set(paths);
+      if (files.empty()) {
+        fprintf(stderr, "No input files matching %s\n", fname.c_str());
+        exit(1);
+      }
+      auto c = compression_from_file(files[0]);
+      if (files.size() == 1 && c != compression::NONE) {
+        assert(stages.empty());
+        return ReadCompressedFileFFNode(parallelism, files[0], c, filter);
+      }
+      return new ReadFromFilesFFNode(parallelism, files, filter, stages);
+    }
+    auto c = compression_from_file(fname);
+    if (c != compression::NONE) {
+      assert(stages.empty());
+      return ReadCompressedFileFFNode(parallelism, fname, c);
+    }
+    return ReadFromFileFFNode(parallelism, fname, stages);
+  }
+
   std::string fname;
+  std::vector<std::string> paths;
+  Param<std::string> fparam;
+  bool parametric = false;
+  line_filter filter;
+  bool following = false;
+  unsigned idle_ms = 0;
+  std::string checkpoint_path;
 };
 
 } /* namespace pico */
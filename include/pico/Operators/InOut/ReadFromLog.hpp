@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATORS_INOUT_READFROMLOG_HPP_
+#define OPERATORS_INOUT_READFROMLOG_HPP_
+
+#include <string>
+
+#include "pico/Internals/SegmentedLog.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadFromLogFFNode.hpp"
+
+#include "InputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that replays the items of a segmented log (see
+ * SegmentedLog.hpp), as written by WriteToLog, and produces an unordered
+ * bounded collection (i.e. BAG).
+ *
+ * Partitions are read in parallel, each by a single worker, from a start
+ * offset to their current end. Starting from an offset only requires a
+ * lookup into the sparse index, with no scan of the preceding records.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+class ReadFromLog : public InputOperator<std::string> {
+ public:
+  /**
+   * \ingroup op-api
+   *
+   * ReadFromLog Constructor
+   *
+   * Creates a new ReadFromLog operator reading from the log directory.
+   */
+  ReadFromLog(std::string log_, unsigned par = auto_par)
+      : InputOperator<std::string>(StructureType::BAG), log(log_) {
+    this->pardeg(par);
+  }
+
+  /**
+   * Copy constructor.
+   */
+  ReadFromLog(const ReadFromLog &copy)
+      : InputOperator<std::string>(copy), log(copy.log), start(copy.start) {}
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the operator that reads each partition from a given
+   * offset on.
+   */
+  ReadFromLog from_offset(log_offset_t offset) {
+    ReadFromLog res(*this);
+    res.start.offset = offset;
+    return res;
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the operator that reads each partition from the offset
+   * committed by a group of readers (or from the start offset, if none), and
+   * commits the reached offset once done, so that the next run of the group
+   * only reads new items.
+   */
+  ReadFromLog from_committed(std::string group) {
+    ReadFromLog res(*this);
+    res.start.group = group;
+    return res;
+  }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("ReadFromLog");
+    std::ostringstream address;
+    address << (void const *)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "ReadFromLog\n[" + log + "]"; }
+
+ protected:
+  ReadFromLog *clone() { return new ReadFromLog(*this); }
+
+  ff::ff_node *node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::BAG);
+    return make_ReadFromLogFFNode(parallelism, log, start);
+  }
+
+ private:
+  std::string log;
+  log_start start;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_READFROMLOG_HPP_ */
@@ -41,6 +41,8 @@ namespace pico {
  * yielding an ordered unbounded collection.
  *
  * The user specifies a delimiter to identify stream items.
+ * Optionally, the user also specifies the size (in bytes) of the chunks
+ * read from the socket.
  */
 
 class ReadFromSocket : public InputOperator<std::string> {
@@ -52,11 +54,13 @@ class ReadFromSocket : public InputOperator<std::string> {
    * Creates a new ReadFromSocket operator by defining its kernel function,
    * operating on each token of the stream, delimited by the delimiter value.
    */
-  ReadFromSocket(std::string server_, int port_, char delimiter_)
+  ReadFromSocket(std::string server_, int port_, char delimiter_,
+                 size_t read_size_ = SOCKET_READ_SIZE)
       : InputOperator<std::string>(StructureType::STREAM) {
     server_name = server_;
     port = port_;
     delimiter = delimiter_;
+    read_size = read_size_;
   }
 
   /**
@@ -67,6 +71,7 @@ class ReadFromSocket : public InputOperator<std::string> {
     server_name = copy.server_name;
     port = copy.port;
     delimiter = copy.delimiter;
+    read_size = copy.read_size;
   }
 
   /**
@@ -91,13 +96,16 @@ class ReadFromSocket : public InputOperator<std::string> {
 
   ff::ff_node *node_operator(int parallelism, StructureType st) {
     assert(st == StructureType::STREAM);
-    return new ReadFromSocketFFNode(server_name, port, delimiter);
+    return new ReadFromSocketFFNode(server_name, port, delimiter, read_size);
   }
 
+  bool sequential() const { return true; }
+
  private:
   std::string server_name;
   int port;
   char delimiter;
+  size_t read_size;
 };
 
 } /* namespace pico */
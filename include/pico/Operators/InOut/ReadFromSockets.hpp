@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * ReadFromSockets.hpp
+ */
+
+#ifndef OPERATORS_INOUT_READFROMSOCKETS_HPP_
+#define OPERATORS_INOUT_READFROMSOCKETS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadFromSocketsFFNode.hpp"
+
+#include "InputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that reads data streams from multiple sockets,
+ * yielding an ordered unbounded collection.
+ *
+ * Connections are either opened towards a list of endpoints (connect mode) or
+ * accepted on a listening port, until the specified number of connections is
+ * reached (listen mode).
+ * Connections are multiplexed over a number of reader threads, given by the
+ * parallelism degree of the operator.
+ *
+ * The user specifies a delimiter to identify stream items.
+ * By default, all the connections are merged into a single stream; per-
+ * connection streams can be requested by calling per_connection().
+ */
+class ReadFromSockets : public InputOperator<std::string> {
+ public:
+  /**
+   * \ingroup op-api
+   * ReadFromSockets Constructor (connect mode)
+   *
+   * Creates a new ReadFromSockets operator connecting to each of the
+   * (server, port) endpoints.
+   */
+  ReadFromSockets(std::vector<std::pair<std::string, int>> endpoints_,
+                  char delimiter_, unsigned par = def_par(),
+                  size_t read_size_ = SOCKET_READ_SIZE)
+      : InputOperator<std::string>(StructureType::STREAM),
+        endpoints(endpoints_),
+        connections(endpoints_.size()),
+        delimiter(delimiter_),
+        read_size(read_size_) {
+    assert(connections);
+    if (!par) par = ff_realNumCores();
+    this->pardeg(std::min(par, connections));
+  }
+
+  /**
+   * \ingroup op-api
+   * ReadFromSockets Constructor (listen mode)
+   *
+   * Creates a new ReadFromSockets operator accepting the given number of
+   * connections on a local port.
+   * If the port is 0, an ephemeral port is bound at run time and can be
+   * retrieved by bound_port().
+   */
+  ReadFromSockets(int port_, unsigned connections_, char delimiter_,
+                  unsigned par = def_par(),
+                  size_t read_size_ = SOCKET_READ_SIZE)
+      : InputOperator<std::string>(StructureType::STREAM),
+        port(port_),
+        connections(connections_),
+        delimiter(delimiter_),
+        read_size(read_size_) {
+    assert(connections);
+    if (!par) par = ff_realNumCores();
+    this->pardeg(std::min(par, connections));
+  }
+
+  /**
+   * Copy constructor.
+   */
+  ReadFromSockets(const ReadFromSockets &copy)
+      : InputOperator<std::string>(copy),
+        endpoints(copy.endpoints),
+        port(copy.port),
+        connections(copy.connections),
+        delimiter(copy.delimiter),
+        read_size(copy.read_size),
+        per_connection_(copy.per_connection_),
+        bound_port_(copy.bound_port_) {}
+
+  /*
+   * Yields a separate collection (c-stream) for each connection, rather than
+   * merging all the connections into a single collection.
+   */
+  ReadFromSockets per_connection() {
+    ReadFromSockets res(*this);
+    res.per_connection_ = true;
+    return res;
+  }
+
+  /*
+   * In listen mode, returns the port the operator is listening on, or 0 until
+   * the listening socket is bound by a running pipeline.
+   * Copies of the operator (e.g., the ones held by a Pipe) share the port.
+   */
+  int bound_port() const { return *bound_port_; }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("ReadFromSockets");
+    std::ostringstream address;
+    address << (void const *)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() {
+    return "ReadFromSockets\n[" + std::to_string(connections) +
+           " connections]";
+  }
+
+ protected:
+  ReadFromSockets *clone() { return new ReadFromSockets(*this); }
+
+  const OpClass operator_class() { return OpClass::INPUT; }
+
+  ff::ff_node *node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::STREAM);
+    return new ReadFromSocketsFFNode(parallelism, endpoints, port,
+                                     connections, delimiter, read_size,
+                                     per_connection_, bound_port_);
+  }
+
+ private:
+  std::vector<std::pair<std::string, int>> endpoints;
+  int port = 0;
+  unsigned connections;
+  char delimiter;
+  size_t read_size;
+  bool per_connection_ = false;
+  std::shared_ptr<std::atomic<int>> bound_port_ =
+      std::make_shared<std::atomic<int>>(0);
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_READFROMSOCKETS_HPP_ */
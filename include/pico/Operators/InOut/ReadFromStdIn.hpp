@@ -45,6 +45,11 @@ namespace pico {
  * function.
  *
  *
+ * The standard input is read by large blocks, bypassing iostreams. With a
+ * parallelism degree greater than one, blocks are split into items by
+ * parallel workers, and items are produced out of order, unless ordered()
+ * is requested.
+ *
  * The operator is global and unique for the Pipe it refers to.
  */
 
@@ -57,9 +62,10 @@ class ReadFromStdIn : public InputOperator<std::string> {
    * Creates a new ReadFromSocket operator by defining its kernel function,
    * operating on each token of the stream, delimited by the delimiter value.
    */
-  ReadFromStdIn(char delimiter_)
+  ReadFromStdIn(char delimiter_, unsigned par = 1)
       : InputOperator<std::string>(StructureType::STREAM) {
     delimiter = delimiter_;
+    this->pardeg(par);
   }
 
   /**
@@ -67,6 +73,19 @@ class ReadFromStdIn : public InputOperator<std::string> {
    */
   ReadFromStdIn(const ReadFromStdIn &copy) : InputOperator<std::string>(copy) {
     delimiter = copy.delimiter;
+    ordered_ = copy.ordered_;
+  }
+
+  /**
+   * \ingroup op-api
+   *
+   * Returns a copy of the operator that preserves the input order, when
+   * splitting items in parallel.
+   */
+  ReadFromStdIn ordered() {
+    ReadFromStdIn res(*this);
+    res.ordered_ = true;
+    return res;
   }
 
   /**
@@ -91,11 +110,13 @@ class ReadFromStdIn : public InputOperator<std::string> {
 
   ff::ff_node *node_operator(int parallelism, StructureType st) {
     assert(st == StructureType::STREAM);
-    return new ReadFromStdInFFNode<Token<std::string>>(delimiter);
+    return make_ReadFromStdInFFNode<Token<std::string>>(parallelism, delimiter,
+                                                        ordered_);
   }
 
  private:
   char delimiter;
+  bool ordered_ = false;
 };
 
 } /* namespace pico */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATORS_INOUT_READJSONLINES_HPP_
+#define OPERATORS_INOUT_READJSONLINES_HPP_
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "pico/Internals/JSONParser.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadTextRecordsFFNode.hpp"
+
+#include "InputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that reads a JSON-lines file (i.e., one JSON object per
+ * line) and produces an unordered bounded collection (i.e., BAG) of typed
+ * records, one std::tuple<Ts...> per line.
+ *
+ * The user specifies one field path per tuple element, as a dot-separated
+ * sequence of keys (e.g., "user.screen_name").
+ * Only the requested fields are extracted, with no document tree:
+ * - strings are unescaped
+ * - numbers (also within strings) and booleans are converted in place
+ * - other values are returned as JSON text into string elements
+ * Lines lacking any of the fields, or with mismatching types, are dropped.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+template <typename... Ts>
+class ReadJsonLines : public InputOperator<std::tuple<Ts...>> {
+ public:
+  /**
+   * \ingroup op-api
+   *
+   * ReadJsonLines Constructor
+   *
+   * Creates a new ReadJsonLines operator extracting the given fields.
+   */
+  ReadJsonLines(std::string fname_, std::vector<std::string> paths,
+                unsigned par = auto_par)
+      : InputOperator<std::tuple<Ts...>>(StructureType::BAG), fname(fname_) {
+    assert(paths.size() == sizeof...(Ts));
+    format.paths = paths;
+    this->pardeg(par);
+  }
+
+  /**
+   * Copy constructor.
+   */
+  ReadJsonLines(const ReadJsonLines &copy)
+      : InputOperator<std::tuple<Ts...>>(copy),
+        fname(copy.fname),
+        format(copy.format) {}
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("ReadJsonLines");
+    std::ostringstream address;
+    address << (void const *)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "ReadJsonLines\n[" + fname + "]"; }
+
+ protected:
+  ReadJsonLines *clone() { return new ReadJsonLines(*this); }
+
+  ff::ff_node *node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::BAG);
+    return make_ReadTextRecordsFFNode<json_parser<Ts...>>(parallelism, fname,
+                                                          format);
+  }
+
+ private:
+  std::string fname;
+  json_format format;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_READJSONLINES_HPP_ */
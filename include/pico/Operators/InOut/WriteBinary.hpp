@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATORS_INOUT_WRITEBINARY_HPP_
+#define OPERATORS_INOUT_WRITEBINARY_HPP_
+
+#include <string>
+
+#include "pico/Internals/BinaryFormat.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/WriteBinaryFFNode.hpp"
+
+#include "OutputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that writes data to a file in the PiCo binary format
+ * (see BinaryFormat.hpp), to be read back by ReadBinary with no parsing.
+ *
+ * Records must be either trivially copyable or key-value pairs with
+ * trivially-copyable keys and values.
+ *
+ * Each worker groups items into blocks, that are appended to the file as
+ * soon as complete. The order of the items is not preserved.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+template <typename In>
+class WriteBinary : public OutputOperator<In> {
+  static_assert(binary_codec<In>::supported,
+                "WriteBinary requires trivially-copyable records");
+
+ public:
+  /**
+   * \ingroup op-api
+   *
+   * WriteBinary Constructor
+   *
+   * Creates a new WriteBinary operator writing to fname.
+   */
+  WriteBinary(std::string fname_, unsigned par = auto_par)
+      : OutputOperator<In>(StructureType::BAG), fname(fname_) {
+    this->pardeg(par);
+  }
+
+  /**
+   * Copy constructor.
+   */
+  WriteBinary(const WriteBinary& copy)
+      : OutputOperator<In>(copy),
+        fname(copy.fname),
+        block_size_(copy.block_size_) {}
+
+  /*
+   * Sets the size (in bytes) of the payload of each block.
+   */
+  WriteBinary block_size(size_t size) {
+    assert(size);
+    WriteBinary res(*this);
+    res.block_size_ = size;
+    return res;
+  }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("WriteBinary");
+    std::ostringstream address;
+    address << (void const*)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "WriteBinary\n[" + fname + "]"; }
+
+ protected:
+  WriteBinary* clone() { return new WriteBinary(*this); }
+
+  ff::ff_node* node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::BAG);
+    return make_WriteBinaryFFNode<In>(parallelism, fname, block_size_);
+  }
+
+ private:
+  std::string fname;
+  size_t block_size_ = BINARY_BLOCK_SIZE;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_WRITEBINARY_HPP_ */
@@ -30,6 +30,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "pico/FormatBuffer.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/InOut/WriteToDiskFFNode.hpp"
 
 #include "OutputOperator.hpp"
@@ -43,6 +44,17 @@ namespace pico {
  * the text file, passed as a std::string. The kernel can be a lambda function,
  * a functor or a function.
  *
+ * By default, the file is written sequentially. Parallel writing is enabled
+ * by either:
+ * - sharded(): each worker writes a separate file, named fname.<worker-id>
+ * - merged(): each worker writes a shard, then all the shards are merged into
+ *   the output file by positioned writes
+ * In both cases, items are distributed among workers round-robin, unless
+ * by_key() is requested on a key-value collection.
+ *
+ * Files named *.gz or *.zst are compressed (gzip or zstd), as a sequence of
+ * independent blocks that can be decompressed in parallel by ReadFromFile.
+ *
  *
  * The operator is global and unique for the Pipe it refers to.
  */
@@ -58,6 +70,21 @@ class WriteToDisk : public OutputOperator<In> {
    * Creates a new WriteToDisk operator by defining its kernel function.
    */
   WriteToDisk(std::string fname_, std::function<std::string(In)> func_)
+      : OutputOperator<In>(StructureType::BAG),
+        fname(fname_),  //
+        usr_func(true),
+        func([func_](In& in, FormatBuffer& out) { out << func_(in); }) {}
+
+  /**
+   * \ingroup op-api
+   *
+   * WritetoDisk Constructor
+   *
+   * Creates a new WriteToDisk operator by defining its kernel function,
+   * that formats each item directly into the output buffer.
+   */
+  WriteToDisk(std::string fname_,
+              std::function<void(In&, FormatBuffer&)> func_)
       : OutputOperator<In>(StructureType::BAG),
         fname(fname_),  //
         usr_func(true),
@@ -68,7 +95,7 @@ class WriteToDisk : public OutputOperator<In> {
    *
    * WritetoDisk Constructor
    *
-   * Creates a new WriteToDisk writing by ostream.
+   * Creates a new WriteToDisk writing by operator<<.
    */
   WriteToDisk(std::string fname_)
       : OutputOperator<In>(StructureType::BAG), fname(fname_) {}
@@ -77,7 +104,46 @@ class WriteToDisk : public OutputOperator<In> {
    * Copy constructor.
    */
   WriteToDisk(const WriteToDisk& copy)
-      : OutputOperator<In>(copy), fname(copy.fname), func(copy.func) {}
+      : OutputOperator<In>(copy),
+        fname(copy.fname),
+        usr_func(copy.usr_func),
+        func(copy.func),
+        mode(copy.mode),
+        by_key_(copy.by_key_) {}
+
+  /*
+   * Writes one file per worker, rather than a single file.
+   * The number of workers (thus of files) is one per core, unless given.
+   */
+  WriteToDisk sharded(unsigned par = def_par()) {
+    WriteToDisk res(*this);
+    res.mode = write_mode::SHARDED;
+    res.pardeg(par ? par : ff_realNumCores());
+    return res;
+  }
+
+  /*
+   * Writes the file in parallel, by merging per-worker shards (one per core,
+   * unless given).
+   */
+  WriteToDisk merged(unsigned par = def_par()) {
+    WriteToDisk res(*this);
+    res.mode = write_mode::MERGED;
+    res.pardeg(par ? par : ff_realNumCores());
+    return res;
+  }
+
+  /*
+   * Distributes items among parallel writers by key.
+   * Only valid for key-value collections.
+   */
+  WriteToDisk by_key() {
+    static_assert(detail::has_keytype<In>::value,
+                  "by_key requires a key-value type");
+    WriteToDisk res(*this);
+    res.by_key_ = true;
+    return res;
+  }
 
   /**
    * Returns a unique name for the operator.
@@ -103,16 +169,27 @@ class WriteToDisk : public OutputOperator<In> {
 
   ff::ff_node* node_operator(int parallelism, StructureType st) {
     assert(st == StructureType::BAG);
+    if (mode != write_mode::SINGLE) {
+      bool merge = (mode == write_mode::MERGED);
+      return new WriteToDiskFarm<In>(parallelism, fname, merge, by_key_,
+                                     usr_func ? &func : nullptr);
+    }
     if (usr_func)
       return new WriteToDiskFFNode<In>(fname, func);
     else
       return new WriteToDiskFFNode_ostream<In>(fname);
   }
 
+  bool sequential() const { return mode == write_mode::SINGLE; }
+
  private:
+  enum class write_mode { SINGLE, SHARDED, MERGED };
+
   std::string fname;
   bool usr_func = false;
-  std::function<std::string(In)> func;
+  std::function<void(In&, FormatBuffer&)> func;
+  write_mode mode = write_mode::SINGLE;
+  bool by_key_ = false;
 };
 
 } /* namespace pico */
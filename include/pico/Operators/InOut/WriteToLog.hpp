@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATORS_INOUT_WRITETOLOG_HPP_
+#define OPERATORS_INOUT_WRITETOLOG_HPP_
+
+#include <string>
+
+#include "pico/Internals/SegmentedLog.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/WriteToLogFFNode.hpp"
+
+#include "OutputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that appends data to a segmented log (see
+ * SegmentedLog.hpp), to be replayed by ReadFromLog.
+ *
+ * The log has one partition per worker, and items are distributed among
+ * partitions round-robin. Writing to an existing log appends to its
+ * partitions.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+class WriteToLog : public OutputOperator<std::string> {
+ public:
+  /**
+   * \ingroup op-api
+   *
+   * WriteToLog Constructor
+   *
+   * Creates a new WriteToLog operator writing to the log directory, with the
+   * given number of partitions (by default, one per core).
+   */
+  WriteToLog(std::string log_, unsigned partitions = def_par())
+      : OutputOperator<std::string>(StructureType::BAG), log(log_) {
+    /* the number of partitions is not left to the planner */
+    this->pardeg(partitions ? partitions : ff_realNumCores());
+  }
+
+  /**
+   * Copy constructor.
+   */
+  WriteToLog(const WriteToLog& copy)
+      : OutputOperator<std::string>(copy),
+        log(copy.log),
+        segment_size_(copy.segment_size_) {}
+
+  /*
+   * Sets the maximum size (in bytes) of each segment.
+   */
+  WriteToLog segment_size(size_t size) {
+    assert(size);
+    WriteToLog res(*this);
+    res.segment_size_ = size;
+    return res;
+  }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("WriteToLog");
+    std::ostringstream address;
+    address << (void const*)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "WriteToLog\n[" + log + "]"; }
+
+ protected:
+  WriteToLog* clone() { return new WriteToLog(*this); }
+
+  ff::ff_node* node_operator(int parallelism, StructureType st) {
+    assert(st == StructureType::BAG);
+    return make_WriteToLogFFNode(parallelism, log, segment_size_);
+  }
+
+ private:
+  std::string log;
+  size_t segment_size_ = LOG_SEGMENT_SIZE;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_WRITETOLOG_HPP_ */
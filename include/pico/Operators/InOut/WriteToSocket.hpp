@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * WriteToSocket.hpp
+ */
+
+#ifndef OPERATORS_INOUT_WRITETOSOCKET_HPP_
+#define OPERATORS_INOUT_WRITETOSOCKET_HPP_
+
+#include <functional>
+#include <string>
+
+#include "pico/FormatBuffer.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/WriteToSocketFFNode.hpp"
+
+#include "OutputOperator.hpp"
+
+namespace pico {
+
+/**
+ * Defines an operator that writes data to a socket, one item per line.
+ *
+ * The user specifies the kernel function that operates on each item before
+ * being written to the socket. The kernel can be a lambda function, a
+ * functor or a function.
+ *
+ * Items are batched into large buffers, that are written by a dedicated
+ * thread. A buffer is sent once full, or once the linger time has expired
+ * since its first item was appended.
+ *
+ * The operator is global and unique for the Pipe it refers to.
+ */
+
+template <typename In>
+class WriteToSocket : public OutputOperator<In> {
+ public:
+  /**
+   * \ingroup op-api
+   * WriteToSocket Constructor
+   *
+   * Creates a new WriteToSocket operator by defining its kernel function.
+   */
+  WriteToSocket(std::string server_, int port_,
+                std::function<std::string(In)> func_)
+      : OutputOperator<In>(StructureType::STREAM),
+        server_name(server_),
+        port(port_),
+        usr_func(true),
+        func([func_](In& in, FormatBuffer& out) { out << func_(in); }) {
+    this->stype(StructureType::BAG, true);
+  }
+
+  /**
+   * \ingroup op-api
+   * WriteToSocket Constructor
+   *
+   * Creates a new WriteToSocket operator by defining its kernel function,
+   * that formats each item directly into the output buffer.
+   */
+  WriteToSocket(std::string server_, int port_,
+                std::function<void(In&, FormatBuffer&)> func_)
+      : OutputOperator<In>(StructureType::STREAM),
+        server_name(server_),
+        port(port_),
+        usr_func(true),
+        func(func_) {
+    this->stype(StructureType::BAG, true);
+  }
+
+  /**
+   * \ingroup op-api
+   * WriteToSocket Constructor
+   *
+   * Creates a new WriteToSocket operator writing by operator<<.
+   */
+  WriteToSocket(std::string server_, int port_)
+      : OutputOperator<In>(StructureType::STREAM),
+        server_name(server_),
+        port(port_) {
+    this->stype(StructureType::BAG, true);
+  }
+
+  /**
+   * Copy constructor.
+   */
+  WriteToSocket(const WriteToSocket& copy)
+      : OutputOperator<In>(copy),
+        server_name(copy.server_name),
+        port(copy.port),
+        usr_func(copy.usr_func),
+        func(copy.func),
+        buffer_size_(copy.buffer_size_),
+        linger_ms_(copy.linger_ms_) {}
+
+  /*
+   * Sets the size (in bytes) of the buffers written to the socket.
+   */
+  WriteToSocket buffer_size(size_t size) {
+    WriteToSocket res(*this);
+    res.buffer_size_ = size;
+    return res;
+  }
+
+  /*
+   * Sets the maximum time (in milliseconds) written items may be buffered.
+   */
+  WriteToSocket linger(unsigned ms) {
+    WriteToSocket res(*this);
+    res.linger_ms_ = ms;
+    return res;
+  }
+
+  /**
+   * Returns a unique name for the operator.
+   */
+  std::string name() {
+    std::string name("WriteToSocket");
+    std::ostringstream address;
+    address << (void const*)this;
+    return name + address.str().erase(0, 2);
+  }
+
+  /**
+   * Returns the name of the operator, consisting in the name of the class.
+   */
+  std::string name_short() { return "WriteToSocket\n[" + server_name + "]"; }
+
+ protected:
+  /**
+   * Duplicates a WriteToSocket with a copy of the kernel function.
+   * @return new WriteToSocket pointer
+   */
+  WriteToSocket<In>* clone() { return new WriteToSocket(*this); }
+
+  const OpClass operator_class() { return OpClass::OUTPUT; }
+
+  ff::ff_node* node_operator(int parallelism, StructureType st) {
+    if (usr_func)
+      return new WriteToSocketFFNode<In, Token<In>>(server_name, port, func,
+                                                    buffer_size_, linger_ms_);
+    return new WriteToSocketFFNode_ostream<In, Token<In>>(
+        server_name, port, buffer_size_, linger_ms_);
+  }
+
+  bool sequential() const { return true; }
+
+ private:
+  std::string server_name;
+  int port;
+  bool usr_func = false;
+  std::function<void(In&, FormatBuffer&)> func;
+  size_t buffer_size_ = SOCKET_WRITE_SIZE;
+  unsigned linger_ms_ = SOCKET_LINGER_MS;
+};
+
+} /* namespace pico */
+
+#endif /* OPERATORS_INOUT_WRITETOSOCKET_HPP_ */
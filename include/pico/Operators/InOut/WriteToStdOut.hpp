@@ -30,6 +30,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "pico/FormatBuffer.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/InOut/WriteToStdOutFFNode.hpp"
 
 #include "OutputOperator.hpp"
@@ -59,6 +60,19 @@ class WriteToStdOut : public OutputOperator<In> {
   WriteToStdOut(std::function<std::string(In)> func_)
       : OutputOperator<In>(StructureType::STREAM) {
     usr_func = true;
+    func = [func_](In& in, FormatBuffer& out) { out << func_(in); };
+  }
+
+  /**
+   * \ingroup op-api
+   * WriteToStdOut Constructor
+   *
+   * Creates a new WriteToStdOut operator by defining its kernel function,
+   * that formats each item directly into the output buffer.
+   */
+  WriteToStdOut(std::function<void(In&, FormatBuffer&)> func_)
+      : OutputOperator<In>(StructureType::STREAM) {
+    usr_func = true;
     func = func_;
   }
 
@@ -108,9 +122,11 @@ class WriteToStdOut : public OutputOperator<In> {
     return new WriteToStdOutFFNode_ostream<In, Token<In>>();
   }
 
+  bool sequential() const { return true; }
+
  private:
   bool usr_func = false;
-  std::function<std::string(In)> func;
+  std::function<void(In&, FormatBuffer&)> func;
 };
 
 } /* namespace pico */
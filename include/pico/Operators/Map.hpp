@@ -29,8 +29,10 @@
 #include "pico/Internals/TimedToken.hpp"
 #include "pico/Internals/Token.hpp"
 
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/MapBatch.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/MapPReduceBatch.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/WorkStealingBatch.hpp"
 
 /**
  * This file defines an operator performing a Map function, taking in input one
@@ -59,7 +61,7 @@ class MapBase : public UnaryOperator<In, Out> {
    *
    * Creates a new Map operator by defining its kernel function.
    */
-  MapBase(std::function<Out(In &)> mapf_, unsigned par = def_par()) {
+  MapBase(std::function<Out(In &)> mapf_, unsigned par = auto_par) {
     mapf = mapf_;
     this->set_input_degree(1);
     this->set_output_degree(1);
@@ -69,7 +71,7 @@ class MapBase : public UnaryOperator<In, Out> {
   }
 
   MapBase(const MapBase &copy)
-      : UnaryOperator<In, Out>(copy), mapf(copy.mapf) {}
+      : UnaryOperator<In, Out>(copy), mapf(copy.mapf), ws(copy.ws) {}
 
   /**
    * Returns the name of the operator, consisting in the name of the class.
@@ -79,8 +81,16 @@ class MapBase : public UnaryOperator<In, Out> {
  protected:
   const OpClass operator_class() { return OpClass::MAP; }
 
+  bool stealing() const { return ws; }
+
   ff::ff_node *node_operator(int parallelism, StructureType st) {
     // todo assert unique stype
+    if (ws) {
+      auto stage = fused_kernel();
+      auto res = make_WorkStealingBatch(parallelism, fused_stages{stage}, st);
+      delete stage;
+      return res;
+    }
     if (st == StructureType::STREAM) {
       using impl_t = MapBatchStream<In, Out, Token<In>, Token<Out>>;
       return new impl_t(parallelism, mapf);
@@ -90,7 +100,12 @@ class MapBase : public UnaryOperator<In, Out> {
     return new impl_t(parallelism, mapf);
   }
 
+  fused_stage *fused_kernel() {
+    return new map_stage<Token<In>, Token<Out>>(mapf);
+  }
+
   std::function<Out(In &)> mapf;
+  bool ws = false;
 };
 
 /*
@@ -106,11 +121,22 @@ class Map : public MapBase<In, Out> {
    *
    * Creates a new Map operator by defining its kernel function.
    */
-  Map(std::function<Out(In &)> mapf_, unsigned par = def_par())
+  Map(std::function<Out(In &)> mapf_, unsigned par = auto_par)
       : MapBase<In, Out>(mapf_, par) {}
 
   Map(const Map &copy) : MapBase<In, Out>(copy) {}
 
+  /*
+   * Balances the workers by work stealing: idle workers take micro-batches
+   * queued to busy ones, for kernels with irregular cost per micro-batch.
+   * The order of STREAM collections is preserved.
+   */
+  Map work_stealing() {
+    Map res(*this);
+    res.ws = true;
+    return res;
+  }
+
   /**
    * Returns the name of the operator, consisting in the name of the class.
    */
@@ -138,11 +164,18 @@ class Map<In, KeyValue<K, V>> : public MapBase<In, KeyValue<K, V>> {
    *
    * Creates a new Map operator by defining its kernel function.
    */
-  Map(std::function<KeyValue<K, V>(In &)> mapf_, unsigned par = def_par())
+  Map(std::function<KeyValue<K, V>(In &)> mapf_, unsigned par = auto_par)
       : MapBase<In, KeyValue<K, V>>(mapf_, par) {}
 
   Map(const Map &copy) : MapBase<In, KeyValue<K, V>>(copy) {}
 
+  /* balances the workers by work stealing */
+  Map work_stealing() {
+    Map res(*this);
+    res.ws = true;
+    return res;
+  }
+
   /**
    * Returns the name of the operator, consisting in the name of the class.
    */
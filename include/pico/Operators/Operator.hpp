@@ -21,8 +21,10 @@
 #ifndef ACTORNODE_HPP_
 #define ACTORNODE_HPP_
 
+#include <atomic>
 #include <functional>
 #include <map>
+#include <memory>
 
 #include <ff/node.hpp>
 
@@ -31,11 +33,23 @@
 
 namespace pico {
 
+/*
+ * The default parallelism degree: PARDEG if set, otherwise the number of
+ * cores.
+ */
 static unsigned def_par() {
   auto env = std::getenv("PARDEG");
   return (unsigned)(env ? atoi(env) : (int)ff_realNumCores());
 }
 
+/*
+ * The parallelism degree of operators constructed with no explicit degree:
+ * def_par(), unless parallelism planning is enabled (see Pipe::plan), in
+ * which case the degree is assigned by the executor.
+ * If PARDEG is set, it is taken as an explicit degree for all the operators.
+ */
+static constexpr unsigned auto_par = 0;
+
 /**
  * Base class defining a semantic dataflow operator.
  * An operator has an input and output cardinality <I-degree, O-degree>, where
@@ -59,6 +73,8 @@ class Operator {
     stype(StructureType::BAG, copy.st_map.at(StructureType::BAG));
     stype(StructureType::STREAM, copy.st_map.at(StructureType::STREAM));
     pardeg_ = copy.pardeg_;
+    planned_pardeg_ = copy.planned_pardeg_;
+    cost_ = copy.cost_;
   }
 
   virtual ~Operator() {}
@@ -98,14 +114,37 @@ class Operator {
 
   void stype(StructureType s, bool v) { st_map[s] = v; }
 
-  unsigned pardeg() const { return pardeg_; }
+  unsigned pardeg() const { return pardeg_ ? pardeg_ : planned_pardeg_; }
 
   void pardeg(unsigned pardeg__) { pardeg_ = pardeg__; }
 
+  /*
+   * parallelism planning
+   */
+  bool auto_pardeg() const { return !pardeg_ && !std::getenv("PARDEG"); }
+
+  void plan_pardeg(unsigned p) { planned_pardeg_ = p; }
+
+  /* whether the operator runs on a single thread, whatever its degree */
+  virtual bool sequential() const { return false; }
+
+  /* the measured cost of the operator (0 if not calibrated) */
+  double cost() const { return cost_; }
+
+  void cost(double c) { cost_ = c; }
+
+  /* busy time (in ns) of the nodes implementing the operator, if profiled */
+  std::shared_ptr<std::atomic<unsigned long long>> &busy_counter() {
+    return busy_;
+  }
+
  private:
   size_t in_deg, out_deg;
   st_map_t st_map;
-  unsigned pardeg_ = def_par();
+  unsigned pardeg_ = auto_par;
+  unsigned planned_pardeg_ = def_par();
+  double cost_ = 0;
+  std::shared_ptr<std::atomic<unsigned long long>> busy_;
 };
 
 } /* namespace pico */
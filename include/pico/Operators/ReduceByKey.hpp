@@ -23,6 +23,7 @@
 
 #include "pico/Internals/TimedToken.hpp"
 #include "pico/Internals/Token.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
 #include "pico/ff_implementation/OperatorsFFNodes/PReduceWin.hpp"
 
 #include "UnaryOperator.hpp"
@@ -52,7 +53,7 @@ class ReduceByKey : public UnaryOperator<In, In> {
    *
    * Creates a ReduceByKey operator by defining its kernel function.
    */
-  ReduceByKey(std::function<V(V&, V&)> reducef_, unsigned par = def_par())
+  ReduceByKey(std::function<V(V&, V&)> reducef_, unsigned par = auto_par)
       : reducef(reducef_) {
     this->set_input_degree(1);
     this->set_output_degree(1);
@@ -68,6 +69,7 @@ class ReduceByKey : public UnaryOperator<In, In> {
   ReduceByKey(const ReduceByKey& copy) : UnaryOperator<In, In>(copy) {
     reducef = copy.reducef;
     win = copy.win ? copy.win->clone() : nullptr;
+    elastic_ = copy.elastic_;
   }
 
   ~ReduceByKey() {
@@ -91,6 +93,18 @@ class ReduceByKey : public UnaryOperator<In, In> {
     return res;
   }
 
+  /*
+   * Lets the number of active workers of a windowed reduce follow the load at
+   * runtime, up to the parallelism degree.
+   * Keys are partitioned by key groups, whose windows migrate between workers
+   * without stopping the stream.
+   */
+  ReduceByKey elastic() {
+    ReduceByKey res(*this);
+    res.elastic_ = true;
+    return res;
+  }
+
   std::function<V(V&, V&)> kernel() { return reducef; }
 
  protected:
@@ -106,15 +120,35 @@ class ReduceByKey : public UnaryOperator<In, In> {
     // todo assert unique stype
     if (st == StructureType::STREAM) {
       assert(win);
-      return new PReduceWin<In, Token<In>>(pardeg, reducef, win);
+      return new PReduceWin<In, Token<In>>(pardeg, reducef, win, elastic_);
     }
     // todo
     return nullptr;
   }
 
+  /*
+   * the partial reduce, to be fused after a run of operators
+   */
+  fused_stage* fused_kernel() {
+    return new preduce_stage<Token<In>>(reducef, this->pardeg());
+  }
+
+  /*
+   * merges the partial states of the given node, running the fused partial
+   * reduce with the given parallelism
+   */
+  ff::ff_node* opt_node(int par, PEGOptimization_t opt, StructureType st,
+                        opt_args_t a) {
+    assert(opt == FUSED_PREDUCE);
+    assert(st == StructureType::BAG);
+    return new FusedPReduce_par_red<Token<In>>(a.node, par, this->pardeg(),
+                                               reducef);
+  }
+
  private:
   std::function<V(V&, V&)> reducef;
   WindowPolicy* win = nullptr;
+  bool elastic_ = false;
 };
 
 } /* namespace pico */
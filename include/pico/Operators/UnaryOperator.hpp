@@ -41,6 +41,26 @@ class base_UnaryOperator : public Operator {
     assert(false);
     return nullptr;
   }
+
+  /*
+   * Returns a new stage applying the operator kernel to whole micro-batches,
+   * for operators that can be fused with their neighbours.
+   */
+  virtual fused_stage* fused_kernel() {
+    assert(false);
+    return nullptr;
+  }
+
+  /*
+   * Whether the (input) operator can run the operators fused after it within
+   * its own workers.
+   */
+  virtual bool source_fusion(StructureType) { return false; }
+
+  /*
+   * Whether the operator balances its workers by work stealing.
+   */
+  virtual bool stealing() const { return false; }
 };
 
 template <typename In, typename Out>
@@ -21,12 +21,17 @@
 #ifndef PICO_PEGOPTIMIZATIONS_HPP_
 #define PICO_PEGOPTIMIZATIONS_HPP_
 
+#include <algorithm>
+#include <vector>
+
 #include <ff/pipeline.hpp>
 
 #include "pico/Internals/PEGOptimization/defs.hpp"
 #include "pico/Operators/BinaryOperator.hpp"
 #include "pico/Operators/UnaryOperator.hpp"
 #include "pico/Pipe.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/WorkStealingBatch.hpp"
 #include "pico/ff_implementation/SupportFFNodes/PairFarm.hpp"
 
 namespace pico {
@@ -47,6 +52,19 @@ static bool opt_match(base_UnaryOperator *op1, base_UnaryOperator *op2,  //
         res = res && (opc1 == OpClass::FMAP && opc2 == OpClass::REDUCE);
         res = res && (!op2->windowing() && op2->partitioning());
         break;
+      case FUSED_CHAIN:
+        res = res && (opc1 == OpClass::MAP || opc1 == OpClass::FMAP);
+        res = res && (opc2 == OpClass::MAP || opc2 == OpClass::FMAP);
+        break;
+      case FUSED_SOURCE:
+        res = res && opc1 == OpClass::INPUT;
+        res = res && (opc2 == OpClass::MAP || opc2 == OpClass::FMAP);
+        break;
+      case FUSED_PREDUCE:
+        res = res && (opc1 == OpClass::MAP || opc1 == OpClass::FMAP);
+        res = res && opc2 == OpClass::REDUCE;
+        res = res && (!op2->windowing() && op2->partitioning());
+        break;
       default:
         assert(false);
     }
@@ -78,6 +96,122 @@ static bool opt_match_binary(const Pipe &p, base_UnaryOperator &op2,
   return false;
 }
 
+/* the unary operator of a sub-term, if any */
+static base_UnaryOperator *unary_operator(const Pipe &p) {
+  if (p.term_node_type() != Pipe::OPERATOR) return nullptr;
+  return dynamic_cast<base_UnaryOperator *>(p.get_operator_ptr());
+}
+
+/*
+ * Matches the operators fused by add_fused from it on: the input operator
+ * (if any) and the run of stateless operators executed by the same workers.
+ * Returns the number of matched sub-terms, zero if none.
+ */
+template <typename ItType>
+static size_t match_fused(ItType it, ItType end, StructureType st,
+                          base_UnaryOperator *&source,
+                          std::vector<base_UnaryOperator *> &run) {
+  source = nullptr;
+  run.clear();
+  auto first = unary_operator(**it);
+  if (!first) return 0;
+
+  /* detect the source, if any */
+  auto second = it + 1 != end ? unary_operator(**(it + 1)) : nullptr;
+  if (second && opt_match(first, second, FUSED_SOURCE) &&
+      first->source_fusion(st))
+    source = first;
+
+  /* find the run */
+  auto run_it = source ? it + 1 : it;
+  auto last = unary_operator(**run_it);
+  if (!last || !opt_match(last, last, FUSED_CHAIN)) return 0;
+  bool stealing = false;
+  for (; run_it != end; ++run_it) {
+    auto op = unary_operator(**run_it);
+    if (!op || !opt_match(last, op, FUSED_CHAIN)) break;
+    stealing = stealing || op->stealing();
+    run.push_back(op);
+    last = op;
+  }
+  if (source && stealing) return 0;
+  return run_it - it;
+}
+
+/*
+ * Fuses the longest run of stateless operators starting at it into a single
+ * farm, whose workers apply the composed kernels per micro-batch.
+ * If the run follows an input operator supporting it, the run is executed by
+ * the input workers themselves.
+ * The run is also fused into a following reduce-by-key, if any: workers
+ * reduce locally, then only the partial states are merged.
+ * Runs with work-stealing operators are executed by a work-stealing farm,
+ * thus they are never fused into the input operator.
+ *
+ * Sequential runs (e.g., of small jobs) are executed by a single node, with no
+ * emitter and collector.
+ *
+ * Returns the number of fused sub-terms, zero if there is neither a run of at
+ * least two operators, nor a sequential or work-stealing run, nor an input
+ * operator followed by a run.
+ */
+template <typename ItType>
+static size_t add_fused(ff::ff_pipeline *p, ItType it, ItType end,  //
+                        StructureType st) {
+  base_UnaryOperator *source;
+  std::vector<base_UnaryOperator *> run;
+  size_t res = match_fused(it, end, st, source, run);
+  if (!res) return 0;
+
+  /*
+   * The group is executed at the highest parallelism in the group (the
+   * planner assigns the same degree to all of them, unless explicit).
+   */
+  bool stealing = false;
+  unsigned par = source ? source->pardeg() : 0;
+  for (auto op : run) {
+    stealing = stealing || op->stealing();
+    par = std::max(par, op->pardeg());
+  }
+  if (!source && !stealing && par > 1 && run.size() < 2) return 0;
+
+  /* build the fused stages */
+  std::vector<fused_stage *> stages;
+  for (auto op : run) stages.push_back(op->fused_kernel());
+
+  /* fuse the partial reduce */
+  auto red = it + res != end ? unary_operator(**(it + res)) : nullptr;
+  if (red && st == StructureType::BAG &&
+      opt_match(run.back(), red, FUSED_PREDUCE)) {
+    stages.push_back(red->fused_kernel());
+    ++res;
+  } else
+    red = nullptr;
+
+  /* build the fused node */
+  ff::ff_node *node;
+  auto args = opt_args_t{nullptr};
+  args.stages = &stages;
+  if (source)
+    node = source->opt_node(par, FUSED_SOURCE, st, args);
+  else if (stealing)
+    node = make_WorkStealingBatch(par, stages, st);
+  else
+    node = make_FusedBatch(par, stages, st);
+
+  /* merge the partial states by the reducers, unless merged by the node */
+  if (red && red->pardeg() > 1) {
+    args.node = node;
+    node = red->opt_node(par, FUSED_PREDUCE, st, args);
+  }
+  p->add_stage(node);
+
+  /* workers hold their own copies */
+  for (auto s : stages) delete s;
+
+  return res;
+}
+
 template <typename ItType>
 static bool add_optimized(ff::ff_pipeline *p, ItType it1, ItType it2,  //
                           StructureType st) {
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PICO_PARAM_HPP_
+#define PICO_PARAM_HPP_
+
+#include <memory>
+
+namespace pico {
+
+/**
+ * \ingroup op-api
+ *
+ * A parameter of an operator, bound to a value before each run of a Pipe
+ * (e.g., the input file of a compiled Pipe).
+ *
+ * Copies of a parameter share its value, so that the operators copied into a
+ * Pipe see the values bound by the user. Values must not be bound while the
+ * Pipe is running.
+ */
+template <typename T>
+class Param {
+ public:
+  Param(const T &value_ = T()) : value(std::make_shared<T>(value_)) {}
+
+  void bind(const T &value_) { *value = value_; }
+
+  const T &get() const { return *value; }
+
+ private:
+  std::shared_ptr<T> value;
+};
+
+} /* namespace pico */
+
+#endif /* PICO_PARAM_HPP_ */
@@ -56,11 +56,14 @@ static void print_dot_semantic_graph(SemanticGraph &, std::string);
  * forward declarations for execution
  */
 class FastFlowExecutor;
-static FastFlowExecutor *make_executor(const pico::Pipe &);
+static FastFlowExecutor *make_executor(const pico::Pipe &,
+                                       bool calibration = false);
 static void destroy_executor(FastFlowExecutor *);
+static void keep_executor_warm(FastFlowExecutor &);
 static void run_pipe(FastFlowExecutor &, run_mode);
 static double run_time(FastFlowExecutor &);
 static void print_executor_stats_(FastFlowExecutor &, std::ostream &os);
+static void print_executor_plan_(FastFlowExecutor &, std::ostream &os);
 
 namespace pico {
 
@@ -144,6 +147,8 @@ class Pipe {
     in_deg_ = copy.in_deg_;
     out_deg_ = copy.out_deg_;
     copy_struct_type(*this, copy.st_map);
+    planning_ = copy.planning_;
+    small_job_ = copy.small_job_;
 
     if (has_operator())
       term_value.op = copy.term_value.op->clone();
@@ -542,6 +547,65 @@ class Pipe {
     run_pipe(*executor, m);
   }
 
+  /**
+   * \ingroup pipe-api
+   * Enables parallelism planning: upon the next executions, the operators
+   * with no explicit parallelism share a global thread budget (PICO_THREADS,
+   * by default the number of cores), split by their cost (see
+   * ParallelismPlanner.hpp).
+   * Without planning, each of them runs at def_par() workers. Planning is also
+   * enabled for all the pipes by setting PICO_THREADS.
+   */
+  void plan() {
+    planning_ = true;
+
+    /* re-plan upon the next execution */
+    if (executor) destroy_executor(executor);
+    executor = nullptr;
+  }
+
+  /**
+   * \ingroup pipe-api
+   * Hints that the job is small: upon the next executions, the operators with
+   * no explicit parallelism run on a single worker, and runs of them are
+   * fused into sequential nodes (see ParallelismPlanner.hpp). Setting
+   * PICO_INLINE=1 hints all the pipes.
+   */
+  void small_job() {
+    small_job_ = true;
+
+    /* re-plan upon the next execution */
+    if (executor) destroy_executor(executor);
+    executor = nullptr;
+  }
+
+  /**
+   * \ingroup pipe-api
+   * Executes the Pipe once to measure the cost of each operator.
+   * Subsequent executions split the thread budget among operators with no
+   * explicit parallelism by the measured costs, as with plan().
+   */
+  void calibrate(run_mode m = run_mode::DEFAULT) {
+    assert(in_deg_ == 0 && out_deg_ == 0);
+    planning_ = true;
+    auto calibration_executor = make_executor(*this, true);
+    run_pipe(*calibration_executor, m);
+    destroy_executor(calibration_executor);
+
+    /* re-plan upon the next execution */
+    if (executor) destroy_executor(executor);
+    executor = nullptr;
+  }
+
+  /**
+   * \ingroup pipe-api
+   * Prints the parallelism degree assigned to each operator.
+   */
+  void print_plan(std::ostream &os = std::cout) {
+    if (!executor) executor = make_executor(*this);
+    print_executor_plan_(*executor, os);
+  }
+
   /**
    * \ingroup pipe-api
    * Return execution time of the application in milliseconds
@@ -584,6 +648,12 @@ class Pipe {
 
   const std::vector<Pipe *> &children() const { return children_; }
 
+  /* whether parallelism planning was enabled by plan() or calibrate() */
+  bool planning() const { return planning_; }
+
+  /* whether the job was hinted as small by small_job() */
+  bool is_small_job() const { return small_job_; }
+
  private:
   /* test data types for equality */
   inline bool same_data_type(TypeInfoRef t1, TypeInfoRef t2) const {
@@ -659,6 +729,9 @@ class Pipe {
   } term_value;
   std::vector<Pipe *> children_;
 
+  /* parallelism planning */
+  bool planning_ = false, small_job_ = false;
+
   /* semantic graph */
   SemanticGraph *semantic_graph = nullptr;
 
@@ -666,6 +739,43 @@ class Pipe {
   FastFlowExecutor *executor = nullptr;
 };
 
+/**
+ * \ingroup pipe-api
+ *
+ * A Pipe compiled for being executed many times (e.g., by a service).
+ *
+ * The executor is built once, and its threads are parked at the end of each
+ * run rather than terminated: a run only wakes them up.
+ * Each run reads the inputs bound to the parameters of the sources (see
+ * Param.hpp) at that time.
+ */
+class CompiledPipe {
+ public:
+  CompiledPipe(const Pipe &pipe_, run_mode m_ = run_mode::DEFAULT)
+      : pipe(pipe_), m(m_) {
+    assert(pipe.in_deg() == 0 && pipe.out_deg() == 0);
+    executor = make_executor(pipe);
+    keep_executor_warm(*executor);
+  }
+
+  ~CompiledPipe() { destroy_executor(executor); }
+
+  CompiledPipe(const CompiledPipe &) = delete;
+  CompiledPipe &operator=(const CompiledPipe &) = delete;
+
+  void run() { run_pipe(*executor, m); }
+
+  /**
+   * Return execution time of the last run in milliseconds
+   */
+  double pipe_time() { return run_time(*executor); }
+
+ private:
+  Pipe pipe;
+  run_mode m;
+  FastFlowExecutor *executor;
+};
+
 } /* namespace pico */
 
 #endif /* PIPE_HPP_ */
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PICO_SESSION_HPP_
+#define PICO_SESSION_HPP_
+
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+#include "pico/Pipe.hpp"
+#include "pico/defines/Global.hpp"
+
+/*
+ * forward declarations for execution on an open input
+ */
+static FastFlowExecutor *make_open_executor(const pico::Pipe &,
+                                            pico::StructureType);
+static void start_pipe(FastFlowExecutor &, run_mode,
+                       pico::base_microbatch::tag_t);
+static void offload_mb(FastFlowExecutor &, pico::base_microbatch *);
+static bool load_mb(FastFlowExecutor &, pico::base_microbatch *&, bool);
+static void stop_pipe(FastFlowExecutor &, pico::base_microbatch::tag_t);
+static void wait_pipe(FastFlowExecutor &);
+
+namespace pico {
+
+/**
+ * \ingroup pipe-api
+ *
+ * A Pipe embedded into an application, that feeds its input and consumes its
+ * output in-process.
+ *
+ * The Pipe must have an open input (i.e., no source) and either an open
+ * output (i.e., no sink), or a sink. Its structure type (e.g., STREAM for
+ * ordered processing) is given upon creation, since it cannot be inferred
+ * from a source.
+ *
+ * The executor is started upon creation. Records pushed by the application
+ * are batched into micro-batches, sent out when full or upon flush(): pushing
+ * blocks while the input buffer of the executor is full.
+ * The output must be pulled while pushing, since output buffers are bounded
+ * too (unless the Pipe ends with a sink).
+ *
+ * Push and pull may be called by different threads (e.g., an ingestion thread
+ * and a consumer thread); many threads pushing concurrently are serialized.
+ * Many threads may pull too: while one waits for the executor, the others
+ * get the output already received, and try_pull and done never block.
+ */
+template <typename In, typename Out = In>
+class Session {
+  typedef Microbatch<Token<In>> in_mb_t;
+  typedef Microbatch<Token<Out>> out_mb_t;
+
+ public:
+  Session(const Pipe &pipe_, StructureType st = StructureType::STREAM,
+          run_mode m = run_mode::DEFAULT)
+      : pipe(pipe_), tag(base_microbatch::fresh_tag()) {
+    assert(pipe.in_deg() == 1 && pipe.out_deg() <= 1);
+    executor = make_open_executor(pipe, st);
+    start_pipe(*executor, m, tag);
+    mb = NEW<in_mb_t>(tag, global_params.MICROBATCH_SIZE);
+  }
+
+  /* closes the input, while discarding the output not pulled */
+  ~Session() {
+    std::thread drain([this]() {
+      Out x;
+      while (pull(x))
+        ;
+    });
+    close();
+    drain.join();
+    wait_pipe(*executor);
+    destroy_executor(executor);
+  }
+
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  void push(const In &x) {
+    std::lock_guard<std::mutex> lock(push_mutex);
+    assert(!closed);
+    append(x);
+  }
+
+  /* pushes a batch of records, holding the input once */
+  void push(const std::vector<In> &xs) {
+    std::lock_guard<std::mutex> lock(push_mutex);
+    assert(!closed);
+    for (auto &x : xs) append(x);
+  }
+
+  /* sends out the pending records, for low latency */
+  void flush() {
+    std::lock_guard<std::mutex> lock(push_mutex);
+    if (!closed && !mb->empty()) send();
+  }
+
+  /* ends the input: no push is allowed afterwards */
+  void close() {
+    std::lock_guard<std::mutex> lock(push_mutex);
+    if (closed) return;
+    if (!mb->empty())
+      offload_mb(*executor, mb);
+    else
+      DELETE(mb);  // spurious microbatch
+    stop_pipe(*executor, tag);
+    closed = true;
+  }
+
+  /*
+   * Waits for an output record.
+   * Returns false at the end of the output (i.e., after close).
+   */
+  bool pull(Out &x) { return next(x, true); }
+
+  /* returns false if no output record is currently available */
+  bool try_pull(Out &x) { return next(x, false); }
+
+  /* true if the whole output has been pulled */
+  bool done() {
+    std::lock_guard<std::mutex> lock(pull_mutex);
+    return ended && out.empty();
+  }
+
+ private:
+  Pipe pipe;
+  base_microbatch::tag_t tag;
+  FastFlowExecutor *executor;
+
+  std::mutex push_mutex;
+  in_mb_t *mb;
+  bool closed = false;
+
+  std::mutex pull_mutex;  // guards the received output
+  std::deque<Out> out;
+  bool ended = false;
+
+  std::mutex load_mutex;  // held by the thread loading from the executor
+
+  void append(const In &x) {
+    new (mb->allocate()) In(x);
+    mb->commit();
+    if (mb->full()) send();
+  }
+
+  void send() {
+    offload_mb(*executor, mb);
+    mb = NEW<in_mb_t>(tag, global_params.MICROBATCH_SIZE);
+  }
+
+  bool next(Out &x, bool blocking) {
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(pull_mutex);
+        if (!out.empty()) {
+          x = std::move(out.front());
+          out.pop_front();
+          return true;
+        }
+        if (ended) return false;
+      }
+
+      /* a single thread loads, with no lock on the received output */
+      std::unique_lock<std::mutex> load(load_mutex, std::defer_lock);
+      if (blocking)
+        load.lock();
+      else if (!load.try_lock())
+        return false;
+      if (received()) continue;  // by the previous loader
+
+      base_microbatch *res;
+      if (!load_mb(*executor, res, blocking)) {
+        std::lock_guard<std::mutex> lock(pull_mutex);
+        ended = ended || blocking;  // end-of-stream
+        return false;
+      }
+      std::lock_guard<std::mutex> lock(pull_mutex);
+      if (is_sync(res->payload())) {
+        ended = ended || (res->payload() == PICO_END);
+        DELETE(res);
+      } else {
+        auto out_mb = reinterpret_cast<out_mb_t *>(res);
+        for (Out &y : *out_mb) out.push_back(std::move(y));
+        DELETE(out_mb);
+      }
+    }
+  }
+
+  bool received() {
+    std::lock_guard<std::mutex> lock(pull_mutex);
+    return ended || !out.empty();
+  }
+};
+
+} /* namespace pico */
+
+#endif /* PICO_SESSION_HPP_ */
@@ -30,7 +30,11 @@
 #include "pico/Operators/UnaryOperator.hpp"
 #include "pico/PEGOptimizations.hpp"
 #include "pico/Pipe.hpp"
+#include "pico/Session.hpp"
 
+#include "NumaPlacement.hpp"
+#include "ParallelismPlanner.hpp"
+#include "SupportFFNodes/FarmWiring.hpp"
 #include "SupportFFNodes/ForwardingNode.hpp"
 #include "SupportFFNodes/PairFarm.hpp"
 #include "SupportFFNodes/base_nodes.hpp"
@@ -76,6 +80,8 @@ static ff::ff_pipeline *make_ff_pipe(const pico::Pipe &p,
       op = p.get_operator_ptr();
       uop = dynamic_cast<pico::base_UnaryOperator *>(op);
       res->add_stage(uop->node_operator(uop->pardeg(), st));
+      if (op->busy_counter())
+        profile_node(res->getStages().back(), op->busy_counter().get());
       break;
     case pico::Pipe::TO:
       add_chain(res, p.children(), st);
@@ -108,6 +114,8 @@ static ff::ff_pipeline *make_ff_pipe(const pico::Pipe &p,
       bop = dynamic_cast<pico::base_BinaryOperator *>(op);
       bool left_input = p.children()[0]->in_deg();
       res->add_stage(bop->node_operator(bop->pardeg(), left_input, st));
+      if (op->busy_counter())
+        profile_node(res->getStages().back(), op->busy_counter().get());
       break;
   }
   return res;
@@ -152,48 +160,77 @@ ff::ff_farm<> *make_multito_farm(const Pipe &p) {
 void add_chain(ff::ff_pipeline *p, const std::vector<pico::Pipe *> &s,  //
                pico::StructureType st) {
   /* apply PEG optimizations */
+  ff::ff_pipeline chain;
   auto it = s.begin();
-  for (; it < s.end() - 1; ++it) {
+  while (it < s.end()) {
+    auto first = it;
+    auto from = chain.getStages().size();
+    /* try to fuse a run of stateless operators */
+    auto fused = add_fused(&chain, it, s.end(), st);
+    if (fused)
+      it += fused;
     /* try to add an optimized compound */
-    if (add_optimized(p, it, it + 1, st))
-      ++it;
+    else if (it < s.end() - 1 && add_optimized(&chain, it, it + 1, st))
+      it += 2;
     else
       /* add a regular sub-term */
-      add_plain(p, it, st);
+      add_plain(&chain, it++, st);
+    profile_stages(chain, from, first, it);
   }
-  /* add last sub-term if any */
-  if (it != s.end()) add_plain(p, it, st);
+
+  /* connect consecutive farms worker to worker */
+  ff::ff_node *prev = nullptr;
+  for (auto stage : chain.getStages()) {
+    auto wired = prev ? wire_farms(prev, stage) : nullptr;
+    if (wired)
+      prev = wired;
+    else {
+      if (prev) p->add_stage(prev);
+      prev = stage;
+    }
+  }
+  if (prev) p->add_stage(prev);
 }
 
 class FastFlowExecutor {
  public:
-  FastFlowExecutor(const pico::Pipe &p) {
-    ff_pipe = make_ff_pipe(p, p.structure_type(), true);
+  FastFlowExecutor(const pico::Pipe &p, bool calibration_,
+                   pico::StructureType st)
+      : planner(p, st), calibration(calibration_) {
+    /* assign parallelism degrees before building the nodes */
+    if (planner.small_job())
+      planner.plan_small();
+    else if (ParallelismPlanner::enabled(p))
+      planner.plan();
+    if (std::getenv("PICO_PRINT_PLAN")) planner.print(std::cerr);
+    if (calibration) planner.start_calibration();
+    ff_pipe = make_ff_pipe(p, st, true);
+    placement = new NumaPlacement(ff_pipe);
+  }
+
+  ~FastFlowExecutor() {
+    /* terminate the parked threads */
+    if (frozen) ff_pipe->wait();
+    delete placement;
+    delete_ff_term();
   }
 
-  ~FastFlowExecutor() { delete_ff_term(); }
+  /*
+   * Keeps the threads parked between runs, rather than terminating them, so
+   * that the next run only wakes them up.
+   */
+  void keep_warm() { warm = true; }
 
-  void run(run_mode m) const {
+  void run(run_mode m) {
     auto tag = pico::base_microbatch::nil_tag();
     pico::base_microbatch *res;
 
-    bool blocking = (m != run_mode::FORCE_NONBLOCKING);
+    if (!frozen) setup(m);
 
-    ff::OptLevel opt;
-    opt.remove_collector = true;
-    opt.verbose_level = 2;
-    if (blocking) {
-      ff_pipe->blocking_mode();
-      ff_pipe->no_mapping();
-    } else {
-      opt.max_nb_threads = ff_realNumCores();
-      opt.max_mapped_threads = opt.max_nb_threads;
-      opt.no_default_mapping = true;
-      opt.blocking_mode = true;
-    }
-    optimize_static(*ff_pipe, opt);
-
-    ff_pipe->run();
+    if (warm)
+      ff_pipe->run_then_freeze();
+    else
+      ff_pipe->run();
 
     ff_pipe->offload(make_sync(tag, PICO_BEGIN));
     ff_pipe->offload(make_sync(tag, PICO_END));
@@ -204,18 +241,81 @@ class FastFlowExecutor {
     assert(ff_pipe->load_result((void **)&res));
     assert(res->payload() == PICO_END && res->tag() == tag);
 
-    ff_pipe->wait();
+    if (warm) {
+      ff_pipe->wait_freezing();
+      frozen = true;
+    } else
+      ff_pipe->wait();
+
+    if (calibration) planner.end_calibration();
   }
 
+  /*
+   * Starts the executor on an open input, made of a single c-stream fed by
+   * offload() until stop().
+   */
+  void start(run_mode m, pico::base_microbatch::tag_t tag) {
+    setup(m);
+    ff_pipe->run();
+    ff_pipe->offload(make_sync(pico::base_microbatch::nil_tag(), PICO_BEGIN));
+    ff_pipe->offload(make_sync(tag, PICO_CSTREAM_BEGIN));
+  }
+
+  /* blocks while the input buffer of the pipeline is full */
+  void offload(pico::base_microbatch *mb) { ff_pipe->offload(mb); }
+
+  void stop(pico::base_microbatch::tag_t tag) {
+    ff_pipe->offload(make_sync(tag, PICO_CSTREAM_END));
+    ff_pipe->offload(make_sync(pico::base_microbatch::nil_tag(), PICO_END));
+    ff_pipe->offload(ff::FF_EOS);
+  }
+
+  /* returns false if no output is available (or upon end-of-stream) */
+  bool load(pico::base_microbatch *&mb, bool blocking) {
+    bool res;
+    if (blocking)
+      res = ff_pipe->load_result((void **)&mb);
+    else
+      res = ff_pipe->load_result_nb((void **)&mb);
+    return res && mb != ff::FF_EOS;
+  }
+
+  void wait() { ff_pipe->wait(); }
+
   double run_time() const { return ff_pipe->ffTime(); }
 
   void print_stats(std::ostream &os) const {
     if (ff_pipe) ff_pipe->ffStats(os);
+    if (placement) placement->print(os);
   }
 
+  void print_plan(std::ostream &os) const { planner.print(os); }
+
  private:
   // const Pipe &pipe;
+  ParallelismPlanner planner;
+  bool calibration, warm = false, frozen = false;
   ff::ff_pipeline *ff_pipe = nullptr;
+  NumaPlacement *placement = nullptr;
+
+  /* prepares the threads (once, if kept warm) */
+  void setup(run_mode m) {
+    bool blocking = (m != run_mode::FORCE_NONBLOCKING);
+
+    ff::OptLevel opt;
+    opt.remove_collector = true;
+    opt.verbose_level = 2;
+    if (blocking) {
+      ff_pipe->blocking_mode();
+      ff_pipe->no_mapping();
+    } else {
+      opt.max_nb_threads = ff_realNumCores();
+      opt.max_mapped_threads = opt.max_nb_threads;
+      opt.no_default_mapping = true;
+      opt.blocking_mode = true;
+    }
+    optimize_static(*ff_pipe, opt);
+  }
 
   void delete_ff_term() {
     if (ff_pipe)
@@ -224,21 +324,54 @@ class FastFlowExecutor {
   }
 };
 
-FastFlowExecutor *make_executor(const pico::Pipe &p) {
+FastFlowExecutor *make_executor(const pico::Pipe &p, bool calibration) {
   auto mb_env = std::getenv("MBSIZE");
   if (mb_env) pico::global_params.MICROBATCH_SIZE = atoi(mb_env);
 
-  return new FastFlowExecutor(p);
+  return new FastFlowExecutor(p, calibration, p.structure_type());
+}
+
+FastFlowExecutor *make_open_executor(const pico::Pipe &p,
+                                     pico::StructureType st) {
+  auto mb_env = std::getenv("MBSIZE");
+  if (mb_env) pico::global_params.MICROBATCH_SIZE = atoi(mb_env);
+
+  return new FastFlowExecutor(p, false, st);
 }
 
 void destroy_executor(FastFlowExecutor *e) { delete e; }
 
+void keep_executor_warm(FastFlowExecutor &e) { e.keep_warm(); }
+
 void run_pipe(FastFlowExecutor &e, run_mode m) { e.run(m); }
 
+void start_pipe(FastFlowExecutor &e, run_mode m,
+                pico::base_microbatch::tag_t tag) {
+  e.start(m, tag);
+}
+
+void offload_mb(FastFlowExecutor &e, pico::base_microbatch *mb) {
+  e.offload(mb);
+}
+
+bool load_mb(FastFlowExecutor &e, pico::base_microbatch *&mb, bool blocking) {
+  return e.load(mb, blocking);
+}
+
+void stop_pipe(FastFlowExecutor &e, pico::base_microbatch::tag_t tag) {
+  e.stop(tag);
+}
+
+void wait_pipe(FastFlowExecutor &e) { e.wait(); }
+
 double run_time(FastFlowExecutor &e) { return e.run_time(); }
 
 void print_executor_stats_(FastFlowExecutor &e, std::ostream &os) {
   e.print_stats(os);
 }
 
+void print_executor_plan_(FastFlowExecutor &e, std::ostream &os) {
+  e.print_plan(os);
+}
+
 #endif /* PICO_FASTFLOWEXECUTOR_HPP_ */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PICO_FF_IMPLEMENTATION_NUMAPLACEMENT_HPP_
+#define PICO_FF_IMPLEMENTATION_NUMAPLACEMENT_HPP_
+
+#include <cmath>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/pipeline.hpp>
+
+#include "NumaTopology.hpp"
+#include "SupportFFNodes/base_nodes.hpp"
+
+/*
+ * Places the threads of an ff pipeline on NUMA nodes.
+ *
+ * Threads are visited in dataflow order (stage by stage; emitter, workers and
+ * collector within a farm) and assigned to nodes in contiguous blocks, sized
+ * by the share of CPUs of each node. As a result:
+ * - consecutive stages, and the workers wired 1:1 across them, share a node
+ *   unless it is full, so that micro-batches are allocated (first-touched) on
+ *   the node of their consumer
+ * - the workers of a farm spanning several nodes are split in contiguous
+ *   ranges, so that each keyed partition is pinned to a node
+ *
+ * Nodes are restricted to the CPUs of their NUMA node at the beginning of each
+ * run. Only sync-handling nodes are restricted; other nodes (e.g., all-to-all
+ * building blocks) are counted but left to the OS scheduler.
+ */
+class NumaPlacement {
+ public:
+  NumaPlacement(ff::ff_pipeline *p,
+                const numa_topology &topology_ = numa_topology::instance())
+      : topology(topology_) {
+    if (topology.nodes() < 2) return;
+
+    auto &stages = p->getStages();
+    for (size_t i = 0; i < stages.size(); ++i) collect(stages[i], i);
+
+    /* nodes capacity, in threads */
+    std::vector<unsigned> capacity;
+    for (unsigned n = 0; n < topology.nodes(); ++n)
+      capacity.push_back(std::ceil((double)threads.size() *
+                                   topology.cpus(n).size() / topology.ncpus()));
+
+    unsigned node = 0, used = 0;
+    for (auto &t : threads) {
+      if (used == capacity[node] && node + 1 < topology.nodes()) {
+        ++node;
+        used = 0;
+      }
+      t.numa_node = node;
+      ++used;
+      if (auto f = dynamic_cast<sync_handler_filter *>(t.node))
+        f->place(&topology.cpus(node));
+    }
+  }
+
+  /* the NUMA node of each thread, in dataflow order (empty if single node) */
+  std::vector<unsigned> assignment() const {
+    std::vector<unsigned> res;
+    for (auto &t : threads) res.push_back(t.numa_node);
+    return res;
+  }
+
+  void print(std::ostream &os) const {
+    os << "=== NUMA Placement (" << topology.nodes() << " nodes)\n";
+    if (topology.nodes() < 2) return;
+    std::map<size_t, std::map<unsigned, unsigned>> per_stage;
+    for (auto &t : threads) ++per_stage[t.stage][t.numa_node];
+    for (auto &s : per_stage) {
+      os << "  stage " << s.first << ":";
+      for (auto &n : s.second)
+        os << " node " << n.first << " (" << n.second << " threads)";
+      os << "\n";
+    }
+  }
+
+ private:
+  struct thread_t {
+    ff::ff_node *node;
+    size_t stage;
+    unsigned numa_node;
+  };
+
+  const numa_topology &topology;
+  std::vector<thread_t> threads;
+
+  void collect(ff::ff_node *n, size_t stage) {
+    if (auto farm = dynamic_cast<ff::ff_farm *>(n)) {
+      if (farm->getEmitter()) collect(farm->getEmitter(), stage);
+      for (auto w : farm->getWorkers()) collect(w, stage);
+      if (farm->getCollector()) collect(farm->getCollector(), stage);
+    } else if (auto pipe = dynamic_cast<ff::ff_pipeline *>(n)) {
+      for (auto s : pipe->getStages()) collect(s, stage);
+    } else
+      threads.push_back(thread_t{n, stage, 0});
+  }
+};
+
+#endif /* PICO_FF_IMPLEMENTATION_NUMAPLACEMENT_HPP_ */
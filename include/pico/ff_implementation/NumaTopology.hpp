@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PICO_FF_IMPLEMENTATION_NUMATOPOLOGY_HPP_
+#define PICO_FF_IMPLEMENTATION_NUMATOPOLOGY_HPP_
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ff/node.hpp>
+
+/*
+ * The NUMA nodes of the machine and their CPUs, as exposed by sysfs.
+ * Machines with no NUMA information are seen as a single node.
+ *
+ * The sysfs tree is looked up under a root directory (by default, the root of
+ * the file system), so that a fake tree can be given for testing.
+ */
+class numa_topology {
+ public:
+  explicit numa_topology(const std::string &root = "") {
+    std::string nodes = root + "/sys/devices/system/node/node";
+    for (unsigned n = 0;; ++n) {
+      std::ifstream f(nodes + std::to_string(n) + "/cpulist");
+      if (!f) break;
+      std::string list;
+      std::getline(f, list);
+      auto cpus = parse_cpulist(list);
+      if (!cpus.empty()) node_cpus.push_back(cpus);
+    }
+
+    if (node_cpus.empty()) {
+      node_cpus.emplace_back();
+      for (int c = 0; c < ff_realNumCores(); ++c) node_cpus[0].push_back(c);
+    }
+  }
+
+  /* the topology of the machine */
+  static const numa_topology &instance() {
+    static numa_topology t;
+    return t;
+  }
+
+  unsigned nodes() const { return node_cpus.size(); }
+
+  const std::vector<int> &cpus(unsigned node) const { return node_cpus[node]; }
+
+  unsigned ncpus() const {
+    unsigned res = 0;
+    for (auto &c : node_cpus) res += c.size();
+    return res;
+  }
+
+ private:
+  std::vector<std::vector<int>> node_cpus;
+
+  /* parses lists such as "0-7,16-23" */
+  static std::vector<int> parse_cpulist(const std::string &list) {
+    std::vector<int> res;
+    std::istringstream is(list);
+    std::string range;
+    while (std::getline(is, range, ',')) {
+      if (range.empty()) continue;
+      auto dash = range.find('-');
+      int first = atoi(range.c_str());
+      int last = dash == std::string::npos ? first
+                                           : atoi(range.c_str() + dash + 1);
+      for (int c = first; c <= last; ++c) res.push_back(c);
+    }
+    return res;
+  }
+};
+
+/*
+ * Restricts the calling thread to a set of CPUs.
+ */
+static void pin_thread(const std::vector<int> &cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto c : cpus) CPU_SET(c, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpus;
+#endif
+}
+
+#endif /* PICO_FF_IMPLEMENTATION_NUMATOPOLOGY_HPP_ */
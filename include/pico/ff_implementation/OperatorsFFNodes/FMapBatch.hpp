@@ -27,6 +27,7 @@
 #include "pico/Internals/TimedToken.hpp"
 #include "pico/Internals/utils.hpp"
 
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
 #include "pico/ff_implementation/SupportFFNodes/emitters.hpp"
 
 template <typename In, typename Out, typename Farm, typename TokenTypeIn,
@@ -35,16 +36,23 @@ class FMapBatch : public Farm {
  public:
   FMapBatch(int par,
             std::function<void(In &, pico::FlatMapCollector<Out> &)> flatmapf) {
-    ff::ff_node *e;
-    if (this->isOFarm())
+    ff::ff_node *e, *c;
+    /*
+     * ordering farms must send one output per input, so that workers pack the
+     * collected micro-batches and the collector unpacks them
+     */
+    bool pack = this->isOFarm();
+    if (pack) {
       e = new OrdForwardingEmitter(par);
-    else
+      c = new UnpackingCollector<pico::TokenCollector<Out>>(par);
+    } else {
       e = new ForwardingEmitter(par);
-    auto c = new UnpackingCollector<pico::TokenCollector<Out>>(par);
+      c = new ForwardingCollector(par);
+    }
     this->setEmitterF(e);
     this->setCollectorF(c);
     std::vector<ff::ff_node *> w;
-    for (int i = 0; i < par; ++i) w.push_back(new Worker(flatmapf));
+    for (int i = 0; i < par; ++i) w.push_back(new Worker(flatmapf, pack));
     this->add_workers(w);
     this->cleanup_all();
   }
@@ -54,8 +62,9 @@ class FMapBatch : public Farm {
     typedef typename pico::TokenCollector<Out>::cnode cnode_t;
 
    public:
-    Worker(std::function<void(In &, pico::FlatMapCollector<Out> &)> kernel_)
-        : mkernel(kernel_) {}
+    Worker(std::function<void(In &, pico::FlatMapCollector<Out> &)> kernel_,
+           bool pack_)
+        : mkernel(kernel_), pack(pack_) {}
 
     void kernel(pico::base_microbatch *mb) {
       auto in_mb = reinterpret_cast<pico::Microbatch<TokenTypeIn> *>(mb);
@@ -65,8 +74,18 @@ class FMapBatch : public Farm {
       for (In &tt : *in_mb) {
         mkernel(tt, collector);
       }
-      if (collector.begin())
+      if (pack && collector.begin())
         ff_send_out(NEW<pico::mb_wrapped<cnode_t>>(tag, collector.begin()));
+      else if (!pack) {
+        /* send out all the micro-batches in the list */
+        cnode_t *it_, *it = collector.begin();
+        while (it) {
+          ff_send_out(reinterpret_cast<void *>(it->mb));
+          it_ = it;
+          it = it->next;
+          FREE(it_);
+        }
+      }
 
       // clean up
       DELETE(in_mb);
@@ -76,6 +95,7 @@ class FMapBatch : public Farm {
    private:
     pico::TokenCollector<Out> collector;
     std::function<void(In &, pico::FlatMapCollector<Out> &)> mkernel;
+    bool pack;
   };
 };
 
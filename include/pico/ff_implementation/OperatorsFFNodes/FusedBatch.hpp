@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_FUSEDBATCH_HPP_
+#define INTERNALS_FFOPERATORS_FUSEDBATCH_HPP_
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <ff/combine.hpp>
+#include <ff/farm.hpp>
+
+#include "pico/FlatMapCollector.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/RBKOptFarm.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/emitters.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+namespace pico {
+
+/*
+ * A fused stage applies the kernel of an operator to a whole micro-batch, so
+ * that a run of operators can be executed by a single worker (e.g., a farm
+ * worker or a reader), with no queues in between.
+ *
+ * A stage takes ownership of the input micro-batch and passes each output
+ * micro-batch to the emit function, that is bound to the next stage.
+ * Stateful stages (e.g., partial reduce) emit their state upon c-stream end.
+ */
+class fused_stage {
+ public:
+  typedef std::function<void(base_microbatch *)> emit_t;
+
+  virtual ~fused_stage() {}
+
+  virtual void process(base_microbatch *in_mb, emit_t &emit) = 0;
+
+  virtual void cstream_end(base_microbatch::tag_t, emit_t &) {}
+
+  /*
+   * Returns a new stage merging the states emitted by several instances of
+   * the stage, if they need merging.
+   */
+  virtual fused_stage *merge_stage() { return nullptr; }
+
+  /* stages may hold per-worker state, thus each worker gets its own copy */
+  virtual fused_stage *clone() = 0;
+};
+
+typedef std::vector<fused_stage *> fused_stages;
+
+template <typename TokenTypeIn, typename TokenTypeOut>
+class map_stage : public fused_stage {
+  typedef typename TokenTypeIn::datatype In;
+  typedef typename TokenTypeOut::datatype Out;
+  typedef Microbatch<TokenTypeIn> mb_in;
+  typedef Microbatch<TokenTypeOut> mb_out;
+
+ public:
+  map_stage(std::function<Out(In &)> mapf_) : mapf(mapf_) {}
+
+  void process(base_microbatch *in_mb, emit_t &emit) {
+    auto in_microbatch = reinterpret_cast<mb_in *>(in_mb);
+    auto tag = in_mb->tag();
+    auto out_mb = NEW<mb_out>(tag, global_params.MICROBATCH_SIZE);
+    for (In &in : *in_microbatch) {
+      new (out_mb->allocate()) Out(mapf(in));
+      out_mb->commit();
+      if (out_mb->full()) {
+        emit(out_mb);
+        out_mb = NEW<mb_out>(tag, global_params.MICROBATCH_SIZE);
+      }
+    }
+    DELETE(in_microbatch);
+    if (!out_mb->empty())
+      emit(out_mb);
+    else
+      DELETE(out_mb);
+  }
+
+  map_stage *clone() { return new map_stage(mapf); }
+
+ private:
+  std::function<Out(In &)> mapf;
+};
+
+template <typename TokenTypeIn, typename TokenTypeOut>
+class flatmap_stage : public fused_stage {
+  typedef typename TokenTypeIn::datatype In;
+  typedef typename TokenTypeOut::datatype Out;
+  typedef Microbatch<TokenTypeIn> mb_in;
+  typedef typename TokenCollector<Out>::cnode cnode_t;
+
+ public:
+  flatmap_stage(std::function<void(In &, FlatMapCollector<Out> &)> flatmapf_)
+      : flatmapf(flatmapf_) {}
+
+  void process(base_microbatch *in_mb, emit_t &emit) {
+    auto in_microbatch = reinterpret_cast<mb_in *>(in_mb);
+    collector.tag(in_mb->tag());
+    for (In &in : *in_microbatch) flatmapf(in, collector);
+    DELETE(in_microbatch);
+
+    /* hand over the collected micro-batches */
+    cnode_t *it_, *it = collector.begin();
+    collector.clear();
+    while (it) {
+      emit(it->mb);
+      it_ = it;
+      it = it->next;
+      FREE(it_);
+    }
+  }
+
+  flatmap_stage *clone() { return new flatmap_stage(flatmapf); }
+
+ private:
+  std::function<void(In &, FlatMapCollector<Out> &)> flatmapf;
+  TokenCollector<Out> collector;
+};
+
+/*
+ * Reduces by key the whole c-stream, then upon c-stream end emits the state
+ * partitioned by key: each micro-batch only holds keys belonging to a given
+ * reducer, as expected by the RBK_farm emitter.
+ */
+template <typename TokenType>
+class preduce_stage : public fused_stage {
+  typedef typename TokenType::datatype KV;
+  typedef typename KV::keytype K;
+  typedef typename KV::valuetype V;
+  typedef Microbatch<TokenType> mb_t;
+
+ public:
+  preduce_stage(std::function<V(V &, V &)> reducef_, unsigned red_par_)
+      : reducef(reducef_), red_par(red_par_) {}
+
+  void process(base_microbatch *in_mb, emit_t &) {
+    auto &s(tag_state[in_mb->tag()]);
+    auto in_microbatch = reinterpret_cast<mb_t *>(in_mb);
+    for (KV &kv : *in_microbatch) {
+      auto it = s.find(kv.Key());
+      if (it != s.end())
+        it->second = reducef(kv.Value(), it->second);
+      else
+        s.emplace(kv.Key(), kv.Value());
+    }
+    DELETE(in_microbatch);
+  }
+
+  void cstream_end(base_microbatch::tag_t tag, emit_t &emit) {
+    std::vector<mb_t *> red_mb(red_par, nullptr);
+    for (auto &kv : tag_state[tag]) {
+      auto dst = std::hash<K>{}(kv.first) % red_par;
+      if (!red_mb[dst]) red_mb[dst] = NEW<mb_t>(tag, mb_size);
+      new (red_mb[dst]->allocate()) KV(kv.first, kv.second);
+      red_mb[dst]->commit();
+      if (red_mb[dst]->full()) {
+        emit(red_mb[dst]);
+        red_mb[dst] = nullptr;
+      }
+    }
+    tag_state.erase(tag);
+
+    /* remainder */
+    for (auto mb : red_mb)
+      if (mb) emit(mb);
+  }
+
+  /* with a single reducer, the partial states are merged by another stage */
+  fused_stage *merge_stage() {
+    return red_par == 1 ? new preduce_stage(reducef, 1) : nullptr;
+  }
+
+  preduce_stage *clone() { return new preduce_stage(reducef, red_par); }
+
+ private:
+  std::function<V(V &, V &)> reducef;
+  unsigned red_par;
+  int mb_size = global_params.MICROBATCH_SIZE;
+  std::unordered_map<base_microbatch::tag_t, std::unordered_map<K, V>>
+      tag_state;
+};
+
+/*
+ * A worker-local instance of a run of fused stages.
+ */
+class fused_chain {
+ public:
+  fused_chain(const fused_stages &proto, fused_stage::emit_t sink) {
+    assert(!proto.empty());
+    for (auto s : proto) stages.push_back(s->clone());
+    emits.resize(stages.size());
+    for (size_t i = 0; i + 1 < stages.size(); ++i)
+      emits[i] = [this, i](base_microbatch *mb) {
+        stages[i + 1]->process(mb, emits[i + 1]);
+      };
+    emits.back() = sink;
+  }
+
+  ~fused_chain() {
+    for (auto s : stages) delete s;
+  }
+
+  fused_chain(const fused_chain &) = delete;
+  fused_chain &operator=(const fused_chain &) = delete;
+
+  inline void process(base_microbatch *in_mb) {
+    stages.front()->process(in_mb, emits.front());
+  }
+
+  /* flushes the stages in order, so that each flush reaches the next ones */
+  void cstream_end(base_microbatch::tag_t tag) {
+    for (size_t i = 0; i < stages.size(); ++i)
+      stages[i]->cstream_end(tag, emits[i]);
+  }
+
+ private:
+  fused_stages stages;
+  std::vector<fused_stage::emit_t> emits;
+};
+
+/*
+ * The output of a node, either sent as it is or through a run of fused stages
+ * (if any).
+ */
+class fused_output {
+ public:
+  fused_output(const fused_stages &stages, fused_stage::emit_t send_)
+      : send_f(send_) {
+    if (!stages.empty()) chain.reset(new fused_chain(stages, send_));
+  }
+
+  inline void send(base_microbatch *mb) {
+    if (chain)
+      chain->process(mb);
+    else
+      send_f(mb);
+  }
+
+  void cstream_end(base_microbatch::tag_t tag) {
+    if (chain) chain->cstream_end(tag);
+  }
+
+ private:
+  fused_stage::emit_t send_f;
+  std::unique_ptr<fused_chain> chain;
+};
+
+} /* namespace pico */
+
+/* merges the states emitted by the workers of a farm by a fused stage */
+class FusedCollector : public base_sync_duplicate {
+ public:
+  FusedCollector(unsigned nw, pico::fused_stage *merge)
+      : base_sync_duplicate(nw),
+        out(pico::fused_stages{merge},
+            [this](pico::base_microbatch *mb) { ff_send_out(mb); }) {
+    delete merge;
+  }
+
+  void kernel(pico::base_microbatch *mb) { out.send(mb); }
+
+  void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+    out.cstream_end(tag);
+  }
+
+ private:
+  pico::fused_output out;
+};
+
+/* the collector of a farm whose workers run some fused stages */
+static ff::ff_node *make_fused_collector(unsigned nw,
+                                         const pico::fused_stages &stages) {
+  auto merge = stages.empty() ? nullptr : stages.back()->merge_stage();
+  if (merge) return new FusedCollector(nw, merge);
+  return new ForwardingCollector(nw);
+}
+
+/* streams out the lists of micro-batches produced by ordered fused workers */
+class BatchListCollector : public base_sync_duplicate {
+  typedef std::vector<pico::base_microbatch *> list_t;
+
+ public:
+  using base_sync_duplicate::base_sync_duplicate;
+
+  void kernel(pico::base_microbatch *mb) {
+    auto wmb = reinterpret_cast<pico::mb_wrapped<list_t> *>(mb);
+    for (auto out_mb : *wmb->get()) ff_send_out(out_mb);
+    DELETE(wmb->get());
+    DELETE(wmb);
+  }
+};
+
+/*
+ * The farm executing a run of fused operators.
+ *
+ * On ordered farms, each worker sends out exactly one (possibly empty) list of
+ * micro-batches per input micro-batch, thus only stateless stages are allowed.
+ */
+template <typename Farm>
+class FusedBatch : public Farm {
+  typedef std::vector<pico::base_microbatch *> list_t;
+
+ public:
+  FusedBatch(int par, const pico::fused_stages &stages) {
+    ff::ff_node *e, *c;
+    if (this->isOFarm()) {
+      e = new OrdForwardingEmitter(par);
+      c = new BatchListCollector(par);
+    } else {
+      e = new ForwardingEmitter(par);
+      c = make_fused_collector(par, stages);
+    }
+    this->setEmitterF(e);
+    this->setCollectorF(c);
+    std::vector<ff::ff_node *> w;
+    for (int i = 0; i < par; ++i)
+      w.push_back(new Worker(stages, this->isOFarm()));
+    this->add_workers(w);
+    this->cleanup_all();
+  }
+
+ private:
+  class Worker : public base_filter {
+   public:
+    Worker(const pico::fused_stages &stages, bool ordered_)
+        : ordered(ordered_),
+          chain(stages, [this](pico::base_microbatch *mb) {
+            if (ordered)
+              out_list->push_back(mb);
+            else
+              ff_send_out(mb);
+          }) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto tag = in_mb->tag();
+      if (ordered) out_list = NEW<list_t>();
+      chain.process(in_mb);
+      if (ordered) ff_send_out(NEW<pico::mb_wrapped<list_t>>(tag, out_list));
+    }
+
+    void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+      if (!ordered) chain.cstream_end(tag);
+    }
+
+   private:
+    bool ordered;
+    list_t *out_list = nullptr;
+    pico::fused_chain chain;
+  };
+};
+
+using FusedBatchStream = FusedBatch<OrderingFarm>;
+using FusedBatchBag = FusedBatch<NonOrderingFarm>;
+
+/* a run of fused operators executed by a single node, preserving order */
+class FusedSeq : public base_filter {
+ public:
+  FusedSeq(const pico::fused_stages &stages)
+      : chain(stages, [this](pico::base_microbatch *mb) { ff_send_out(mb); }) {}
+
+  void kernel(pico::base_microbatch *in_mb) { chain.process(in_mb); }
+
+  void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+    chain.cstream_end(tag);
+  }
+
+ private:
+  pico::fused_chain chain;
+};
+
+static ff::ff_node *make_FusedBatch(int par, const pico::fused_stages &stages,
+                                    pico::StructureType st) {
+  if (par == 1) return new FusedSeq(stages);
+  if (st == pico::StructureType::STREAM)
+    return new FusedBatchStream(par, stages);
+  assert(st == pico::StructureType::BAG);
+  return new FusedBatchBag(par, stages);
+}
+
+/*
+ * Merges the partial states emitted by the fused (preduce_stage) workers of a
+ * node by the reduce-by-key farm.
+ * The workers of a farm are connected to the reducers with the same shuffling
+ * as MRBK_par_red, while a sequential node is followed by the reducers.
+ */
+template <typename TokenType>
+class FusedPReduce_par_red : public ff::ff_pipeline {
+  typedef typename TokenType::datatype KV;
+  typedef typename KV::valuetype V;
+  typedef typename RBK_farm<TokenType>::Emitter emitter_t;
+
+ public:
+  FusedPReduce_par_red(ff::ff_node *node, int par, int red_par,
+                       std::function<V(V &, V &)> red_f) {
+    auto farm = dynamic_cast<ff::ff_farm *>(node);
+    if (farm) {
+      auto rbk_farm = new RBK_farm<TokenType>(par, red_par, red_f);
+      auto emitter = reinterpret_cast<emitter_t *>(rbk_farm->getEmitter());
+      auto combined_farm = ff::combine_farms<emitter_t, emitter_t>(
+          *farm, emitter, *rbk_farm, nullptr, false);
+      this->add_stage(combined_farm);
+    } else {
+      this->add_stage(node);
+      this->add_stage(new RBK_farm<TokenType>(1, red_par, red_f));
+    }
+    this->cleanup_nodes();
+  }
+};
+
+#endif /* INTERNALS_FFOPERATORS_FUSEDBATCH_HPP_ */
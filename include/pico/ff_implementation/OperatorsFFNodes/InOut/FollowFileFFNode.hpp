@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_FOLLOWFILEFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_FOLLOWFILEFFNODE_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <ff/node.hpp>
+
+#include "pico/Internals/LineBuffer.hpp"
+#include "pico/Internals/LineFilter.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/* maximum size (in bytes) of the reads from the followed file */
+#define FOLLOW_READ_SIZE (1 << 20)
+
+/* time (in milliseconds) a non-full micro-batch may wait for sending */
+#define FOLLOW_LINGER_MS 10
+
+/* period (in milliseconds) of checkpointing and of idle checks */
+#define FOLLOW_CHECKPOINT_MS 1000
+
+/*
+ * The persistent read position within a followed file.
+ *
+ * The position is stored with the inode of the file, so that a position
+ * referring to a file rotated away in the meanwhile is not applied to the
+ * new file. Positions are written to a temporary file, then renamed over
+ * the checkpoint file, so a checkpoint is never found half-written.
+ */
+class follow_checkpoint {
+ public:
+  follow_checkpoint(std::string path_) : path(path_) {}
+
+  bool enabled() const { return !path.empty(); }
+
+  bool load(ino_t &ino, off_t &off) const {
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    unsigned long long i;
+    long long o;
+    bool res = (fscanf(f, "%llu %lld", &i, &o) == 2);
+    fclose(f);
+    ino = i;
+    off = o;
+    return res;
+  }
+
+  void store(ino_t ino, off_t off) const {
+    std::string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (!f) {
+      perror("ERROR writing checkpoint");
+      exit(1);
+    }
+    fprintf(f, "%llu %lld\n", (unsigned long long)ino, (long long)off);
+    fflush(f);
+    fsync(fileno(f));
+    fclose(f);
+    if (rename(tmp.c_str(), path.c_str())) {
+      perror("ERROR writing checkpoint");
+      exit(1);
+    }
+  }
+
+ private:
+  std::string path;
+};
+
+/*
+ * Follows a growing text file, as tail -F does, and streams its lines.
+ *
+ * Appended bytes are read by large positioned reads, with no copy other than
+ * building each line within the micro-batch. Between reads, the node sleeps
+ * on an inotify watch of the file directory (periodic polling elsewhere),
+ * that also catches rotations:
+ * - if the path is renamed or removed, the old file is read to the end,
+ *   then the new file at the same path is followed from the beginning
+ * - if the file is truncated in place, it is read again from the beginning
+ *
+ * Lines not matching the filter, if any, are skipped before being built.
+ * Micro-batches are sent once full, or once the linger time expired.
+ * The position after the last sent line is checkpointed periodically, so
+ * that a restarted job resumes from there. The stream ends after the file
+ * has been idle for the given time, if any.
+ */
+class FollowFileFFNode : public base_filter {
+  typedef pico::Microbatch<pico::Token<std::string>> mb_t;
+  typedef std::chrono::steady_clock steady;
+
+ public:
+  FollowFileFFNode(std::string fname_, std::string checkpoint_,
+                   unsigned idle_ms_,
+                   const pico::line_filter &filter_ = pico::line_filter())
+      : fname(fname_),
+        checkpoint(checkpoint_),
+        idle(idle_ms_),
+        filter(filter_),
+        buf(FOLLOW_READ_SIZE) {}
+
+  void kernel(pico::base_microbatch *) { assert(false); }
+
+  void begin_callback() {
+    tag = pico::base_microbatch::fresh_tag();
+    begin_cstream(tag);
+    watch();
+
+    auto last_data = steady::now(), last_checkpoint = last_data;
+    bool resume = checkpoint.enabled();
+    while (true) {
+      if (fd < 0) {
+        open_file(resume);
+        if (fd >= 0) resume = false;
+      }
+
+      bool got = false;
+      if (fd >= 0) {
+        got = drain();
+        if (replaced()) {
+          /* the old file is complete */
+          got |= drain();
+          const char *rec;
+          size_t len;
+          if (buf.remainder(rec, len)) emit(rec, len);
+          flush();
+          ::close(fd);
+          fd = -1;
+          sent = done = pos = 0;
+        } else if (truncated()) {
+          flush();
+          buf.consume(buf.size());
+          sent = done = pos = 0;
+          continue;
+        }
+      }
+
+      auto now = steady::now();
+      if (got) last_data = now;
+      if (mb && now - mb_since >= std::chrono::milliseconds(FOLLOW_LINGER_MS))
+        flush();
+      if (now - last_checkpoint >=
+          std::chrono::milliseconds(FOLLOW_CHECKPOINT_MS)) {
+        store_checkpoint();
+        last_checkpoint = now;
+      }
+      if (idle && now - last_data >= std::chrono::milliseconds(idle)) break;
+
+      if (!got) wait(mb ? FOLLOW_LINGER_MS : poll_ms());
+    }
+
+    flush();
+    store_checkpoint();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    unwatch();
+    end_cstream(tag);
+  }
+
+ private:
+  std::string fname;
+  follow_checkpoint checkpoint;
+  unsigned idle;
+  pico::line_filter filter;
+  pico::LineBuffer buf;
+  int fd = -1, watch_fd = -1;
+  ino_t ino = 0;
+  off_t pos = 0;   // next byte to be read
+  off_t done = 0;  // next byte after the last emitted line
+  off_t sent = 0;  // next byte after the last sent line
+  mb_t *mb = nullptr;
+  steady::time_point mb_since;
+  pico::base_microbatch::tag_t tag = 0;  // a tag for the generated collection
+
+  unsigned poll_ms() const {
+    return idle ? std::min(idle, (unsigned)FOLLOW_CHECKPOINT_MS)
+                : FOLLOW_CHECKPOINT_MS;
+  }
+
+  void open_file(bool resume) {
+    fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) return;  // not (re)created yet
+    struct stat st;
+    fstat(fd, &st);
+    ino = st.st_ino;
+    ino_t ckpt_ino;
+    off_t ckpt_off;
+    if (resume && checkpoint.load(ckpt_ino, ckpt_off) && ckpt_ino == ino &&
+        ckpt_off <= st.st_size)
+      sent = done = pos = ckpt_off;
+  }
+
+  /* reads up to the current end of file, returns true if any byte was read */
+  bool drain() {
+    auto read_f = [this](char *p, size_t size) {
+      ssize_t n;
+      do
+        n = pread(fd, p, size, pos);
+      while (n < 0 && errno == EINTR);
+      if (n > 0) pos += n;
+      return n;
+    };
+    const char *rec;
+    size_t len;
+    ssize_t n;
+    bool got = false;
+    while ((n = buf.fill(read_f)) > 0) {
+      got = true;
+      while (buf.next('\n', rec, len)) {
+        done += len + 1;
+        emit(rec, len);
+      }
+    }
+    if (n < 0) {
+      perror("ERROR reading followed file");
+      exit(1);
+    }
+    return got;
+  }
+
+  /* checks whether the path refers to another file (or to none) */
+  bool replaced() const {
+    struct stat st;
+    return stat(fname.c_str(), &st) || st.st_ino != ino;
+  }
+
+  bool truncated() const {
+    struct stat st;
+    return !fstat(fd, &st) && st.st_size < pos;
+  }
+
+  void store_checkpoint() {
+    if (checkpoint.enabled() && fd >= 0) checkpoint.store(ino, sent);
+  }
+
+  inline void emit(const char *rec, size_t len) {
+    if (!filter.empty() && !filter.match(rec, len)) return;
+    if (!mb) {
+      mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+      mb_since = steady::now();
+    }
+    new (mb->allocate()) std::string(rec, len);
+    mb->commit();
+    if (mb->full()) flush();
+  }
+
+  /* sends the pending lines, that may be checkpointed afterwards */
+  void flush() {
+    if (mb) send_mb(mb);
+    mb = nullptr;
+    sent = done;
+  }
+
+  /*
+   * Watches the directory of the file, that reports both modifications of
+   * the file and rotations.
+   */
+  void watch() {
+#ifdef __linux__
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd < 0) return;
+    std::string path(fname);
+    std::string dir(dirname(&path[0]));
+    if (inotify_add_watch(watch_fd, dir.c_str(),
+                          IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM |
+                              IN_DELETE | IN_ATTRIB) < 0) {
+      ::close(watch_fd);
+      watch_fd = -1;
+    }
+#endif
+  }
+
+  void unwatch() {
+    if (watch_fd >= 0) ::close(watch_fd);
+    watch_fd = -1;
+  }
+
+  /* sleeps until the directory changes, or for at most ms milliseconds */
+  void wait(unsigned ms) {
+    if (watch_fd < 0) {
+      poll(nullptr, 0, std::min(ms, 100u));
+      return;
+    }
+    struct pollfd p = {watch_fd, POLLIN, 0};
+    if (poll(&p, 1, ms) > 0) {
+      /* events are not inspected: the file state is checked anyway */
+      char events[4096];
+      while (::read(watch_fd, events, sizeof(events)) > 0) {
+      }
+    }
+  }
+};
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_FOLLOWFILEFFNODE_HPP_ */
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_READBINARYFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_READBINARYFFNODE_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/BinaryFormat.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/*
+ * A read-only memory mapping of a binary file.
+ */
+class binary_mapping {
+ public:
+  binary_mapping(std::string fname) {
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+      fprintf(stderr, "Unable to open input file %s\n", fname.c_str());
+      exit(1);
+    }
+    size = st.st_size;
+    if (size < sizeof(pico::binary_file_header)) {
+      fprintf(stderr, "Not a binary file %s\n", fname.c_str());
+      exit(1);
+    }
+    ptr = (char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+      perror("ERROR mapping input file");
+      exit(1);
+    }
+    madvise(ptr, size, MADV_SEQUENTIAL);
+    ::close(fd);
+  }
+
+  ~binary_mapping() { munmap(ptr, size); }
+
+  binary_mapping(const binary_mapping &) = delete;
+  binary_mapping &operator=(const binary_mapping &) = delete;
+
+  const pico::binary_file_header &header() const {
+    return *reinterpret_cast<const pico::binary_file_header *>(ptr);
+  }
+
+  /*
+   * Calls f(offset) for each block, by only reading block headers.
+   */
+  template <typename F>
+  void for_each_block(F &&f) const {
+    size_t off = sizeof(pico::binary_file_header);
+    while (off + sizeof(pico::binary_block_header) <= size) {
+      pico::binary_block b(ptr + off);
+      assert(b.header().bytes && off + b.header().bytes <= size);
+      f(off);
+      off += b.header().bytes;
+    }
+  }
+
+  inline pico::binary_block block(size_t offset) const {
+    return pico::binary_block(ptr + offset);
+  }
+
+ private:
+  char *ptr;
+  size_t size;
+};
+
+/*
+ * User-provided filters on blocks and records (e.g., by key range).
+ */
+template <typename T>
+struct binary_filters {
+  std::function<bool(const pico::binary_block &)> block;
+  std::function<bool(const T &)> record;
+};
+
+/*
+ * Copies the records of a block into micro-batches.
+ * No parsing takes place: records are built straight from the mapped bytes.
+ */
+template <typename T>
+class binary_decoder {
+  typedef pico::binary_codec<T> codec;
+  typedef pico::Microbatch<pico::Token<T>> mb_t;
+
+ public:
+  binary_decoder(const binary_filters<T> &filters_) : filters(filters_) {}
+
+  /* calls send(mb) on each complete micro-batch */
+  template <typename Send>
+  void decode(const pico::binary_block &b, pico::base_microbatch::tag_t tag,
+              Send &&send) {
+    if (filters.block && !filters.block(b)) return;
+    const char *payload = b.payload(codec::key_size);
+    size_t count = b.count();
+    for (size_t i = 0; i < count; ++i) {
+      if (!mb) mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+      if (filters.record) {
+        alignas(T) char tmp[sizeof(T)];
+        T *x = (T *)tmp;
+        codec::read(payload, count, i, x);
+        bool keep = filters.record(*x);
+        if (keep) new (mb->allocate()) T(std::move(*x));
+        x->~T();
+        if (!keep) continue;
+      } else
+        codec::read(payload, count, i, mb->allocate());
+      mb->commit();
+      if (mb->full()) {
+        send(mb);
+        mb = nullptr;
+      }
+    }
+  }
+
+  /* sends out the remainder micro-batch */
+  template <typename Send>
+  void flush(Send &&send) {
+    if (mb && !mb->empty())
+      send(mb);
+    else if (mb)
+      DELETE(mb);
+    mb = nullptr;
+  }
+
+ private:
+  binary_filters<T> filters;
+  mb_t *mb = nullptr;
+};
+
+/**
+ * The ReadBinary non-ordering farm.
+ * The emitter scans the block headers and dispatches blocks to the workers.
+ */
+template <typename T>
+class ReadBinaryFFNode_par : public NonOrderingFarm {
+  typedef std::shared_ptr<binary_mapping> mapping_t;
+
+ public:
+  ReadBinaryFFNode_par(int par, mapping_t file,
+                       const binary_filters<T> &filters) {
+    std::vector<ff::ff_node *> workers;
+    for (int i = 0; i < par; ++i) workers.push_back(new Worker(file, filters));
+    this->setEmitterF(new Scanner(file, filters, par));
+    this->add_workers(workers);
+    this->setCollectorF(new ForwardingCollector(par));
+    this->cleanup_all();
+  }
+
+ private:
+  class Scanner : public base_emitter {
+   public:
+    Scanner(mapping_t file_, const binary_filters<T> &filters_, unsigned nw)
+        : base_emitter(nw), file(file_), filters(filters_) {}
+
+    void begin_callback() {
+      auto tag = pico::base_microbatch::fresh_tag();
+      begin_cstream(tag);
+      file->for_each_block([&](size_t off) {
+        /* prune blocks before dispatching them */
+        if (filters.block && !filters.block(file->block(off))) return;
+        ff_send_out(NEW<pico::mb_wrapped<size_t>>(tag, NEW<size_t>(off)));
+      });
+      end_cstream(tag);
+    }
+
+    void kernel(pico::base_microbatch *) { assert(false); }
+
+   private:
+    mapping_t file;
+    binary_filters<T> filters;
+  };
+
+  class Worker : public base_filter {
+   public:
+    Worker(mapping_t file_, const binary_filters<T> &filters)
+        : file(file_), decoder(filters) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<size_t> *>(in_mb);
+      size_t *off = wmb->get();
+      auto send = [this](pico::base_microbatch *mb) { ff_send_out(mb); };
+      decoder.decode(file->block(*off), wmb->tag(), send);
+      decoder.flush(send);
+      DELETE(off);
+      DELETE(wmb);
+    }
+
+   private:
+    mapping_t file;
+    binary_decoder<T> decoder;
+  };
+};
+
+/**
+ * Sequential ReadBinary node.
+ */
+template <typename T>
+class ReadBinaryFFNode_seq : public base_filter {
+ public:
+  ReadBinaryFFNode_seq(std::shared_ptr<binary_mapping> file_,
+                       const binary_filters<T> &filters)
+      : file(file_), decoder(filters) {}
+
+  void begin_callback() {
+    auto tag = pico::base_microbatch::fresh_tag();
+    begin_cstream(tag);
+    auto send = [this](pico::base_microbatch *mb) { send_mb(mb); };
+    file->for_each_block(
+        [&](size_t off) { decoder.decode(file->block(off), tag, send); });
+    decoder.flush(send);
+    end_cstream(tag);
+  }
+
+  void kernel(pico::base_microbatch *) { assert(false); }
+
+ private:
+  std::shared_ptr<binary_mapping> file;
+  binary_decoder<T> decoder;
+};
+
+template <typename T>
+static ff::ff_node *make_ReadBinaryFFNode(int par, std::string fname,
+                                          const binary_filters<T> &filters) {
+  auto file = std::make_shared<binary_mapping>(fname);
+  if (!pico::binary_header_matches<T>(file->header())) {
+    fprintf(stderr, "Binary file %s does not match the record type\n",
+            fname.c_str());
+    exit(1);
+  }
+  if (par > 1) return new ReadBinaryFFNode_par<T>(par, file, filters);
+  assert(par == 1);
+  return new ReadBinaryFFNode_seq<T>(file, filters);
+}
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_READBINARYFFNODE_HPP_ */
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_READCOMPRESSEDFILEFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_READCOMPRESSEDFILEFFNODE_HPP_
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/Compression.hpp"
+#include "pico/Internals/LineBuffer.hpp"
+#include "pico/Internals/LineFilter.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadFromFileFFNode.hpp"
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/*
+ * Reads the lines from a range of blocks of a compressed file.
+ *
+ * Ranges begin at block boundaries, that do not match line boundaries.
+ * Therefore, the first line of each range (up to the first newline) belongs
+ * to the preceding range: each reader skips it, unless reading the first
+ * range, and reads beyond the end of its range up to the first newline.
+ */
+class compressed_line_reader {
+  typedef pico::Microbatch<pico::Token<std::string>> mb_t;
+
+ public:
+  compressed_line_reader(std::string fname, pico::compression c,
+                         const pico::line_filter &filter_ = pico::line_filter())
+      : filter(filter_), buf(COMPRESSED_READ_SIZE) {
+    fd = ::open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+      fprintf(stderr, "Unable to open input file %s\n", fname.c_str());
+      exit(1);
+    }
+    fsize = st.st_size;
+    decompressor.reset(new pico::block_decompressor(fd, c));
+  }
+
+  ~compressed_line_reader() {
+    decompressor.reset();
+    ::close(fd);
+  }
+
+  off_t file_size() const { return fsize; }
+
+  /* calls send(mb) on each complete micro-batch */
+  template <typename Send>
+  void read(off_t begin, off_t end, pico::base_microbatch::tag_t tag,
+            Send &&send) {
+    auto read_f = [this](char *p, size_t size) {
+      return decompressor->read(p, size);
+    };
+    const char *rec;
+    size_t len;
+    bool skip = (begin != 0);
+    ssize_t n = 1;
+
+    decompressor->open(begin, end);
+    buf.consume(buf.size());  // drop leftovers from the previous range
+    while (n > 0) {
+      n = buf.fill(read_f);
+      if (skip && buf.next('\n', rec, len)) skip = false;
+      if (skip) {
+        buf.consume(buf.size());
+        continue;
+      }
+      while (buf.next('\n', rec, len)) emit(rec, len, tag, send);
+    }
+
+    if (!skip) {
+      /* complete the last line from the following blocks */
+      if (end < fsize) {
+        decompressor->extend(fsize);
+        do
+          n = buf.fill(read_f);
+        while (!buf.next('\n', rec, len) && n > 0);
+        if (n > 0) emit(rec, len, tag, send);
+      }
+      /* unterminated last line of the file */
+      if (n <= 0 && buf.remainder(rec, len)) emit(rec, len, tag, send);
+    }
+
+    /* remainder micro-batch */
+    if (mb && !mb->empty())
+      send(mb);
+    else if (mb)
+      DELETE(mb);
+    mb = nullptr;
+  }
+
+ private:
+  int fd;
+  off_t fsize;
+  std::unique_ptr<pico::block_decompressor> decompressor;
+  pico::line_filter filter;
+  pico::LineBuffer buf;
+  mb_t *mb = nullptr;
+
+  template <typename Send>
+  void emit(const char *rec, size_t len, pico::base_microbatch::tag_t tag,
+            Send &send) {
+    if (!filter.match(rec, len)) return;
+    if (!mb) mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+    new (mb->allocate()) std::string(rec, len);
+    mb->commit();
+    if (mb->full()) {
+      send(mb);
+      mb = nullptr;
+    }
+  }
+};
+
+/**
+ * The non-ordering farm for reading compressed files.
+ * The emitter partitions the file at block boundaries, if possible.
+ */
+class ReadCompressedFileFFNode_par : public NonOrderingFarm {
+ public:
+  ReadCompressedFileFFNode_par(int par, std::string fname, pico::compression c,
+                               const pico::line_filter &filter) {
+    std::vector<ff::ff_node *> workers;
+    for (int i = 0; i < par; ++i)
+      workers.push_back(new Worker(fname, c, filter));
+    this->setEmitterF(new BlockPartitioner(fname, c, par));
+    this->add_workers(workers);
+    this->setCollectorF(new ForwardingCollector(par));
+    this->cleanup_all();
+  }
+
+ private:
+  /*
+   * Partitions the blocks into ranges of similar (compressed) size.
+   * A file that cannot be split is read by a single worker.
+   */
+  class BlockPartitioner : public base_emitter {
+   public:
+    BlockPartitioner(std::string fname, pico::compression c_,
+                     unsigned partitions_)
+        : base_emitter(partitions_), c(c_), partitions(partitions_) {
+      fd = ::open(fname.c_str(), O_RDONLY);
+      assert(fd >= 0);
+    }
+
+    ~BlockPartitioner() { ::close(fd); }
+
+    void begin_callback() {
+      tag = pico::base_microbatch::fresh_tag();
+      begin_cstream(tag);
+
+      auto blocks = pico::compressed_blocks(fd, c);
+      if (blocks.empty()) {
+        struct stat st;
+        fstat(fd, &st);
+        if (st.st_size) send(0, st.st_size);
+      } else {
+        off_t fsize = blocks.back(), rbegin = 0;
+        for (unsigned p = 1; p < partitions; ++p) {
+          /* first block boundary after the partition boundary */
+          off_t target = fsize / partitions * p;
+          auto it = std::lower_bound(blocks.begin(), blocks.end(), target);
+          if (*it > rbegin && *it < fsize) {
+            send(rbegin, *it);
+            rbegin = *it;
+          }
+        }
+        if (fsize > rbegin) send(rbegin, fsize);
+      }
+
+      end_cstream(tag);
+    }
+
+    void kernel(pico::base_microbatch *) { assert(false); }
+
+   private:
+    int fd;
+    pico::compression c;
+    unsigned partitions;
+    pico::base_microbatch::tag_t tag = 0;
+
+    void send(off_t begin, off_t end) {
+      ff_send_out(NEW<pico::mb_wrapped<prange>>(tag, NEW<prange>(begin, end)));
+    }
+  };
+
+  class Worker : public base_filter {
+   public:
+    Worker(std::string fname, pico::compression c,
+           const pico::line_filter &filter)
+        : reader(fname, c, filter) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<prange> *>(in_mb);
+      prange *r = wmb->get();
+      reader.read(r->begin, r->end, wmb->tag(),
+                  [this](pico::base_microbatch *mb) { ff_send_out(mb); });
+      DELETE(r);
+      DELETE(wmb);
+    }
+
+   private:
+    compressed_line_reader reader;
+  };
+};
+
+/**
+ * Sequential node for reading compressed files.
+ */
+class ReadCompressedFileFFNode_seq : public base_filter {
+ public:
+  ReadCompressedFileFFNode_seq(std::string fname, pico::compression c,
+                               const pico::line_filter &filter)
+      : reader(fname, c, filter) {}
+
+  void begin_callback() {
+    auto tag = pico::base_microbatch::fresh_tag();
+    begin_cstream(tag);
+    reader.read(0, reader.file_size(), tag,
+                [this](pico::base_microbatch *mb) { send_mb(mb); });
+    end_cstream(tag);
+  }
+
+  void kernel(pico::base_microbatch *) { assert(false); }
+
+ private:
+  compressed_line_reader reader;
+};
+
+static ff::ff_node *ReadCompressedFileFFNode(
+    int par, std::string fname, pico::compression c,
+    const pico::line_filter &filter = pico::line_filter()) {
+  pico::compression_check(c);
+  if (par > 1) return new ReadCompressedFileFFNode_par(par, fname, c, filter);
+  assert(par == 1);
+  return new ReadCompressedFileFFNode_seq(fname, c, filter);
+}
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_READCOMPRESSEDFILEFFNODE_HPP_ */
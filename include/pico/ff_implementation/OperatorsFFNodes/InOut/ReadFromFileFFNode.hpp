@@ -21,8 +21,15 @@
 #ifndef INTERNALS_FFOPERATORS_INOUT_READFROMFILEFFNODE_HPP_
 #define INTERNALS_FFOPERATORS_INOUT_READFROMFILEFFNODE_HPP_
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
@@ -33,7 +40,9 @@
 #include "pico/Internals/utils.hpp"
 #include "pico/ff_implementation/SupportFFNodes/farms.hpp"
 
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
 #include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
 #include "pico/ff_implementation/ff_config.hpp"
 
 /*
@@ -69,7 +78,9 @@ class getline_textfile : public base_filter {
   typedef pico::Microbatch<pico::Token<std::string>> mb_t;
 
  public:
-  getline_textfile(std::string fname_) : file(fname_) {
+  getline_textfile(std::string fname_, const pico::fused_stages &stages)
+      : file(fname_),
+        out(stages, [this](pico::base_microbatch *mb) { ff_send_out(mb); }) {
     assert(file.is_open());
   }
 
@@ -89,7 +100,7 @@ class getline_textfile : public base_filter {
           mb->commit();
           /* create next micro-batch if complete */
           if (mb->full()) {
-            ff_send_out(reinterpret_cast<void *>(mb));
+            out.send(mb);
             mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
           }
         } else
@@ -104,7 +115,7 @@ class getline_textfile : public base_filter {
 
     /* remainder micro-batch */
     if (!mb->empty())
-      ff_send_out(reinterpret_cast<void *>(mb));
+      out.send(mb);
     else
       DELETE(mb);
 
@@ -113,8 +124,13 @@ class getline_textfile : public base_filter {
     DELETE(wmb);
   }
 
+  void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+    out.cstream_end(tag);
+  }
+
  private:
   std::ifstream file;
+  pico::fused_output out;
 };
 
 /*
@@ -129,7 +145,8 @@ class read_textfile : public base_filter {
   typedef pico::Microbatch<pico::Token<std::string>> mb_t;
 
  public:
-  read_textfile(std::string fname) {
+  read_textfile(std::string fname, const pico::fused_stages &stages)
+      : out(stages, [this](pico::base_microbatch *mb) { ff_send_out(mb); }) {
     fd = fopen(fname.c_str(), "rb");
     assert(fd);
     bufsize = BUFFERING_PAGES * getpagesize();
@@ -163,7 +180,7 @@ class read_textfile : public base_filter {
             mb->commit();
             /* create next micro-batch if complete */
             if (mb->full()) {
-              ff_send_out(reinterpret_cast<void *>(mb));
+              out.send(mb);
               mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
             }
             line = new (mb->allocate()) std::string();
@@ -189,7 +206,7 @@ class read_textfile : public base_filter {
 
     /* remainder micro-batch */
     if (!mb->empty())
-      ff_send_out(reinterpret_cast<void *>(mb));
+      out.send(mb);
     else
       DELETE(mb);
 
@@ -198,14 +215,112 @@ class read_textfile : public base_filter {
     DELETE(wmb);
   }
 
+  void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+    out.cstream_end(tag);
+  }
+
  private:
   FILE *fd;
   ssize_t bufsize;
   char *buf;
+  pico::fused_output out;
+};
+
+/*
+ * Bounds (in bytes) on the size of the chunks a text file is partitioned into.
+ */
+#define FILE_MIN_CHUNK (1 << 22)
+#define FILE_MAX_CHUNK (1 << 24)
+
+/*
+ * A FilePartitioner partitions an input text file into line-aligned chunks,
+ * that are pulled by the workers on demand.
+ *
+ * Chunks are several times more than the workers (within the chunk size
+ * bounds), so that skewed chunks (e.g., with long lines) do not leave the
+ * other workers idle.
+ * Small files are partitioned into one chunk per worker.
+ */
+class FilePartitioner : public base_emitter {
+ public:
+  FilePartitioner(std::string fname, unsigned partitions_)
+      : base_emitter(partitions_),  //
+        partitions(partitions_) {
+    fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "Unable to open input file %s\n", fname.c_str());
+      exit(1);
+    }
+    bufsize = BUFFERING_PAGES * getpagesize();
+    buf = (char *)MALLOC(bufsize);
+  }
+
+  ~FilePartitioner() {
+    FREE(buf);
+    ::close(fd);
+  }
+
+  void begin_callback() {
+    /* get a fresh tag */
+    tag = pico::base_microbatch::fresh_tag();
+    begin_cstream(tag);
+
+    /* get file size */
+    struct stat st;
+    fstat(fd, &st);
+    off_t fsize = st.st_size;
+
+    /* chunk size */
+    off_t chunk = fsize / (4 * partitions);
+    chunk = std::min(std::max(chunk, (off_t)FILE_MIN_CHUNK),
+                     (off_t)FILE_MAX_CHUNK);
+    if (chunk * partitions > fsize)
+      chunk = (fsize + partitions - 1) / partitions;
+
+    off_t rbegin = 0, rend;
+    while (rbegin < fsize) {
+      rend = line_boundary(rbegin + chunk, fsize);
+      wrap_and_send(NEW<prange>(rbegin, rend));
+      rbegin = rend;
+    }
+
+    end_cstream(tag);
+  }
+
+  void kernel(pico::base_microbatch *) { assert(false); }
+
+ private:
+  int fd;
+  unsigned partitions;
+  char *buf;
+  size_t bufsize;
+  pico::base_microbatch::tag_t tag = 0;  // a tag for the generated collection
+
+  /*
+   * Returns the first line boundary at or after a given offset (or EOF), by
+   * scanning the file block by block.
+   */
+  off_t line_boundary(off_t from, off_t fsize) {
+    off_t pos = from - 1;  // a line boundary follows a newline
+    while (pos < fsize) {
+      ssize_t n = pread(fd, buf, bufsize, pos);
+      if (n <= 0) break;
+      char *nl = (char *)memchr(buf, '\n', n);
+      if (nl) return pos + (nl - buf) + 1;
+      pos += n;
+    }
+    return fsize;
+  }
+
+  void wrap_and_send(prange *p) {
+    auto wmb = NEW<pico::mb_wrapped<prange>>(tag, p);
+    ff_send_out(wmb);
+  }
 };
 
 /**
  * The ReadFromFile non-ordering farm.
+ * Workers pass the lines they read through the given fused stages, if any.
  */
 class ReadFromFileFFNode_par : public NonOrderingFarm {
   /* select implementation for line-based file reading */
@@ -213,80 +328,21 @@ class ReadFromFileFFNode_par : public NonOrderingFarm {
   // using Worker = read_textfile;
 
  public:
-  ReadFromFileFFNode_par(int parallelism, std::string fname_) : fname(fname_) {
+  ReadFromFileFFNode_par(int parallelism, std::string fname_,
+                         const pico::fused_stages &stages)
+      : fname(fname_) {
     std::vector<ff_node *> workers;
-    for (int i = 0; i < parallelism; ++i) workers.push_back(new Worker(fname));
-    auto e = new Partitioner(*this, fname, parallelism);
+    for (int i = 0; i < parallelism; ++i)
+      workers.push_back(new Worker(fname, stages));
+    auto e = new FilePartitioner(fname, parallelism);
     this->setEmitterF(e);
     this->add_workers(workers);
-    this->setCollectorF(new ForwardingCollector(parallelism));
+    this->setCollectorF(make_fused_collector(parallelism, stages));
+    this->set_scheduling_ondemand();
     this->cleanup_all();
   }
 
  private:
-  /*
-   * A Partitioner partitions an input file and creates read-ranges
-   */
-  class Partitioner : public base_emitter {
-   public:
-    Partitioner(const NonOrderingFarm &f_, std::string fname,
-                unsigned partitions_)
-        : base_emitter(partitions_),  //
-          partitions(partitions_) {
-      fd = fopen(fname.c_str(), "rb");
-      assert(fd);  // todo - better reporting
-    }
-
-    ~Partitioner() { fclose(fd); }
-
-    void begin_callback() {
-      /* get a fresh tag */
-      tag = pico::base_microbatch::fresh_tag();
-      begin_cstream(tag);
-
-      /* get file size */
-      fseek(fd, 0, SEEK_END);
-      off_t fsize = ftell(fd);
-      off_t pstep = (off_t)std::ceil((float)fsize / partitions);
-      off_t rbegin = 0, rend;
-      char buf;
-      for (unsigned p = 0; p < partitions - 1 && rbegin < fsize; ++p) {
-        /* search for first \n after partition boundary (or EOF) */
-        rend = (p + 1) * pstep;
-
-        if (rend < fsize) {
-          /* rend within file boundary */
-          fseek(fd, rend - 1, SEEK_SET);
-          while ((buf = getc(fd))) {
-            if (buf == '\n') break;
-            ++rend;
-          }
-          if (rend > rbegin) {
-            wrap_and_send(NEW<prange>(rbegin, rend));
-            rbegin = rend;
-          }
-        } else
-          /* rend beyond file boundary */
-          break;
-      }
-      if (fsize > rbegin) wrap_and_send(NEW<prange>(rbegin, fsize));
-
-      end_cstream(tag);
-    }
-
-    void kernel(pico::base_microbatch *) { assert(false); }
-
-   private:
-    FILE *fd;
-    unsigned partitions;
-    pico::base_microbatch::tag_t tag = 0;  // a tag for the generated collection
-
-    void wrap_and_send(prange *p) {
-      auto wmb = NEW<pico::mb_wrapped<prange>>(tag, p);
-      ff_send_out(wmb);
-    }
-  };
-
   std::string fname;
 };
 
@@ -297,14 +353,18 @@ class ReadFromFileFFNode_seq : public base_filter {
   typedef pico::Microbatch<pico::Token<std::string>> mb_t;
 
  public:
-  ReadFromFileFFNode_seq(std::string fname_) : infile(fname_) {
+  ReadFromFileFFNode_seq(std::string fname_, const pico::fused_stages &stages)
+      : fname(fname_),
+        out(stages, [this](pico::base_microbatch *mb) { send_mb(mb); }) {}
+
+  void begin_callback() {
+    /* the file is opened at each run, as the executor may be reused */
+    std::ifstream infile(fname);
     if (!infile.is_open()) {
-      fprintf(stderr, "Unable to open input file %s\n", fname_.c_str());
+      fprintf(stderr, "Unable to open input file %s\n", fname.c_str());
       exit(1);
     }
-  }
 
-  void begin_callback() {
     /* get a fresh tag */
     tag = pico::base_microbatch::fresh_tag();
     begin_cstream(tag);
@@ -320,20 +380,20 @@ class ReadFromFileFFNode_seq : public base_filter {
         mb->commit();
         /* send out micro-batch if complete */
         if (mb->full()) {
-          send_mb(mb);
+          out.send(mb);
           mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
         }
       } else
         break;
     }
-    infile.close();
 
     /* send out the remainder micro-batch or destroy if spurious */
     if (!mb->empty())
-      send_mb(mb);
+      out.send(mb);
     else
       DELETE(mb);
 
+    out.cstream_end(tag);
     end_cstream(tag);
   }
 
@@ -342,13 +402,14 @@ class ReadFromFileFFNode_seq : public base_filter {
  private:
   pico::base_microbatch::tag_t tag = 0;  // a tag for the generated collection
   std::string fname;
-  std::ifstream infile;
+  pico::fused_output out;
 };
 
-static ff::ff_node *ReadFromFileFFNode(int par, std::string fname) {
-  if (par > 1) return new ReadFromFileFFNode_par(par, fname);
+static ff::ff_node *ReadFromFileFFNode(
+    int par, std::string fname, const pico::fused_stages &stages = {}) {
+  if (par > 1) return new ReadFromFileFFNode_par(par, fname, stages);
   assert(par == 1);
-  return new ReadFromFileFFNode_seq(fname);
+  return new ReadFromFileFFNode_seq(fname, stages);
 }
 
 #endif /* INTERNALS_FFOPERATORS_INOUT_READFROMFILEFFNODE_HPP_ */
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_READFROMFILESFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_READFROMFILESFFNODE_HPP_
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/Compression.hpp"
+#include "pico/Internals/LineBuffer.hpp"
+#include "pico/Internals/LineFilter.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadCompressedFileFFNode.hpp"
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/* size (in bytes) of the reads issued by multi-file readers */
+#define FILES_READ_SIZE (1 << 16)
+
+/* minimum size (in bytes) of the ranges a file is split into */
+#define FILES_MIN_RANGE (1 << 20)
+
+/*
+ * Checks whether a path denotes a set of files (a directory or a glob).
+ */
+static bool is_file_set(const std::string &path) {
+  struct stat st;
+  if (!stat(path.c_str(), &st)) return S_ISDIR(st.st_mode);
+  return path.find_first_of("*?[") != std::string::npos;
+}
+
+/*
+ * Expands a list of paths into a list of regular files.
+ * Each path is either a file, a directory (its non-hidden regular files) or a
+ * glob pattern.
+ */
+static std::vector<std::string> expand_file_set(
+    const std::vector<std::string> &paths) {
+  std::vector<std::string> res;
+  auto is_regular = [](const std::string &p) {
+    struct stat st;
+    return !stat(p.c_str(), &st) && S_ISREG(st.st_mode);
+  };
+  for (auto &path : paths) {
+    struct stat st;
+    if (!stat(path.c_str(), &st) && S_ISDIR(st.st_mode)) {
+      std::vector<std::string> dir_files;
+      DIR *d = opendir(path.c_str());
+      if (!d) {
+        fprintf(stderr, "Unable to open input directory %s\n", path.c_str());
+        exit(1);
+      }
+      while (struct dirent *e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        std::string p = path + "/" + e->d_name;
+        if (is_regular(p)) dir_files.push_back(p);
+      }
+      closedir(d);
+      std::sort(dir_files.begin(), dir_files.end());
+      res.insert(res.end(), dir_files.begin(), dir_files.end());
+    } else if (is_file_set(path)) {
+      glob_t g;
+      if (!glob(path.c_str(), 0, nullptr, &g))
+        for (size_t i = 0; i < g.gl_pathc; ++i)
+          if (is_regular(g.gl_pathv[i])) res.push_back(g.gl_pathv[i]);
+      globfree(&g);
+    } else
+      res.push_back(path);
+  }
+  return res;
+}
+
+/*
+ * An input file, opened by the emitter on behalf of the workers.
+ * The file is closed as soon as the last range referring to it is read.
+ */
+struct input_file {
+  input_file(std::string name_, int fd_, pico::compression c_)
+      : name(name_), fd(fd_), c(c_) {}
+  ~input_file() { ::close(fd); }
+
+  input_file(const input_file &) = delete;
+  input_file &operator=(const input_file &) = delete;
+
+  std::string name;
+  int fd;
+  pico::compression c;
+};
+
+/*
+ * A range of an input file to be read.
+ * Compressed files are always read as a whole.
+ */
+struct file_range {
+  file_range(std::shared_ptr<input_file> file_, off_t begin_, off_t end_)
+      : file(file_), begin(begin_), end(end_) {}
+  std::shared_ptr<input_file> file;
+  off_t begin, end;
+};
+
+/*
+ * Reads the lines starting within a range of a plain text file.
+ *
+ * Ranges are not aligned to line boundaries: the reader skips the line
+ * crossing the range begin (owned by the preceding range) and reads beyond
+ * the range end to complete its last line.
+ *
+ * Lines are filtered on the read buffer, before being built as strings.
+ */
+class range_line_reader {
+  typedef pico::Microbatch<pico::Token<std::string>> mb_t;
+
+ public:
+  range_line_reader(const pico::line_filter &filter_)
+      : filter(filter_), buf(FILES_READ_SIZE) {}
+
+  /* calls send(mb) on each complete micro-batch */
+  template <typename Send>
+  void read(int fd, off_t begin, off_t end, pico::base_microbatch::tag_t tag,
+            Send &&send) {
+    /* also read the byte preceding the range, to detect a line boundary */
+    bool skip = (begin != 0);
+    off_t line_begin = skip ? begin - 1 : begin, pos = line_begin;
+    auto read_f = [&](char *p, size_t size) {
+      /* do not read much beyond the range end */
+      if (pos >= end) size = std::min(size, (size_t)getpagesize());
+      ssize_t n = pread(fd, p, size, pos);
+      if (n > 0) pos += n;
+      return n;
+    };
+    const char *rec;
+    size_t len;
+    ssize_t n;
+
+    buf.consume(buf.size());  // drop leftovers from the previous range
+    do {
+      n = buf.fill(read_f);
+      if (skip && buf.next('\n', rec, len)) {
+        skip = false;
+        line_begin += len + 1;
+      }
+      if (!skip && line_begin < end && buf.size()) {
+        /* the complete lines starting within the range */
+        const char *p = buf.data();
+        const char *last = (const char *)memrchr(p, '\n', buf.size());
+        if (!last) continue;
+        size_t cut = last - p + 1;
+        if (line_begin + (off_t)cut > end) {
+          off_t from = end - line_begin - 1;
+          cut = (const char *)memchr(p + from, '\n', cut - from) - p + 1;
+        }
+        filter.for_each(p, cut, [&](const char *l, size_t llen) {
+          emit(l, llen, tag, send);
+        });
+        buf.consume(cut);
+        line_begin += cut;
+      }
+    } while (n > 0 && line_begin < end);
+
+    if (n < 0) {
+      perror("ERROR reading input file");
+      exit(1);
+    }
+
+    /* unterminated last line of the file */
+    if (!n && !skip && line_begin < end && buf.remainder(rec, len) &&
+        filter.match(rec, len))
+      emit(rec, len, tag, send);
+
+    /* remainder micro-batch */
+    if (mb && !mb->empty())
+      send(mb);
+    else if (mb)
+      DELETE(mb);
+    mb = nullptr;
+  }
+
+ private:
+  pico::line_filter filter;
+  pico::LineBuffer buf;
+  mb_t *mb = nullptr;
+
+  template <typename Send>
+  void emit(const char *rec, size_t len, pico::base_microbatch::tag_t tag,
+            Send &send) {
+    if (!mb) mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+    new (mb->allocate()) std::string(rec, len);
+    mb->commit();
+    if (mb->full()) {
+      send(mb);
+      mb = nullptr;
+    }
+  }
+};
+
+/**
+ * The non-ordering farm for reading a set of text files.
+ *
+ * The emitter splits large files into ranges and dispatches ranges on demand,
+ * largest first, so that workers are balanced regardless of file sizes.
+ * Files are opened (and prefetched) by the emitter, while workers are busy on
+ * previous ranges.
+ * Workers pass the lines they read through the given fused stages, if any.
+ *
+ * The files can also be given by a function, called at the beginning of each
+ * run (e.g., to read a different input upon each run of a compiled Pipe).
+ */
+class ReadFromFilesFFNode : public NonOrderingFarm {
+  typedef std::function<std::vector<std::string>()> files_f;
+
+ public:
+  ReadFromFilesFFNode(int par, std::vector<std::string> files,
+                      const pico::line_filter &filter = pico::line_filter(),
+                      const pico::fused_stages &stages = {})
+      : ReadFromFilesFFNode(par, [files]() { return files; }, filter, stages) {}
+
+  ReadFromFilesFFNode(int par, files_f files,
+                      const pico::line_filter &filter = pico::line_filter(),
+                      const pico::fused_stages &stages = {}) {
+    std::vector<ff::ff_node *> workers;
+    for (int i = 0; i < par; ++i) workers.push_back(new Worker(filter, stages));
+    this->setEmitterF(new Scheduler(files, par));
+    this->add_workers(workers);
+    this->setCollectorF(make_fused_collector(par, stages));
+    this->set_scheduling_ondemand();
+    this->cleanup_all();
+  }
+
+ private:
+  class Scheduler : public base_emitter {
+    struct task {
+      size_t file;  // index of the file
+      off_t begin, end;
+    };
+
+   public:
+    Scheduler(files_f get_files_, unsigned nw_)
+        : base_emitter(nw_), get_files(get_files_), nw(nw_) {}
+
+    void begin_callback() {
+      files = get_files();
+      if (files.empty()) {
+        fprintf(stderr, "No input files to be read\n");
+        exit(1);
+      }
+      tag = pico::base_microbatch::fresh_tag();
+      begin_cstream(tag);
+
+      /* split files into ranges, largest first */
+      std::vector<pico::compression> c(files.size());
+      std::vector<off_t> fsize(files.size());
+      off_t total = 0;
+      for (size_t i = 0; i < files.size(); ++i) {
+        struct stat st;
+        if (stat(files[i].c_str(), &st)) {
+          fprintf(stderr, "Unable to open input file %s\n", files[i].c_str());
+          exit(1);
+        }
+        c[i] = pico::compression_from_file(files[i]);
+        pico::compression_check(c[i]);
+        fsize[i] = st.st_size;
+        total += fsize[i];
+      }
+      off_t range = std::max(total / (4 * nw), (off_t)FILES_MIN_RANGE);
+      std::vector<task> tasks;
+      std::vector<unsigned> pending(files.size(), 0);
+      for (size_t i = 0; i < files.size(); ++i) {
+        off_t step = c[i] == pico::compression::NONE ? range : fsize[i];
+        for (off_t b = 0; b < fsize[i]; b += step) {
+          tasks.push_back({i, b, std::min(b + step, fsize[i])});
+          ++pending[i];
+        }
+      }
+      std::stable_sort(tasks.begin(), tasks.end(),
+                       [](const task &a, const task &b) {
+                         return a.end - a.begin > b.end - b.begin;
+                       });
+
+      /*
+       * dispatch ranges: on-demand scheduling blocks the emitter until some
+       * worker is idle, so files are opened just ahead of being read
+       */
+      std::map<size_t, std::shared_ptr<input_file>> open_files;
+      for (auto &t : tasks) {
+        auto &f = open_files[t.file];
+        if (!f) f = open_file(t.file, c[t.file]);
+        posix_fadvise(f->fd, t.begin, t.end - t.begin, POSIX_FADV_WILLNEED);
+        auto r = NEW<file_range>(f, t.begin, t.end);
+        if (!--pending[t.file]) open_files.erase(t.file);
+        ff_send_out(NEW<pico::mb_wrapped<file_range>>(tag, r));
+      }
+
+      end_cstream(tag);
+    }
+
+    void kernel(pico::base_microbatch *) { assert(false); }
+
+   private:
+    files_f get_files;
+    std::vector<std::string> files;
+    unsigned nw;
+    pico::base_microbatch::tag_t tag = 0;
+
+    std::shared_ptr<input_file> open_file(size_t i, pico::compression c) {
+      int fd = ::open(files[i].c_str(), O_RDONLY);
+      if (fd < 0) {
+        fprintf(stderr, "Unable to open input file %s\n", files[i].c_str());
+        exit(1);
+      }
+      return std::make_shared<input_file>(files[i], fd, c);
+    }
+  };
+
+  class Worker : public base_filter {
+   public:
+    Worker(const pico::line_filter &filter_, const pico::fused_stages &stages)
+        : filter(filter_),
+          reader(filter_),
+          out(stages, [this](pico::base_microbatch *mb) { ff_send_out(mb); }) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<file_range> *>(in_mb);
+      file_range *r = wmb->get();
+      auto send = [this](pico::base_microbatch *mb) { out.send(mb); };
+      if (r->file->c == pico::compression::NONE)
+        reader.read(r->file->fd, r->begin, r->end, wmb->tag(), send);
+      else {
+        compressed_line_reader creader(r->file->name, r->file->c, filter);
+        creader.read(0, creader.file_size(), wmb->tag(), send);
+      }
+      DELETE(r);
+      DELETE(wmb);
+    }
+
+    void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+      out.cstream_end(tag);
+    }
+
+   private:
+    pico::line_filter filter;
+    range_line_reader reader;
+    pico::fused_output out;
+  };
+};
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_READFROMFILESFFNODE_HPP_ */
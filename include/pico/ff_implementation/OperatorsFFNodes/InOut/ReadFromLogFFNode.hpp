@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_READFROMLOGFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_READFROMLOGFFNODE_HPP_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/SegmentedLog.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/*
+ * Where to start reading each partition from.
+ * If a group is given, each partition starts from the offset committed by
+ * the group (if any), and the offset reached is committed at the end.
+ */
+struct log_start {
+  pico::log_offset_t offset = 0;
+  std::string group;
+};
+
+/*
+ * Reads whole partitions, from their start offset to their current end.
+ */
+class log_reader {
+  typedef pico::Microbatch<pico::Token<std::string>> mb_t;
+
+ public:
+  log_reader(std::string log_, const log_start &start_)
+      : log(log_), start(start_) {}
+
+  /* calls send(mb) on each complete micro-batch */
+  template <typename Send>
+  void read(unsigned p, pico::base_microbatch::tag_t tag, Send &&send) {
+    pico::log_partition_reader reader(log, p);
+    pico::log_offset_t from = start.offset;
+    if (!start.group.empty())
+      pico::log_load_committed(log, p, start.group, from);
+    reader.seek(from);
+
+    const char *rec;
+    uint32_t len;
+    mb_t *mb = nullptr;
+    while (reader.next(rec, len)) {
+      if (!mb) mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+      new (mb->allocate()) std::string(rec, len);
+      mb->commit();
+      if (mb->full()) {
+        send(mb);
+        mb = nullptr;
+      }
+    }
+    if (mb) send(mb);
+
+    if (!start.group.empty())
+      pico::log_store_committed(log, p, start.group, reader.offset());
+  }
+
+ private:
+  std::string log;
+  log_start start;
+};
+
+/**
+ * The ReadFromLog non-ordering farm.
+ * Each partition is read as a whole by a worker. Partitions are dispatched on
+ * demand, largest first.
+ */
+class ReadFromLogFFNode_par : public NonOrderingFarm {
+ public:
+  ReadFromLogFFNode_par(int par, std::string log, const log_start &start) {
+    std::vector<ff::ff_node *> workers;
+    for (int i = 0; i < par; ++i) workers.push_back(new Worker(log, start));
+    this->setEmitterF(new Scheduler(log, par));
+    this->add_workers(workers);
+    this->setCollectorF(new ForwardingCollector(par));
+    this->set_scheduling_ondemand();
+    this->cleanup_all();
+  }
+
+ private:
+  class Scheduler : public base_emitter {
+   public:
+    Scheduler(std::string log_, unsigned nw) : base_emitter(nw), log(log_) {}
+
+    void begin_callback() {
+      auto tag = pico::base_microbatch::fresh_tag();
+      begin_cstream(tag);
+      std::vector<std::pair<size_t, unsigned>> partitions;
+      for (unsigned p = 0; p < pico::log_partitions(log); ++p)
+        partitions.push_back(
+            {pico::log_partition_size(pico::log_partition_dir(log, p)), p});
+      std::sort(partitions.rbegin(), partitions.rend());
+      for (auto &p : partitions)
+        ff_send_out(
+            NEW<pico::mb_wrapped<unsigned>>(tag, NEW<unsigned>(p.second)));
+      end_cstream(tag);
+    }
+
+    void kernel(pico::base_microbatch *) { assert(false); }
+
+   private:
+    std::string log;
+  };
+
+  class Worker : public base_filter {
+   public:
+    Worker(std::string log, const log_start &start) : reader(log, start) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<unsigned> *>(in_mb);
+      unsigned *p = wmb->get();
+      reader.read(*p, wmb->tag(),
+                  [this](pico::base_microbatch *mb) { ff_send_out(mb); });
+      DELETE(p);
+      DELETE(wmb);
+    }
+
+   private:
+    log_reader reader;
+  };
+};
+
+/**
+ * Sequential ReadFromLog node.
+ */
+class ReadFromLogFFNode_seq : public base_filter {
+ public:
+  ReadFromLogFFNode_seq(std::string log_, const log_start &start)
+      : log(log_), reader(log_, start) {}
+
+  void begin_callback() {
+    auto tag = pico::base_microbatch::fresh_tag();
+    begin_cstream(tag);
+    for (unsigned p = 0; p < pico::log_partitions(log); ++p)
+      reader.read(p, tag, [this](pico::base_microbatch *mb) { send_mb(mb); });
+    end_cstream(tag);
+  }
+
+  void kernel(pico::base_microbatch *) { assert(false); }
+
+ private:
+  std::string log;
+  log_reader reader;
+};
+
+static ff::ff_node *make_ReadFromLogFFNode(int par, std::string log,
+                                           const log_start &start) {
+  unsigned partitions = pico::log_partitions(log);
+  if (!partitions) {
+    fprintf(stderr, "Unable to open input log %s\n", log.c_str());
+    exit(1);
+  }
+  par = std::min(par, (int)partitions);
+  if (par > 1) return new ReadFromLogFFNode_par(par, log, start);
+  return new ReadFromLogFFNode_seq(log, start);
+}
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_READFROMLOGFFNODE_HPP_ */
@@ -33,23 +33,32 @@
 
 #include <ff/node.hpp>
 
+#include "pico/Internals/LineBuffer.hpp"
 #include "pico/Internals/Microbatch.hpp"
 #include "pico/Internals/TimedToken.hpp"
 #include "pico/Internals/utils.hpp"
 
 #include "pico/ff_implementation/ff_config.hpp"
 
-#define CHUNK_SIZE 512
+#define SOCKET_READ_SIZE (1 << 16)
 
 /*
  * reads a stream from a socket, maintains the order
+ *
+ * Data is read in chunks of read_size bytes into a reusable buffer, that is
+ * scanned for delimiters. Each item is built in place within the
+ * micro-batch, directly from the buffered bytes.
  */
 class ReadFromSocketFFNode : public base_filter {
   typedef pico::Token<std::string> TokenType;
 
  public:
-  ReadFromSocketFFNode(std::string &server_name_, int port_, char delimiter_)
-      : server_name(server_name_), port(port_), delimiter(delimiter_) {
+  ReadFromSocketFFNode(std::string &server_name_, int port_, char delimiter_,
+                       size_t read_size_ = SOCKET_READ_SIZE)
+      : server_name(server_name_),
+        port(port_),
+        delimiter(delimiter_),
+        read_size(read_size_) {
     int option = 1;
     sockfd = socket(AF_INET, SOCK_STREAM, 0);
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
@@ -71,35 +80,25 @@ class ReadFromSocketFFNode : public base_filter {
     tag = pico::base_microbatch::fresh_tag();
     begin_cstream(tag);
 
-    std::string tail;
-    char buffer[CHUNK_SIZE];
     if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
       error("ERROR connecting");
     }
-    bzero(buffer, sizeof(buffer));
-    auto mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
-    std::string *line = new (mb->allocate()) std::string();
-
-    while ((n = read(sockfd, buffer, sizeof(buffer))) > 0) {
-      tail.append(buffer, n);
-      std::istringstream f(tail);
-      /* initialize a new string within the micro-batch */
-      while (std::getline(f, *line, delimiter)) {
-        if (!f.eof()) {  // line contains another delimiter
-          mb->commit();
-          if (mb->full()) {
-            ff_send_out(reinterpret_cast<void *>(mb));
-            mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
-          }
-          tail.clear();
-          line = new (mb->allocate()) std::string();
-        } else {  // trunked line, store for next parsing
-          tail.clear();
-          tail.append(*line);
-        }
-      }
-      bzero(buffer, sizeof(buffer));
-    }  // end while read
+
+    pico::LineBuffer buffer(read_size);
+    auto read_f = [&](char *dst, size_t size) {
+      return read(sockfd, dst, size);
+    };
+    mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+    const char *rec;
+    size_t len;
+
+    while ((n = buffer.fill(read_f)) > 0) {
+      while (buffer.next(delimiter, rec, len)) emit(rec, len);
+    }
+    if (n < 0) error("ERROR reading from socket");
+
+    /* the stream may end with an unterminated item */
+    if (buffer.remainder(rec, len)) emit(rec, len);
 
     if (!mb->empty()) {
       ff_send_out(reinterpret_cast<void *>(mb));
@@ -118,12 +117,24 @@ class ReadFromSocketFFNode : public base_filter {
   typedef pico::Microbatch<TokenType> mb_t;
   std::string server_name;
   int port;
-  int sockfd = 0, n = 0;
+  int sockfd = 0;
+  ssize_t n = 0;
   struct sockaddr_in serv_addr;
   struct hostent *server = nullptr;
   char delimiter;
+  size_t read_size;
+  mb_t *mb = nullptr;
   pico::base_microbatch::tag_t tag = 0;  // a tag for the generated collection
 
+  inline void emit(const char *rec, size_t len) {
+    new (mb->allocate()) std::string(rec, len);
+    mb->commit();
+    if (mb->full()) {
+      ff_send_out(reinterpret_cast<void *>(mb));
+      mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+    }
+  }
+
   void error(const char *msg) {
     perror(msg);
     exit(0);
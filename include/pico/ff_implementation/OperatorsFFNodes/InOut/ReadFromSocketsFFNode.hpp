@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_READFROMSOCKETSFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_READFROMSOCKETSFFNODE_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ff/farm.hpp>
+
+#include "pico/Internals/LineBuffer.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+#include "ReadFromSocketFFNode.hpp"
+
+/*
+ * Milliseconds a reader waits for events before flushing pending items.
+ */
+#define SOCKETS_IDLE_MS 100
+
+typedef std::pair<std::string, int> socket_endpoint;
+
+/*
+ * State shared by the reader threads of a ReadFromSockets farm.
+ *
+ * In listen mode, readers compete for accepting incoming connections on the
+ * shared listening socket, until the expected number of connections is
+ * reached. Each reader accepts at most its share of the connections, so that
+ * they are balanced across readers.
+ */
+struct sockets_state {
+  std::vector<pico::base_microbatch::tag_t> tags;
+  int listen_fd = -1;
+  unsigned expected = 0, share = 0;
+  std::atomic<unsigned> accepted{0};
+
+  ~sockets_state() {
+    if (listen_fd >= 0) close(listen_fd);
+  }
+
+  /* the tag for the i-th connection */
+  pico::base_microbatch::tag_t tag(unsigned i) const {
+    return tags.size() > 1 ? tags[i] : tags[0];
+  }
+};
+
+/*
+ * The set of connections assigned to a reader.
+ */
+struct sockets_task {
+  std::shared_ptr<sockets_state> state;
+  std::vector<std::pair<socket_endpoint, unsigned>> endpoints;  // connect mode
+};
+
+/**
+ * The ReadFromSockets non-ordering farm.
+ *
+ * Each worker is a reader thread multiplexing its connections by epoll.
+ * Items are delimited as in ReadFromSocketFFNode, and each connection keeps
+ * its own line buffer and micro-batch, so that items from a connection are
+ * delivered in order.
+ */
+class ReadFromSocketsFFNode : public NonOrderingFarm {
+ public:
+  ReadFromSocketsFFNode(int readers, std::vector<socket_endpoint> endpoints,
+                        int port, unsigned connections, char delimiter,
+                        size_t read_size, bool per_connection,
+                        std::shared_ptr<std::atomic<int>> bound_port) {
+    std::vector<ff_node *> workers;
+    for (int i = 0; i < readers; ++i)
+      workers.push_back(new Reader(delimiter, read_size));
+    this->setEmitterF(new Dispatcher(readers, endpoints, port, connections,
+                                     per_connection, bound_port));
+    this->add_workers(workers);
+    this->setCollectorF(new ForwardingCollector(readers));
+    this->cleanup_all();
+  }
+
+ private:
+  /*
+   * The Dispatcher opens the c-streams and assigns connections to readers.
+   */
+  class Dispatcher : public base_emitter {
+   public:
+    Dispatcher(unsigned readers_, std::vector<socket_endpoint> endpoints_,
+               int port_, unsigned connections_, bool per_connection_,
+               std::shared_ptr<std::atomic<int>> bound_port_)
+        : base_emitter(readers_),
+          readers(readers_),
+          endpoints(endpoints_),
+          port(port_),
+          connections(connections_),
+          per_connection(per_connection_),
+          bound_port(bound_port_) {}
+
+    void begin_callback() {
+      auto state = std::make_shared<sockets_state>();
+      unsigned ntags = per_connection ? connections : 1;
+      for (unsigned i = 0; i < ntags; ++i)
+        state->tags.push_back(pico::base_microbatch::fresh_tag());
+
+      for (auto tag : state->tags) begin_cstream(tag);
+
+      if (endpoints.empty()) {
+        state->listen_fd = listen_on(port);
+        state->expected = connections;
+        state->share = (connections + readers - 1) / readers;
+      }
+
+      /* round-robin assignment of the endpoints */
+      std::vector<sockets_task *> tasks;
+      for (unsigned i = 0; i < readers; ++i) {
+        tasks.push_back(NEW<sockets_task>());
+        tasks.back()->state = state;
+      }
+      for (unsigned i = 0; i < endpoints.size(); ++i)
+        tasks[i % readers]->endpoints.emplace_back(endpoints[i], i);
+
+      for (unsigned i = 0; i < readers; ++i) {
+        auto tag = state->tags[0];
+        send_mb_to(NEW<pico::mb_wrapped<sockets_task>>(tag, tasks[i]), i);
+      }
+
+      for (auto tag : state->tags) end_cstream(tag);
+    }
+
+    void kernel(pico::base_microbatch *) { assert(false); }
+
+   private:
+    unsigned readers;
+    std::vector<socket_endpoint> endpoints;
+    int port;
+    unsigned connections;
+    bool per_connection;
+    std::shared_ptr<std::atomic<int>> bound_port;
+
+    /* binds and listens, publishing the actual port (ephemeral if 0) */
+    int listen_on(int port) {
+      int option = 1;
+      struct sockaddr_in addr;
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      if (fd < 0) error("ERROR opening socket");
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+      bzero((char *)&addr, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+      if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        error("ERROR on binding");
+      if (listen(fd, connections) < 0) error("ERROR on listening");
+      socklen_t len = sizeof(addr);
+      if (getsockname(fd, (struct sockaddr *)&addr, &len) < 0)
+        error("ERROR on getsockname");
+      *bound_port = ntohs(addr.sin_port);
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+      return fd;
+    }
+
+    void error(const char *msg) {
+      perror(msg);
+      exit(0);
+    }
+  };
+
+  /*
+   * A Reader serves a set of connections until all of them are closed.
+   */
+  class Reader : public base_filter {
+    typedef pico::Microbatch<pico::Token<std::string>> mb_t;
+
+    struct connection {
+      connection(int fd_, pico::base_microbatch::tag_t tag_, size_t read_size)
+          : fd(fd_), tag(tag_), buffer(read_size) {}
+      int fd;
+      pico::base_microbatch::tag_t tag;
+      pico::LineBuffer buffer;
+      mb_t *mb = nullptr;
+    };
+
+   public:
+    Reader(char delimiter_, size_t read_size_)
+        : delimiter(delimiter_), read_size(read_size_) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<sockets_task> *>(in_mb);
+      sockets_task *task = wmb->get();
+      auto &state = *task->state;
+      struct epoll_event ev, events[64];
+
+      epfd = epoll_create1(0);
+      if (epfd < 0) error("ERROR creating epoll instance");
+
+      /* connect mode: open all the assigned connections */
+      for (auto &e : task->endpoints)
+        add_connection(connect_to(e.first), state.tag(e.second));
+
+      /* listen mode: compete with the other readers for accepting */
+      accepted = 0;
+      if (state.listen_fd >= 0) {
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.ptr = nullptr;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, state.listen_fd, &ev) < 0)
+          error("ERROR on epoll_ctl");
+      }
+
+      while (open_connections ||
+             state.accepted.load(std::memory_order_relaxed) < state.expected) {
+        int n = epoll_wait(epfd, events, 64, SOCKETS_IDLE_MS);
+        if (n < 0 && errno != EINTR) error("ERROR on epoll_wait");
+        if (n <= 0) {
+          /* idle: do not retain partial micro-batches */
+          for (auto c : connections) flush(*c);
+          continue;
+        }
+        for (int i = 0; i < n; ++i) {
+          if (!events[i].data.ptr)
+            accept_from(state);
+          else
+            serve(*reinterpret_cast<connection *>(events[i].data.ptr));
+        }
+      }
+
+      close(epfd);
+      DELETE(task);
+      DELETE(wmb);
+    }
+
+   private:
+    char delimiter;
+    size_t read_size;
+    int epfd = -1;
+    unsigned open_connections = 0, accepted = 0;
+    std::vector<connection *> connections;
+
+    /* resolves the endpoint by getaddrinfo, that is reentrant */
+    int connect_to(const socket_endpoint &e) {
+      struct addrinfo hints, *res;
+      bzero((char *)&hints, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      auto port = std::to_string(e.second);
+      int rc = getaddrinfo(e.first.c_str(), port.c_str(), &hints, &res);
+      if (rc) {
+        fprintf(stderr, "ERROR, no such host: %s\n", gai_strerror(rc));
+        exit(0);
+      }
+      int fd = -1;
+      for (auto ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (!connect(fd, ai->ai_addr, ai->ai_addrlen)) break;
+        close(fd);
+        fd = -1;
+      }
+      freeaddrinfo(res);
+      if (fd < 0) error("ERROR connecting");
+      return fd;
+    }
+
+    /* accepts a single connection per event, up to the share of the reader */
+    void accept_from(sockets_state &state) {
+      int fd = accept(state.listen_fd, NULL, NULL);
+      if (fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+          error("ERROR on accept");
+        return;
+      }
+      unsigned i = state.accepted++;
+      if (i < state.expected)
+        add_connection(fd, state.tag(i));
+      else
+        close(fd);  // more connections than expected
+      if (++accepted == state.share) {
+        /* leave the remaining connections to the other readers */
+        epoll_ctl(epfd, EPOLL_CTL_DEL, state.listen_fd, NULL);
+      }
+    }
+
+    void add_connection(int fd, pico::base_microbatch::tag_t tag) {
+      struct epoll_event ev;
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+      auto c = new connection(fd, tag, read_size);
+      c->mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+      ev.events = EPOLLIN;
+      ev.data.ptr = c;
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        error("ERROR on epoll_ctl");
+      connections.push_back(c);
+      ++open_connections;
+    }
+
+    /* reads until the connection would block or gets closed */
+    void serve(connection &c) {
+      auto read_f = [&](char *dst, size_t size) {
+        return read(c.fd, dst, size);
+      };
+      const char *rec;
+      size_t len;
+      ssize_t n;
+      while ((n = c.buffer.fill(read_f)) > 0)
+        while (c.buffer.next(delimiter, rec, len)) emit(c, rec, len);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+      if (n < 0) error("ERROR reading from socket");
+
+      /* end of stream */
+      if (c.buffer.remainder(rec, len)) emit(c, rec, len);
+      if (!c.mb->empty())
+        ff_send_out(reinterpret_cast<void *>(c.mb));
+      else
+        DELETE(c.mb);
+      epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, NULL);
+      close(c.fd);
+      connections.erase(std::find(connections.begin(), connections.end(), &c));
+      delete &c;
+      --open_connections;
+    }
+
+    inline void emit(connection &c, const char *rec, size_t len) {
+      new (c.mb->allocate()) std::string(rec, len);
+      c.mb->commit();
+      if (c.mb->full()) {
+        ff_send_out(reinterpret_cast<void *>(c.mb));
+        c.mb = NEW<mb_t>(c.tag, pico::global_params.MICROBATCH_SIZE);
+      }
+    }
+
+    void flush(connection &c) {
+      if (!c.mb->empty()) {
+        ff_send_out(reinterpret_cast<void *>(c.mb));
+        c.mb = NEW<mb_t>(c.tag, pico::global_params.MICROBATCH_SIZE);
+      }
+    }
+
+    void error(const char *msg) {
+      perror(msg);
+      exit(0);
+    }
+  };
+};
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_READFROMSOCKETSFFNODE_HPP_ */
@@ -21,18 +21,127 @@
 #ifndef INTERNALS_FFOPERATORS_INOUT_READFROMSTDINFFNODE_HPP_
 #define INTERNALS_FFOPERATORS_INOUT_READFROMSTDINFFNODE_HPP_
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
 #include <ff/node.hpp>
 
 #include "pico/Internals/Microbatch.hpp"
 #include "pico/Internals/utils.hpp"
 
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
 #include "pico/ff_implementation/ff_config.hpp"
 
-#define CHUNK_SIZE 512
+/* maximum size (in bytes) of the reads from the standard input */
+#define STDIN_BLOCK_SIZE (1 << 20)
+
+/*
+ * A delimiter-aligned block of the standard input.
+ * All the records in a block are terminated, except for the last record of
+ * the last block.
+ */
+struct stdin_block {
+  stdin_block(size_t seq_, char *data_, size_t size_)
+      : seq(seq_), data(data_), size(size_) {}
+  ~stdin_block() { FREE(data); }
+
+  size_t seq;  // position of the block within the input
+  char *data;
+  size_t size;
+};
+
+/*
+ * Reads the standard input by large read(2) calls, bypassing iostreams, and
+ * cuts the byte stream into delimiter-aligned blocks.
+ *
+ * A block is cut after each read, so that records are not held back when the
+ * input is slow (e.g., a stream). Only the unterminated tail of a read is
+ * copied, into the next block.
+ */
+class stdin_reader {
+ public:
+  stdin_reader(char delimiter_) : delimiter(delimiter_) {}
+
+  /* calls on_block(b) on each block, in order */
+  template <typename F>
+  void read(F &&on_block) {
+    size_t capacity = STDIN_BLOCK_SIZE, size = 0, seq = 0;
+    char *data = (char *)MALLOC(capacity);
+    while (true) {
+      ssize_t n = ::read(STDIN_FILENO, data + size, capacity - size);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        perror("ERROR reading from stdin");
+        exit(1);
+      }
+      if (!n) break;
+      size += n;
+
+      /* cut after the last delimiter */
+      char *last = (char *)memrchr(data, delimiter, size);
+      if (last) {
+        size_t cut = last - data + 1, tail = size - cut;
+        char *next = (char *)MALLOC(capacity);
+        memcpy(next, data + cut, tail);
+        on_block(NEW<stdin_block>(seq++, data, cut));
+        data = next;
+        size = tail;
+      } else if (size == capacity) {
+        /* a record longer than the block */
+        char *tmp = (char *)MALLOC(2 * capacity);
+        memcpy(tmp, data, size);
+        FREE(data);
+        data = tmp;
+        capacity *= 2;
+      }
+    }
+
+    /* unterminated last record */
+    if (size)
+      on_block(NEW<stdin_block>(seq++, data, size));
+    else
+      FREE(data);
+  }
+
+ private:
+  char delimiter;
+};
+
+/*
+ * Splits a block into records, calling send(mb) on each micro-batch.
+ */
+template <typename TokenType, typename Send>
+static void tokenize_stdin_block(const stdin_block &b, char delimiter,
+                                 pico::base_microbatch::tag_t tag,
+                                 Send &&send) {
+  typedef pico::Microbatch<TokenType> mb_t;
+  mb_t *mb = nullptr;
+  const char *p = b.data, *end = b.data + b.size;
+  while (p < end) {
+    const char *d = (const char *)memchr(p, delimiter, end - p);
+    if (!d) d = end;
+    if (!mb) mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+    new (mb->allocate()) std::string(p, d - p);
+    mb->commit();
+    if (mb->full()) {
+      send(mb);
+      mb = nullptr;
+    }
+    p = d + 1;
+  }
+  if (mb) send(mb);
+}
 
 /*
  * TODO only works with non-decorating token
@@ -41,7 +150,8 @@
 template <typename TokenType>
 class ReadFromStdInFFNode : public base_filter {
  public:
-  ReadFromStdInFFNode(char delimiter_) : delimiter(delimiter_) {}
+  ReadFromStdInFFNode(char delimiter_)
+      : delimiter(delimiter_), reader(delimiter_) {}
 
   void kernel(pico::base_microbatch *) { assert(false); }
 
@@ -49,35 +159,138 @@ class ReadFromStdInFFNode : public base_filter {
     /* get a fresh tag */
     tag = pico::base_microbatch::fresh_tag();
     begin_cstream(tag);
-    auto mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
-    std::string str;
-
-    while (std::getline(std::cin, str, delimiter)) {
-      new (mb->allocate()) std::string(str);
-      mb->commit();
-      if (mb->full()) {
-        send_mb(mb);
-        mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
-      }
-    }
 
-    if (!mb->empty())
-      send_mb(mb);
-    else
-      DELETE(mb);
+    reader.read([this](stdin_block *b) {
+      tokenize_stdin_block<TokenType>(
+          *b, delimiter, tag,
+          [this](pico::base_microbatch *mb) { send_mb(mb); });
+      DELETE(b);
+    });
 
     end_cstream(tag);
   }
 
  private:
-  typedef pico::Microbatch<TokenType> mb_t;
   char delimiter;
+  stdin_reader reader;
   pico::base_microbatch::tag_t tag = 0;  // a tag for the generated collection
+};
+
+/**
+ * The parallel ReadFromStdIn farm.
+ *
+ * The emitter reads delimiter-aligned blocks, that are tokenized by the
+ * workers. If ordered, the collector restores the input order by block
+ * sequence numbers.
+ */
+template <typename TokenType>
+class ReadFromStdInFFNode_par : public NonOrderingFarm {
+  /* the micro-batches produced from a block */
+  struct tokenized_block {
+    size_t seq;
+    std::vector<pico::base_microbatch *> mbs;
+  };
 
-  void error(const char *msg) {
-    perror(msg);
-    exit(0);
+ public:
+  ReadFromStdInFFNode_par(int par, char delimiter, bool ordered) {
+    std::vector<ff::ff_node *> workers;
+    for (int i = 0; i < par; ++i)
+      workers.push_back(new Tokenizer(delimiter, ordered));
+    this->setEmitterF(new Reader(delimiter, par));
+    this->add_workers(workers);
+    if (ordered)
+      this->setCollectorF(new ReorderingCollector(par));
+    else
+      this->setCollectorF(new ForwardingCollector(par));
+    this->cleanup_all();
   }
+
+ private:
+  class Reader : public base_emitter {
+   public:
+    Reader(char delimiter, unsigned nw) : base_emitter(nw), reader(delimiter) {}
+
+    void begin_callback() {
+      auto tag = pico::base_microbatch::fresh_tag();
+      begin_cstream(tag);
+      reader.read([&](stdin_block *b) {
+        ff_send_out(NEW<pico::mb_wrapped<stdin_block>>(tag, b));
+      });
+      end_cstream(tag);
+    }
+
+    void kernel(pico::base_microbatch *) { assert(false); }
+
+   private:
+    stdin_reader reader;
+  };
+
+  class Tokenizer : public base_filter {
+   public:
+    Tokenizer(char delimiter_, bool ordered_)
+        : delimiter(delimiter_), ordered(ordered_) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<stdin_block> *>(in_mb);
+      stdin_block *b = wmb->get();
+      auto tag = wmb->tag();
+      if (ordered) {
+        auto t = NEW<tokenized_block>();
+        t->seq = b->seq;
+        tokenize_stdin_block<TokenType>(
+            *b, delimiter, tag,
+            [t](pico::base_microbatch *mb) { t->mbs.push_back(mb); });
+        ff_send_out(NEW<pico::mb_wrapped<tokenized_block>>(tag, t));
+      } else
+        tokenize_stdin_block<TokenType>(
+            *b, delimiter, tag,
+            [this](pico::base_microbatch *mb) { ff_send_out(mb); });
+      DELETE(b);
+      DELETE(wmb);
+    }
+
+   private:
+    char delimiter;
+    bool ordered;
+  };
+
+  /*
+   * Sends out the micro-batches of each block in block order, holding back
+   * the blocks that arrive ahead of their turn.
+   */
+  class ReorderingCollector : public base_sync_duplicate {
+   public:
+    using base_sync_duplicate::base_sync_duplicate;
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<tokenized_block> *>(in_mb);
+      tokenized_block *t = wmb->get();
+      held[t->seq] = t;
+      DELETE(wmb);
+      for (auto it = held.begin(); it != held.end() && it->first == next;
+           it = held.erase(it), ++next) {
+        for (auto mb : it->second->mbs) ff_send_out(mb);
+        DELETE(it->second);
+      }
+    }
+
+    void cstream_end_callback(pico::base_microbatch::tag_t) {
+      assert(held.empty());
+    }
+
+   private:
+    std::map<size_t, tokenized_block *> held;
+    size_t next = 0;
+  };
 };
 
+template <typename TokenType>
+static ff::ff_node *make_ReadFromStdInFFNode(int par, char delimiter,
+                                             bool ordered) {
+  if (par > 1)
+    return new ReadFromStdInFFNode_par<TokenType>(par, delimiter, ordered);
+  assert(par == 1);
+  return new ReadFromStdInFFNode<TokenType>(delimiter);
+}
+
 #endif /* INTERNALS_FFOPERATORS_INOUT_READFROMSTDINFFNODE_HPP_ */
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_READTEXTRECORDSFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_READTEXTRECORDSFFNODE_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/LineBuffer.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/OperatorsFFNodes/InOut/ReadFromFileFFNode.hpp"
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/* size (in bytes) of each read from a text file */
+#define TEXT_READ_SIZE (1 << 20)
+
+/*
+ * Reads a range of a text file into micro-batches of typed records.
+ *
+ * Records are parsed in place within the read buffer and built directly into
+ * micro-batch slots. Malformed records are dropped.
+ *
+ * A Parser provides:
+ * - record_t, the type of the records
+ * - format_t, the parser configuration
+ * - skip_header(), whether the first line of the file is to be skipped
+ * - parse(p, end, at_eof, rec, ok), that parses the record starting at p
+ *   into rec and returns the pointer past its end, or nullptr if the record is
+ *   not complete within [p, end) and more data may follow (!at_eof)
+ */
+template <typename Parser>
+class text_range_reader {
+  typedef typename Parser::record_t record_t;
+  typedef pico::Microbatch<pico::Token<record_t>> mb_t;
+
+ public:
+  text_range_reader(std::string fname,
+                    const typename Parser::format_t &format)
+      : parser(format), buf(TEXT_READ_SIZE) {
+    fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "Unable to open input file %s\n", fname.c_str());
+      exit(1);
+    }
+  }
+
+  ~text_range_reader() { ::close(fd); }
+
+  off_t file_size() {
+    struct stat st;
+    fstat(fd, &st);
+    return st.st_size;
+  }
+
+  /* calls send(mb) on each complete micro-batch */
+  template <typename Send>
+  void read(off_t begin, off_t end, pico::base_microbatch::tag_t tag,
+            Send &&send) {
+    off_t pos = begin;
+    bool eof = false, skip = parser.skip_header() && begin == 0;
+    auto read_f = [&](char *p, size_t size) {
+      ssize_t n;
+      do
+        n = pread(fd, p, std::min<off_t>(size, end - pos), pos);
+      while (n < 0 && errno == EINTR);
+      if (n < 0) {
+        perror("ERROR reading input file");
+        exit(1);
+      }
+      pos += n;
+      return n;
+    };
+
+    mb_t *mb = nullptr;
+    record_t rec;  // moved into a slot once complete and valid
+    while (!eof) {
+      eof = (buf.fill(read_f) <= 0 || pos == end);
+      const char *p = buf.data(), *e = p + buf.size();
+
+      if (skip) {
+        const char *nl = (const char *)memchr(p, '\n', e - p);
+        if (!nl && !eof) continue;
+        p = nl ? nl + 1 : e;
+        skip = false;
+      }
+
+      while (p < e) {
+        bool ok;
+        const char *next = parser.parse(p, e, eof, rec, ok);
+        if (!next) break;  // incomplete record
+        p = next;
+        if (!ok) continue;
+        if (!mb) mb = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+        new (mb->allocate()) record_t(std::move(rec));
+        mb->commit();
+        if (mb->full()) {
+          send(mb);
+          mb = nullptr;
+        }
+      }
+      buf.consume(p - buf.data());
+    }
+
+    /* remainder micro-batch */
+    if (mb) send(mb);
+  }
+
+ private:
+  Parser parser;
+  pico::LineBuffer buf;
+  int fd;
+};
+
+/**
+ * The non-ordering farm for reading text records.
+ * The file is partitioned into line-aligned chunks, pulled by the workers.
+ */
+template <typename Parser>
+class ReadTextRecordsFFNode_par : public NonOrderingFarm {
+  typedef typename Parser::format_t format_t;
+
+ public:
+  ReadTextRecordsFFNode_par(int par, std::string fname,
+                            const format_t &format) {
+    std::vector<ff::ff_node *> workers;
+    for (int i = 0; i < par; ++i) workers.push_back(new Worker(fname, format));
+    this->setEmitterF(new FilePartitioner(fname, par));
+    this->add_workers(workers);
+    this->setCollectorF(new ForwardingCollector(par));
+    this->set_scheduling_ondemand();
+    this->cleanup_all();
+  }
+
+ private:
+  class Worker : public base_filter {
+   public:
+    Worker(std::string fname, const format_t &format)
+        : reader(fname, format) {}
+
+    void kernel(pico::base_microbatch *in_mb) {
+      auto wmb = reinterpret_cast<pico::mb_wrapped<prange> *>(in_mb);
+      prange *r = wmb->get();
+      reader.read(r->begin, r->end, wmb->tag(),
+                  [this](pico::base_microbatch *mb) { ff_send_out(mb); });
+      DELETE(r);
+      DELETE(wmb);
+    }
+
+   private:
+    text_range_reader<Parser> reader;
+  };
+};
+
+/**
+ * Sequential node for reading text records.
+ */
+template <typename Parser>
+class ReadTextRecordsFFNode_seq : public base_filter {
+ public:
+  ReadTextRecordsFFNode_seq(std::string fname,
+                            const typename Parser::format_t &format)
+      : reader(fname, format) {}
+
+  void begin_callback() {
+    auto tag = pico::base_microbatch::fresh_tag();
+    begin_cstream(tag);
+    reader.read(0, reader.file_size(), tag,
+                [this](pico::base_microbatch *mb) { send_mb(mb); });
+    end_cstream(tag);
+  }
+
+  void kernel(pico::base_microbatch *) { assert(false); }
+
+ private:
+  text_range_reader<Parser> reader;
+};
+
+template <typename Parser>
+static ff::ff_node *make_ReadTextRecordsFFNode(
+    int par, std::string fname, const typename Parser::format_t &format) {
+  if (par > 1)
+    return new ReadTextRecordsFFNode_par<Parser>(par, fname, format);
+  assert(par == 1);
+  return new ReadTextRecordsFFNode_seq<Parser>(fname, format);
+}
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_READTEXTRECORDSFFNODE_HPP_ */
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_WRITEBINARYFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_WRITEBINARYFFNODE_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/BinaryFormat.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/emitters.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/*
+ * Appends whole blocks to a binary file.
+ *
+ * Blocks are self-contained, so concurrent writers append them in any order:
+ * each writer reserves a file range by bumping the shared tail offset, then
+ * fills it by a positioned write, with no further synchronization.
+ *
+ * The file is rewritten by each run: the first writer starting the run
+ * truncates it, the others find it already open.
+ */
+class binary_appender {
+ public:
+  binary_appender(std::string fname_, const pico::binary_file_header &h_)
+      : fname(fname_), h(h_) {}
+
+  ~binary_appender() {
+    if (fd >= 0) ::close(fd);
+  }
+
+  binary_appender(const binary_appender &) = delete;
+  binary_appender &operator=(const binary_appender &) = delete;
+
+  /* to be called by each writer at the beginning of its run-th run */
+  void open(unsigned long long run) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (run <= opened) return;
+    if (fd >= 0) ::close(fd);
+    fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      fprintf(stderr, "Unable to open output file %s\n", fname.c_str());
+      exit(1);
+    }
+    write_at((const char *)&h, sizeof(h), 0);
+    tail = sizeof(h);
+    opened = run;
+  }
+
+  void append(const char *data, size_t size) {
+    write_at(data, size, tail.fetch_add(size));
+  }
+
+ private:
+  std::string fname;
+  pico::binary_file_header h;
+  std::mutex mutex;
+  unsigned long long opened = 0;  // the last opened run
+  int fd = -1;
+  std::atomic<off_t> tail;
+
+  void write_at(const char *data, size_t size, off_t offset) {
+    while (size) {
+      ssize_t n = pwrite(fd, data, size, offset);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        perror("ERROR writing output file");
+        exit(1);
+      }
+      data += n;
+      size -= n;
+      offset += n;
+    }
+  }
+};
+
+/*
+ * TODO only works with non-decorating token
+ */
+
+template <typename In>
+class WriteBinaryFFNode : public base_filter {
+  typedef pico::binary_codec<In> codec;
+
+ public:
+  WriteBinaryFFNode(std::shared_ptr<binary_appender> out_, size_t block_size_)
+      : out(out_), block_size(block_size_) {}
+
+  /* sink node */
+  bool propagate_cstream_sync() { return false; }
+
+  void begin_callback() { out->open(++runs); }
+
+  void kernel(pico::base_microbatch *in_mb) {
+    auto mb = reinterpret_cast<pico::Microbatch<pico::Token<In>> *>(in_mb);
+    for (In &in : *mb) {
+      block.add(in);
+      if (block.payload_size() >= block_size) flush();
+    }
+    DELETE(mb);
+  }
+
+  void end_callback() { flush(); }
+
+ private:
+  std::shared_ptr<binary_appender> out;
+  unsigned long long runs = 0;
+  size_t block_size;
+  typename codec::block block;
+  std::vector<char> buf;
+
+  void flush() {
+    if (!block.count()) return;
+    buf.resize(block.bytes());
+    block.serialize(buf.data());
+    out->append(buf.data(), buf.size());
+    block.clear();
+  }
+};
+
+/**
+ * The parallel WriteBinary non-ordering farm.
+ * Each worker builds its own blocks, that are appended to the same file.
+ */
+template <typename In>
+class WriteBinaryFarm : public NonOrderingFarm {
+ public:
+  WriteBinaryFarm(int par, std::shared_ptr<binary_appender> out,
+                  size_t block_size) {
+    std::vector<ff::ff_node *> w;
+    for (int i = 0; i < par; ++i)
+      w.push_back(new WriteBinaryFFNode<In>(out, block_size));
+    this->setEmitterF(new ForwardingEmitter(par));
+    this->add_workers(w);
+    this->setCollectorF(new ForwardingCollector(par));
+    this->cleanup_all();
+  }
+};
+
+template <typename In>
+static ff::ff_node *make_WriteBinaryFFNode(int par, std::string fname,
+                                           size_t block_size) {
+  auto out = std::make_shared<binary_appender>(fname,
+                                               pico::binary_header<In>());
+  if (par > 1) return new WriteBinaryFarm<In>(par, out, block_size);
+  assert(par == 1);
+  return new WriteBinaryFFNode<In>(out, block_size);
+}
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_WRITEBINARYFFNODE_HPP_ */
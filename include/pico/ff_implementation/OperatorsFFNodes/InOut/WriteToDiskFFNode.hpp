@@ -21,64 +21,367 @@
 #ifndef INTERNALS_FFOPERATORS_INOUT_WRITETODISKFFNODE_HPP_
 #define INTERNALS_FFOPERATORS_INOUT_WRITETODISKFFNODE_HPP_
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <ff/farm.hpp>
 #include <ff/node.hpp>
 
+#include "pico/FormatBuffer.hpp"
+#include "pico/Internals/Compression.hpp"
 #include "pico/Internals/Microbatch.hpp"
 #include "pico/Internals/Token.hpp"
 #include "pico/Internals/utils.hpp"
 
+#include "pico/ff_implementation/SupportFFNodes/ByKeyEmitter.hpp"
 #include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/emitters.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
 
 /*
- * TODO only works with non-decorating token
+ * Size (in bytes) of the output buffers.
  */
+#define WRITE_BUFFER_SIZE (1 << 20)
 
-template <typename In>
-class WriteToDiskFFNode : public base_filter {
+/*
+ * A buffered file writer.
+ *
+ * Data is formatted directly into a large page-aligned buffer, that is
+ * written out by a single write(2) once full. No flush happens while writing,
+ * except when the writer is flushed or closed.
+ * If the file is compressed, each buffer is written as independent blocks.
+ */
+class file_writer {
  public:
-  WriteToDiskFFNode(std::string fname, std::function<std::string(In)> kernel_)
-      : wkernel(kernel_), outfile(fname) {
-    if (!outfile.is_open()) {
-      std::cerr << "Unable to open output file\n";
+  file_writer(std::string fname_, pico::compression c_)
+      : fname(fname_), c(c_), buf(WRITE_BUFFER_SIZE) {
+    open();
+  }
+
+  ~file_writer() {
+    if (fd >= 0) close();
+  }
+
+  file_writer(const file_writer &) = delete;
+  file_writer &operator=(const file_writer &) = delete;
+
+  /* the buffer to be written into */
+  inline pico::FormatBuffer &buffer() { return buf; }
+
+  /* writes out the buffer if full */
+  inline void sync() {
+    if (buf.size() >= WRITE_BUFFER_SIZE) flush();
+  }
+
+  void flush() {
+    if (compressor && !buf.empty()) {
+      compressor->compress(buf.data(), buf.size(), cbuf);
+      write_out(cbuf.data(), cbuf.size());
+      cbuf.clear();
+    } else
+      write_out(buf.data(), buf.size());
+    buf.clear();
+  }
+
+  void close() {
+    flush();
+    if (compressor) {
+      compressor->finish(cbuf);
+      write_out(cbuf.data(), cbuf.size());
+      cbuf.clear();
+    }
+    ::close(fd);
+    fd = -1;
+  }
+
+  /* truncates the (closed) file, for writing it again from scratch */
+  void reopen() {
+    assert(fd < 0);
+    written = 0;
+    open();
+  }
+
+  bool is_open() const { return fd >= 0; }
+
+  /* number of bytes written so far (if compressed, only after flushing) */
+  off_t size() const { return written + buf.size(); }
+
+  const std::string &name() const { return fname; }
+
+ private:
+  std::string fname;
+  pico::compression c;
+  int fd = -1;
+  pico::FormatBuffer buf;
+  std::unique_ptr<pico::block_compressor> compressor;
+  std::vector<char> cbuf;
+  off_t written = 0;
+
+  void open() {
+    if (c != pico::compression::NONE)
+      compressor.reset(new pico::block_compressor(c));
+    fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      std::cerr << "Unable to open output file " << fname << "\n";
       assert(false);
     }
   }
 
-  /* sink node */
-  bool propagate_cstream_sync() { return false; }
+  void write_out(const char *data, size_t size) {
+    while (size) {
+      ssize_t n = ::write(fd, data, size);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        perror("ERROR writing output file");
+        exit(1);
+      }
+      data += n;
+      size -= n;
+      written += n;
+    }
+  }
+};
 
-  void kernel(pico::base_microbatch* in_mb) {
-    auto mb = reinterpret_cast<pico::Microbatch<pico::Token<In>>*>(in_mb);
-    for (In& in : *mb) outfile << wkernel(in) << std::endl;
-    DELETE(mb);
+/*
+ * Merges the shards written in parallel into a single file.
+ *
+ * Each shard writer calls merge() once done. The call blocks until all the
+ * shards are complete, then each shard is copied at its offset within the
+ * merged file (i.e., after all the preceding shards) by positioned writes,
+ * in parallel with the other shards.
+ */
+class shard_merger {
+ public:
+  shard_merger(std::string fname_, unsigned shards_)
+      : fname(fname_), shards(shards_), sizes(shards_, 0) {}
+
+  void merge(unsigned shard, const std::string &shard_fname, off_t size) {
+    off_t offset = 0;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      auto my_round = round;
+      sizes[shard] = size;
+      if (++arrived == shards) {
+        /* the last shard prepares the merged file */
+        off_t total = 0;
+        for (auto s : sizes) total += s;
+        int fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, total)) {
+          perror("ERROR preparing output file");
+          exit(1);
+        }
+        ::close(fd);
+        arrived = 0;
+        ++round;
+        cv.notify_all();
+      } else
+        cv.wait(lock, [&] { return round != my_round; });
+      for (unsigned i = 0; i < shard; ++i) offset += sizes[i];
+    }
+
+    int in_fd = ::open(shard_fname.c_str(), O_RDONLY);
+    int out_fd = ::open(fname.c_str(), O_WRONLY);
+    if (in_fd < 0 || out_fd < 0) {
+      perror("ERROR merging output file");
+      exit(1);
+    }
+    copy_range(in_fd, out_fd, offset, size);
+    ::close(in_fd);
+    ::close(out_fd);
+    unlink(shard_fname.c_str());
   }
 
  private:
-  std::function<std::string(In)> wkernel;
-  std::ofstream outfile;
+  std::string fname;
+  unsigned shards;
+  std::vector<off_t> sizes;
+  std::mutex mtx;
+  std::condition_variable cv;
+  unsigned arrived = 0, round = 0;
+
+  /* copies size bytes from the beginning of in_fd at offset of out_fd */
+  void copy_range(int in_fd, int out_fd, off_t offset, off_t size) {
+    loff_t off_in = 0, off_out = offset;
+    while (size) {
+      ssize_t n = copy_file_range(in_fd, &off_in, out_fd, &off_out, size, 0);
+      if (n <= 0) break;  // not supported: fall back to pread/pwrite
+      size -= n;
+    }
+    if (!size) return;
+    std::vector<char> tmp(WRITE_BUFFER_SIZE);
+    while (size) {
+      ssize_t n = pread(in_fd, tmp.data(), std::min<off_t>(tmp.size(), size),
+                        off_in);
+      if (n <= 0 || pwrite(out_fd, tmp.data(), n, off_out) != n) {
+        perror("ERROR merging output file");
+        exit(1);
+      }
+      off_in += n;
+      off_out += n;
+      size -= n;
+    }
+  }
 };
 
+/*
+ * TODO only works with non-decorating token
+ */
+
 template <typename In>
-class WriteToDiskFFNode_ostream : public base_filter {
+class base_WriteToDiskFFNode : public base_filter {
  public:
-  WriteToDiskFFNode_ostream(std::string fname) : outfile(fname) {
-    if (!outfile.is_open()) {
-      std::cerr << "Unable to open output file\n";
-      assert(false);
-    }
-  }
+  base_WriteToDiskFFNode(std::string fname)
+      : writer(fname, pico::compression_from_name(fname)) {}
+
+  /*
+   * Writes a shard, possibly of a merged file.
+   */
+  base_WriteToDiskFFNode(std::string fname, pico::compression c,
+                         unsigned shard_ = 0,
+                         std::shared_ptr<shard_merger> merger_ = nullptr)
+      : writer(fname, c), shard(shard_), merger(merger_) {}
 
   /* sink node */
   bool propagate_cstream_sync() { return false; }
 
-  void kernel(pico::base_microbatch* in_mb) {
-    auto mb = reinterpret_cast<pico::Microbatch<pico::Token<In>>*>(in_mb);
-    for (In& in : *mb) outfile << in << std::endl;
+  void kernel(pico::base_microbatch *in_mb) {
+    auto mb = reinterpret_cast<pico::Microbatch<pico::Token<In>> *>(in_mb);
+    auto &out = writer.buffer();
+    for (In &in : *mb) {
+      write(in, out);
+      out.put('\n');
+    }
+    writer.sync();
     DELETE(mb);
   }
 
+  /* the file is written from scratch upon each run */
+  void begin_callback() {
+    if (!writer.is_open()) writer.reopen();
+  }
+
+  void end_callback() {
+    writer.close();
+    if (merger) merger->merge(shard, writer.name(), writer.size());
+  }
+
+ protected:
+  file_writer writer;
+
+  virtual void write(In &, pico::FormatBuffer &) = 0;
+
+ private:
+  unsigned shard = 0;
+  std::shared_ptr<shard_merger> merger;
+};
+
+template <typename In>
+class WriteToDiskFFNode : public base_WriteToDiskFFNode<In> {
+  typedef std::function<void(In &, pico::FormatBuffer &)> kernel_t;
+
+ public:
+  WriteToDiskFFNode(std::string fname, kernel_t kernel_)
+      : base_WriteToDiskFFNode<In>(fname), wkernel(kernel_) {}
+
+  WriteToDiskFFNode(std::string fname, kernel_t kernel_, pico::compression c,
+                    unsigned shard = 0,
+                    std::shared_ptr<shard_merger> merger = nullptr)
+      : base_WriteToDiskFFNode<In>(fname, c, shard, merger),
+        wkernel(kernel_) {}
+
+ private:
+  kernel_t wkernel;
+
+  void write(In &in, pico::FormatBuffer &out) { wkernel(in, out); }
+};
+
+template <typename In>
+class WriteToDiskFFNode_ostream : public base_WriteToDiskFFNode<In> {
+ public:
+  using base_WriteToDiskFFNode<In>::base_WriteToDiskFFNode;
+
+ private:
+  void write(In &in, pico::FormatBuffer &out) { pico::format(out, in); }
+};
+
+namespace pico {
+namespace detail {
+
+/*
+ * detects key-value types
+ */
+template <typename T, typename = void>
+struct has_keytype : std::false_type {};
+
+template <typename T>
+struct has_keytype<T, decltype(void(sizeof(typename T::keytype)))>
+    : std::true_type {};
+
+} /* namespace detail */
+} /* namespace pico */
+
+/**
+ * The parallel WriteToDisk non-ordering farm.
+ *
+ * Each worker writes a shard of the output, either into a separate file or
+ * into a portion of a single file merged at the end of the writing.
+ * Items are distributed either round-robin or by key.
+ */
+template <typename In>
+class WriteToDiskFarm : public NonOrderingFarm {
+ public:
+  WriteToDiskFarm(int par, std::string fname, bool merge, bool by_key,
+                  std::function<void(In &, pico::FormatBuffer &)> *func) {
+    std::shared_ptr<shard_merger> merger;
+    if (merge) merger = std::make_shared<shard_merger>(fname, par);
+    auto c = pico::compression_from_name(fname);
+
+    std::vector<ff::ff_node *> w;
+    for (int i = 0; i < par; ++i) {
+      if (merge) {
+        auto shard = fname + ".part" + std::to_string(i);
+        if (func)
+          w.push_back(new WriteToDiskFFNode<In>(shard, *func, c, i, merger));
+        else
+          w.push_back(new WriteToDiskFFNode_ostream<In>(shard, c, i, merger));
+      } else {
+        auto shard = fname + "." + std::to_string(i);
+        if (func)
+          w.push_back(new WriteToDiskFFNode<In>(shard, *func, c));
+        else
+          w.push_back(new WriteToDiskFFNode_ostream<In>(shard, c));
+      }
+    }
+
+    this->setEmitterF(make_emitter(par, by_key));
+    this->add_workers(w);
+    this->setCollectorF(new ForwardingCollector(par));
+    this->cleanup_all();
+  }
+
  private:
-  std::ofstream outfile;
+  ff::ff_node *make_emitter(int par, bool by_key) {
+    if constexpr (pico::detail::has_keytype<In>::value) {
+      if (by_key) return new ByKeyEmitter<pico::Token<In>>(par);
+    }
+    assert(!by_key);
+    return new ForwardingEmitter(par);
+  }
 };
 
 #endif /* INTERNALS_FFOPERATORS_INOUT_WRITETODISKFFNODE_HPP_ */
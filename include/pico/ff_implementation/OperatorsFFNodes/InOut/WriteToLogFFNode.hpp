@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_WRITETOLOGFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_WRITETOLOGFFNODE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/node.hpp>
+
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/SegmentedLog.hpp"
+#include "pico/Internals/Token.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/emitters.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/*
+ * Appends the items to a partition of a log.
+ */
+class WriteToLogFFNode : public base_filter {
+  typedef pico::Microbatch<pico::Token<std::string>> mb_t;
+
+ public:
+  WriteToLogFFNode(std::string log, unsigned partition, size_t segment_size)
+      : writer(log, partition, segment_size) {}
+
+  /* sink node */
+  bool propagate_cstream_sync() { return false; }
+
+  void kernel(pico::base_microbatch *in_mb) {
+    auto mb = reinterpret_cast<mb_t *>(in_mb);
+    for (std::string &in : *mb) writer.append(in.data(), in.size());
+    DELETE(mb);
+  }
+
+  /* appends after the records written by previous runs */
+  void begin_callback() { writer.open(); }
+
+  void end_callback() { writer.close(); }
+
+ private:
+  pico::log_partition_writer writer;
+};
+
+/**
+ * The parallel WriteToLog non-ordering farm.
+ * Each worker appends to its own partition.
+ */
+class WriteToLogFarm : public NonOrderingFarm {
+ public:
+  WriteToLogFarm(unsigned partitions, std::string log, size_t segment_size) {
+    std::vector<ff::ff_node *> w;
+    for (unsigned p = 0; p < partitions; ++p)
+      w.push_back(new WriteToLogFFNode(log, p, segment_size));
+    this->setEmitterF(new ForwardingEmitter(partitions));
+    this->add_workers(w);
+    this->setCollectorF(new ForwardingCollector(partitions));
+    this->cleanup_all();
+  }
+};
+
+static ff::ff_node *make_WriteToLogFFNode(unsigned partitions,
+                                          std::string log,
+                                          size_t segment_size) {
+  pico::log_mkdir(log);
+  if (partitions > 1) return new WriteToLogFarm(partitions, log, segment_size);
+  assert(partitions == 1);
+  return new WriteToLogFFNode(log, 0, segment_size);
+}
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_WRITETOLOGFFNODE_HPP_ */
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_INOUT_WRITETOSOCKETFFNODE_HPP_
+#define INTERNALS_FFOPERATORS_INOUT_WRITETOSOCKETFFNODE_HPP_
+
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ff/node.hpp>
+
+#include "pico/FormatBuffer.hpp"
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/Token.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+
+/* default size (in bytes) of the buffers sent to the socket */
+#define SOCKET_WRITE_SIZE (1 << 16)
+
+/* default time (in milliseconds) a non-empty buffer may wait for sending */
+#define SOCKET_LINGER_MS 10
+
+/* maximum number of filled buffers waiting for sending */
+#define SOCKET_PENDING_BUFFERS 16
+
+/*
+ * Batches a byte stream into large buffers, that are sent to a socket by a
+ * dedicated sender thread with gathering writes (writev).
+ *
+ * Buffers are handed to the sender once full, or once they have been waiting
+ * longer than the linger time.
+ * Buffers are recycled, and the producer blocks as soon as too many buffers
+ * are pending, so that a slow receiver back-pressures the pipeline.
+ */
+class socket_writer {
+ public:
+  socket_writer(std::string server_name_, int port_, size_t buffer_size_,
+                unsigned linger_ms_)
+      : server_name(server_name_),
+        port(port_),
+        buffer_size(buffer_size_),
+        linger(linger_ms_) {}
+
+  void start() {
+    sockfd = connect_to(server_name, port);
+
+    local = pico::FormatBuffer(buffer_size);
+    current = pico::FormatBuffer(buffer_size);
+    done = false;
+    sender = std::thread(&socket_writer::send_loop, this);
+  }
+
+  void stop() {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      if (!current.empty()) hand_off(lock);
+      done = true;
+    }
+    cv_pending.notify_one();
+    sender.join();
+    ::close(sockfd);
+  }
+
+  /*
+   * Appends data to the current buffer.
+   * Data is formatted into a local buffer with no locking, so that the
+   * sender is only held while moving the local buffer into the current one:
+   * by swapping if the current buffer is empty, by copying otherwise.
+   * The current buffer is handed off to the sender if full after appending.
+   */
+  template <typename F>
+  void append(F &&append_f) {
+    append_f(local);
+    if (local.empty()) return;
+    std::unique_lock<std::mutex> lock(mtx);
+    if (current.empty()) {
+      since = std::chrono::steady_clock::now();
+      current.swap(local);
+    } else {
+      current.append(local.data(), local.size());
+      local.clear();
+    }
+    if (current.size() >= buffer_size) hand_off(lock);
+  }
+
+  /* hands off the current buffer, if not empty */
+  void flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!current.empty()) hand_off(lock);
+  }
+
+ private:
+  std::string server_name;
+  int port;
+  size_t buffer_size;
+  std::chrono::milliseconds linger;
+  int sockfd = -1;
+
+  pico::FormatBuffer local;  // only accessed by the producer
+
+  std::mutex mtx;
+  std::condition_variable cv_pending, cv_free;
+  pico::FormatBuffer current;
+  std::chrono::steady_clock::time_point since;
+  std::deque<pico::FormatBuffer> pending;
+  std::vector<pico::FormatBuffer> free_buffers;
+  bool done = false;
+  std::thread sender;
+
+  /* to be called with the lock held */
+  void hand_off(std::unique_lock<std::mutex> &lock) {
+    cv_free.wait(lock,
+                 [this] { return pending.size() < SOCKET_PENDING_BUFFERS; });
+    pending.push_back(std::move(current));
+    if (!free_buffers.empty()) {
+      current = std::move(free_buffers.back());
+      free_buffers.pop_back();
+    } else
+      current = pico::FormatBuffer(buffer_size);
+    cv_pending.notify_one();
+  }
+
+  void send_loop() {
+    std::vector<pico::FormatBuffer> batch;
+    std::vector<struct iovec> iov;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+      cv_pending.wait_for(lock, linger,
+                          [this] { return !pending.empty() || done; });
+
+      /* linger expired for the buffer being filled */
+      if (pending.empty() && !current.empty() &&
+          std::chrono::steady_clock::now() - since >= linger) {
+        pending.push_back(std::move(current));
+        current = pico::FormatBuffer(buffer_size);
+      }
+
+      if (pending.empty()) {
+        if (done) break;
+        continue;
+      }
+
+      /* take all the pending buffers */
+      while (!pending.empty() && batch.size() < IOV_MAX) {
+        batch.push_back(std::move(pending.front()));
+        pending.pop_front();
+      }
+      cv_free.notify_all();
+
+      lock.unlock();
+      write_all(batch, iov);
+      lock.lock();
+
+      for (auto &b : batch) {
+        b.clear();
+        free_buffers.push_back(std::move(b));
+      }
+      batch.clear();
+    }
+  }
+
+  /* resolves the server by getaddrinfo, that is reentrant */
+  int connect_to(const std::string &server, int port) {
+    struct addrinfo hints, *res;
+    bzero((char *)&hints, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    auto service = std::to_string(port);
+    int rc = getaddrinfo(server.c_str(), service.c_str(), &hints, &res);
+    if (rc) {
+      fprintf(stderr, "ERROR, no such host: %s\n", gai_strerror(rc));
+      exit(0);
+    }
+    int fd = -1;
+    for (auto ai = res; ai; ai = ai->ai_next) {
+      fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) continue;
+      if (!connect(fd, ai->ai_addr, ai->ai_addrlen)) break;
+      close(fd);
+      fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) error("ERROR connecting");
+    return fd;
+  }
+
+  void write_all(std::vector<pico::FormatBuffer> &batch,
+                 std::vector<struct iovec> &iov) {
+    iov.clear();
+    for (auto &b : batch) iov.push_back({(void *)b.data(), b.size()});
+    struct iovec *it = iov.data();
+    int cnt = iov.size();
+    while (cnt) {
+      ssize_t n = writev(sockfd, it, cnt);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        error("ERROR writing to socket");
+      }
+      /* skip fully written buffers and adjust the partial one */
+      while (cnt && (size_t)n >= it->iov_len) {
+        n -= it->iov_len;
+        ++it;
+        --cnt;
+      }
+      if (cnt) {
+        it->iov_base = (char *)it->iov_base + n;
+        it->iov_len -= n;
+      }
+    }
+  }
+
+  void error(const char *msg) {
+    perror(msg);
+    exit(0);
+  }
+};
+
+/*
+ * TODO only works with non-decorating token
+ */
+
+template <typename In, typename TokenType>
+class WriteToSocketFFNode : public base_filter {
+ public:
+  WriteToSocketFFNode(std::string server_name, int port,
+                      std::function<void(In &, pico::FormatBuffer &)> kernel_,
+                      size_t buffer_size, unsigned linger_ms)
+      : wkernel(kernel_), writer(server_name, port, buffer_size, linger_ms) {}
+
+  /* sink node */
+  bool propagate_cstream_sync() { return false; }
+
+  void begin_callback() { writer.start(); }
+
+  void end_callback() { writer.stop(); }
+
+  void cstream_end_callback(pico::base_microbatch::tag_t) { writer.flush(); }
+
+  void kernel(pico::base_microbatch *in_mb) {
+    auto mb = reinterpret_cast<pico::Microbatch<TokenType> *>(in_mb);
+    writer.append([&](pico::FormatBuffer &buf) {
+      for (In &in : *mb) {
+        wkernel(in, buf);
+        buf.put('\n');
+      }
+    });
+    DELETE(mb);
+  }
+
+ private:
+  std::function<void(In &, pico::FormatBuffer &)> wkernel;
+  socket_writer writer;
+};
+
+template <typename In, typename TokenType>
+class WriteToSocketFFNode_ostream : public base_filter {
+ public:
+  WriteToSocketFFNode_ostream(std::string server_name, int port,
+                              size_t buffer_size, unsigned linger_ms)
+      : writer(server_name, port, buffer_size, linger_ms) {}
+
+  /* sink node */
+  bool propagate_cstream_sync() { return false; }
+
+  void begin_callback() { writer.start(); }
+
+  void end_callback() { writer.stop(); }
+
+  void cstream_end_callback(pico::base_microbatch::tag_t) { writer.flush(); }
+
+  void kernel(pico::base_microbatch *in_mb) {
+    auto mb = reinterpret_cast<pico::Microbatch<TokenType> *>(in_mb);
+    writer.append([&](pico::FormatBuffer &buf) {
+      for (In &in : *mb) {
+        pico::format(buf, in);
+        buf.put('\n');
+      }
+    });
+    DELETE(mb);
+  }
+
+ private:
+  socket_writer writer;
+};
+
+#endif /* INTERNALS_FFOPERATORS_INOUT_WRITETOSOCKETFFNODE_HPP_ */
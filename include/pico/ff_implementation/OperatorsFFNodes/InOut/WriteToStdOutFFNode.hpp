@@ -21,8 +21,12 @@
 #ifndef INTERNALS_FFOPERATORS_INOUT_WRITETOSTDOUTFFNODE_HPP_
 #define INTERNALS_FFOPERATORS_INOUT_WRITETOSTDOUTFFNODE_HPP_
 
+#include <functional>
+#include <iostream>
+
 #include <ff/node.hpp>
 
+#include "pico/FormatBuffer.hpp"
 #include "pico/Internals/Microbatch.hpp"
 #include "pico/Internals/TimedToken.hpp"
 #include "pico/Internals/Token.hpp"
@@ -32,10 +36,14 @@
  * TODO only works with non-decorating token
  */
 
+/*
+ * Items of each micro-batch are formatted into a buffer, that is written to
+ * standard output in one shot.
+ */
 template <typename In, typename TokenType>
 class WriteToStdOutFFNode : public base_filter {
  public:
-  WriteToStdOutFFNode(std::function<std::string(In&)> kernel_)
+  WriteToStdOutFFNode(std::function<void(In&, pico::FormatBuffer&)> kernel_)
       : wkernel(kernel_) {}
 
   /* sink node */
@@ -43,12 +51,18 @@ class WriteToStdOutFFNode : public base_filter {
 
   void kernel(pico::base_microbatch* in_mb) {
     auto in_microbatch = reinterpret_cast<pico::Microbatch<TokenType>*>(in_mb);
-    for (In& tt : *in_microbatch) std::cout << wkernel(tt) << std::endl;
+    for (In& tt : *in_microbatch) {
+      wkernel(tt, out);
+      out.put('\n');
+    }
+    std::cout.write(out.data(), out.size()).flush();
+    out.clear();
     DELETE(in_microbatch);
   }
 
  private:
-  std::function<std::string(In&)> wkernel;
+  std::function<void(In&, pico::FormatBuffer&)> wkernel;
+  pico::FormatBuffer out;
 };
 
 template <typename In, typename TokenType>
@@ -59,9 +73,17 @@ class WriteToStdOutFFNode_ostream : public base_filter {
 
   void kernel(pico::base_microbatch* in_mb) {
     auto in_microbatch = reinterpret_cast<pico::Microbatch<TokenType>*>(in_mb);
-    for (In& tt : *in_microbatch) std::cout << tt << std::endl;
+    for (In& tt : *in_microbatch) {
+      pico::format(out, tt);
+      out.put('\n');
+    }
+    std::cout.write(out.data(), out.size()).flush();
+    out.clear();
     DELETE(in_microbatch);
   }
+
+ private:
+  pico::FormatBuffer out;
 };
 
 #endif /* INTERNALS_FFOPERATORS_INOUT_WRITETOSTDOUTFFNODE_HPP_ */
@@ -21,6 +21,8 @@
 #ifndef INTERNALS_FFOPERATORS_PREDUCEWIN_HPP_
 #define INTERNALS_FFOPERATORS_PREDUCEWIN_HPP_
 
+#include <chrono>
+#include <memory>
 #include <unordered_map>
 
 #include <ff/farm.hpp>
@@ -30,6 +32,7 @@
 #include "pico/WindowPolicy.hpp"
 
 #include "pico/ff_implementation/SupportFFNodes/ByKeyEmitter.hpp"
+#include "pico/ff_implementation/SupportFFNodes/ElasticKeyGroups.hpp"
 #include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
 #include "pico/ff_implementation/SupportFFNodes/farms.hpp"
 #include "pico/ff_implementation/ff_config.hpp"
@@ -39,6 +42,10 @@
  * A non-ordering farm is sufficient for keeping intra-key ordering.
  * Only batching windowing is supported by now, windowing is performed by
  * workers.
+ *
+ * Elastic farms partition keys by key groups and adjust the number of active
+ * workers at runtime (see ElasticByKeyEmitter): the windows of moved key groups
+ * are handed off to their new owner.
  */
 template <typename In, typename TokenType>
 class PReduceWin : public NonOrderingFarm {
@@ -47,26 +54,52 @@ class PReduceWin : public NonOrderingFarm {
 
  public:
   PReduceWin(int parallelism, std::function<V(V &, V &)> &preducef,
-             pico::WindowPolicy *win) {
-    auto e = new ByKeyEmitter<TokenType>(parallelism);
-    this->setEmitterF(e);
+             pico::WindowPolicy *win, bool elastic = false) {
+    std::shared_ptr<elastic_stats> stats;
+    std::shared_ptr<keygroup_handoff<groups_state>> handoff;
+    if (elastic) {
+      stats = std::make_shared<elastic_stats>(parallelism);
+      handoff = std::make_shared<keygroup_handoff<groups_state>>();
+      this->setEmitterF(new ElasticByKeyEmitter<TokenType>(parallelism, stats));
+    } else
+      this->setEmitterF(new ByKeyEmitter<TokenType>(parallelism));
     this->setCollectorF(new ForwardingCollector(
         parallelism));  // collects and emits single items
     std::vector<ff_node *> w;
     for (int i = 0; i < parallelism; ++i) {
-      w.push_back(new PReduceWinWorker(preducef, win->win_size()));
+      w.push_back(
+          new PReduceWinWorker(preducef, win->win_size(), i, stats, handoff));
     }
     this->add_workers(w);
     this->cleanup_all();
   }
 
  private:
+  struct key_state {
+    std::unordered_map<K, V> kvmap;  // partial per-window/key reduced value
+    std::unordered_map<K, size_t> kvcountmap;  // per-window/key counter
+  };
+  typedef std::unordered_map<pico::base_microbatch::tag_t, key_state>
+      groups_state;
+
   class PReduceWinWorker : public base_filter {
    public:
-    PReduceWinWorker(std::function<V(V &, V &)> &reducef_, size_t win_size_)
-        : rkernel(reducef_), win_size(win_size_) {}
+    PReduceWinWorker(std::function<V(V &, V &)> &reducef_, size_t win_size_,
+                     unsigned id_, std::shared_ptr<elastic_stats> stats_,
+                     std::shared_ptr<keygroup_handoff<groups_state>> handoff_)
+        : rkernel(reducef_),
+          win_size(win_size_),
+          id(id_),
+          stats(stats_),
+          handoff(handoff_) {}
 
     void kernel(pico::base_microbatch *in_mb_) {
+      if (in_mb_->payload() == PICO_KEYGROUP_MOVE) {
+        move(reinterpret_cast<keygroup_move *>(in_mb_));
+        return;
+      }
+      std::chrono::steady_clock::time_point t0;
+      if (stats) t0 = std::chrono::steady_clock::now();
       auto in_mb = reinterpret_cast<mb_t *>(in_mb_);
       auto tag = in_mb_->tag();
       auto &s(tag_state[tag]);
@@ -89,6 +122,7 @@ class PReduceWin : public NonOrderingFarm {
         }
       }
       DELETE(in_mb);
+      if (stats) stats->processed(id, std::chrono::steady_clock::now() - t0);
     }
 
     void cstream_end_callback(pico::base_microbatch::tag_t tag) {
@@ -110,12 +144,42 @@ class PReduceWin : public NonOrderingFarm {
    private:
     typedef pico::Microbatch<TokenType> mb_t;
     std::function<V(V &, V &)> rkernel;
-    struct key_state {
-      std::unordered_map<K, V> kvmap;  // partial per-window/key reduced value
-      std::unordered_map<K, size_t> kvcountmap;  // per-window/key counter
-    };
-    std::unordered_map<pico::base_microbatch::tag_t, key_state> tag_state;
+    groups_state tag_state;
     size_t win_size;
+    unsigned id;
+    std::shared_ptr<elastic_stats> stats;
+    std::shared_ptr<keygroup_handoff<groups_state>> handoff;
+
+    /* hands the windows of a key group off, or takes them over */
+    void move(keygroup_move *m) {
+      if (m->release) {
+        auto moved = NEW<groups_state>();
+        for (auto &ts : tag_state) {
+          auto &s(ts.second);
+          for (auto it = s.kvmap.begin(); it != s.kvmap.end();) {
+            if (key_group(it->first) == m->group) {
+              auto &ms((*moved)[ts.first]);
+              ms.kvcountmap[it->first] = s.kvcountmap[it->first];
+              ms.kvmap.insert(*it);
+              s.kvcountmap.erase(it->first);
+              it = s.kvmap.erase(it);
+            } else
+              ++it;
+          }
+        }
+        handoff->release(*m, moved);
+      } else {
+        auto moved = handoff->acquire(*m);
+        for (auto &ts : *moved) {
+          auto &s(tag_state[ts.first]);
+          s.kvmap.insert(ts.second.kvmap.begin(), ts.second.kvmap.end());
+          s.kvcountmap.insert(ts.second.kvcountmap.begin(),
+                              ts.second.kvcountmap.end());
+        }
+        DELETE(moved);
+      }
+      DELETE(m);
+    }
   };
 };
 
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALS_FFOPERATORS_WORKSTEALINGBATCH_HPP_
+#define INTERNALS_FFOPERATORS_WORKSTEALINGBATCH_HPP_
+
+#include <cassert>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <ff/farm.hpp>
+
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/utils.hpp"
+
+#include "pico/ff_implementation/OperatorsFFNodes/FusedBatch.hpp"
+#include "pico/ff_implementation/SupportFFNodes/WorkStealingPool.hpp"
+#include "pico/ff_implementation/SupportFFNodes/base_nodes.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+/* the output of a task in an ordered work-stealing farm */
+struct ws_result {
+  unsigned long long seq;
+  std::vector<pico::base_microbatch *> mbs;
+};
+
+/* streams out the results of ordered work-stealing workers in task order */
+class WSReorderCollector : public base_sync_duplicate {
+ public:
+  using base_sync_duplicate::base_sync_duplicate;
+
+  void kernel(pico::base_microbatch *mb) {
+    auto wmb = reinterpret_cast<pico::mb_wrapped<ws_result> *>(mb);
+    auto &buf = buffers[wmb->tag()];
+    buf.pending[wmb->get()->seq] = wmb->get();
+    DELETE(wmb);
+
+    decltype(buf.pending.begin()) it;
+    while ((it = buf.pending.find(buf.next)) != buf.pending.end()) {
+      for (auto out_mb : it->second->mbs) ff_send_out(out_mb);
+      DELETE(it->second);
+      buf.pending.erase(it);
+      ++buf.next;
+    }
+  }
+
+  void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+    assert(buffers[tag].pending.empty());
+    buffers.erase(tag);
+  }
+
+ private:
+  /* the reorder buffer of a c-stream */
+  struct buffer_t {
+    unsigned long long next = 0;
+    std::unordered_map<unsigned long long, ws_result *> pending;
+  };
+
+  std::unordered_map<pico::base_microbatch::tag_t, buffer_t> buffers;
+};
+
+/*
+ * The work-stealing farm executing a run of fused stateless operators, for
+ * kernels with irregular cost per micro-batch.
+ *
+ * The emitter pushes micro-batches to per-worker lock-free queues and wakes
+ * the owner up by a ticket. Upon a ticket, a worker processes micro-batches
+ * until all the queues are empty, taking from its own queue first, then
+ * stealing from the other workers: a worker backed up by an expensive
+ * micro-batch is relieved by the idle ones.
+ *
+ * Tasks are numbered by the emitter, per c-stream: ordered (STREAM) farms
+ * send out one result per task, that the collector reorders by a reorder
+ * buffer.
+ * Workers only process tasks of c-streams they have begun, so that sync
+ * tokens are never overtaken; other tasks are deferred until c-stream begin.
+ */
+class WorkStealingBatch : public NonOrderingFarm {
+ public:
+  WorkStealingBatch(int par, const pico::fused_stages &stages, bool ordered) {
+    auto pool = std::make_shared<ws_pool>(par);
+    ff::ff_node *c;
+    if (ordered)
+      c = new WSReorderCollector(par);
+    else
+      c = make_fused_collector(par, stages);
+    this->setEmitterF(new Emitter(par, pool));
+    this->setCollectorF(c);
+    std::vector<ff::ff_node *> w;
+    for (int i = 0; i < par; ++i)
+      w.push_back(new Worker(i, pool, stages, ordered));
+    this->add_workers(w);
+    this->cleanup_all();
+  }
+
+ private:
+  class Emitter : public base_emitter {
+   public:
+    Emitter(unsigned nw, std::shared_ptr<ws_pool> pool_)
+        : base_emitter(nw), pool(pool_) {}
+
+    void kernel(pico::base_microbatch *mb) {
+      auto i = pool->push(ws_pool::task{mb, seq[mb->tag()]++});
+      send_mb_to(pool->ticket(), i);
+    }
+
+    void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+      seq.erase(tag);
+    }
+
+   private:
+    std::shared_ptr<ws_pool> pool;
+    std::unordered_map<pico::base_microbatch::tag_t, unsigned long long> seq;
+  };
+
+  class Worker : public base_filter {
+   public:
+    Worker(unsigned id_, std::shared_ptr<ws_pool> pool_,
+           const pico::fused_stages &stages, bool ordered_)
+        : id(id_),
+          pool(pool_),
+          ordered(ordered_),
+          chain(stages, [this](pico::base_microbatch *mb) {
+            if (ordered)
+              out->mbs.push_back(mb);
+            else
+              ff_send_out(mb);
+          }) {}
+
+    /* got a ticket */
+    void kernel(pico::base_microbatch *) { drain(); }
+
+    void cstream_begin_callback(pico::base_microbatch::tag_t tag) {
+      begun.insert(tag);
+      auto it = deferred.find(tag);
+      if (it != deferred.end()) {
+        for (auto &t : it->second) run(t);
+        deferred.erase(it);
+      }
+    }
+
+    void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+      /* no task is pending for the c-stream after draining */
+      drain();
+      if (!ordered) chain.cstream_end(tag);
+      begun.erase(tag);
+    }
+
+   private:
+    unsigned id;
+    std::shared_ptr<ws_pool> pool;
+    bool ordered;
+    ws_result *out = nullptr;
+    pico::fused_chain chain;
+    std::unordered_set<pico::base_microbatch::tag_t> begun;
+    std::unordered_map<pico::base_microbatch::tag_t,
+                       std::vector<ws_pool::task>>
+        deferred;
+
+    void drain() {
+      ws_pool::task t;
+      while (pool->take(id, t)) {
+        if (begun.count(t.mb->tag()))
+          run(t);
+        else
+          deferred[t.mb->tag()].push_back(t);
+      }
+    }
+
+    void run(const ws_pool::task &t) {
+      if (!ordered) {
+        chain.process(t.mb);
+        return;
+      }
+      auto tag = t.mb->tag();
+      out = NEW<ws_result>();
+      out->seq = t.seq;
+      chain.process(t.mb);
+      ff_send_out(NEW<pico::mb_wrapped<ws_result>>(tag, out));
+    }
+  };
+};
+
+static ff::ff_node *make_WorkStealingBatch(int par,
+                                           const pico::fused_stages &stages,
+                                           pico::StructureType st) {
+  /* nothing to steal from */
+  if (par == 1) return make_FusedBatch(par, stages, st);
+  return new WorkStealingBatch(par, stages, st == pico::StructureType::STREAM);
+}
+
+#endif /* INTERNALS_FFOPERATORS_WORKSTEALINGBATCH_HPP_ */
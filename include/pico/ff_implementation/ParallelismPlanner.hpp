@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PICO_FF_IMPLEMENTATION_PARALLELISMPLANNER_HPP_
+#define PICO_FF_IMPLEMENTATION_PARALLELISMPLANNER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/pipeline.hpp>
+
+#include "pico/Operators/Operator.hpp"
+#include "pico/Operators/UnaryOperator.hpp"
+#include "pico/PEGOptimizations.hpp"
+#include "pico/Pipe.hpp"
+
+#include "SupportFFNodes/base_nodes.hpp"
+
+/*
+ * Assigns the parallelism degree of operators, by treating the cores as a
+ * global thread budget (PICO_THREADS, by default the number of cores).
+ * Planning is opt-in (see enabled()): otherwise, operators with no explicit
+ * degree run at def_par() workers each.
+ *
+ * Operators with an explicit degree (constructor argument or PARDEG) keep it,
+ * and it is charged to the budget. The rest of the budget is split among the
+ * other operators in proportion to their cost, with at least one worker each:
+ * - by default, a seed cost given by the operator class (I/O, compute,
+ *   stateful)
+ * - after a calibration run (see Pipe::calibrate), the busy time measured on
+ *   the nodes implementing each operator
+ *
+ * Operators executed by the same workers (i.e., fused, see add_fused) are
+ * planned as a single unit, costing the sum of their costs, that is charged
+ * once. Operators running on a single node anyway (e.g., sequential writers)
+ * are not charged.
+ *
+ * The budget only accounts for workers, not for emitters and collectors.
+ *
+ * Small jobs are planned with a single worker per operator, so that runs of
+ * operators are fused into sequential nodes: the fixed cost of spawning farms
+ * would dominate their running time. Small-job planning is opt-in, by
+ * Pipe::small_job() or PICO_INLINE=1 (PICO_INLINE=0 overrides the former).
+ */
+class ParallelismPlanner {
+ public:
+  ParallelismPlanner(const pico::Pipe &p, pico::StructureType st_,
+                     unsigned budget_ = thread_budget())
+      : budget(budget_), st(st_), small_hint(p.is_small_job()) {
+    collect(p);
+  }
+
+  /* planning is enabled by Pipe::plan(), or for all pipes by PICO_THREADS */
+  static bool enabled(const pico::Pipe &p) {
+    return p.planning() || std::getenv("PICO_THREADS");
+  }
+
+  static unsigned thread_budget() {
+    auto env = std::getenv("PICO_THREADS");
+    return (unsigned)(env ? atoi(env) : (int)ff_realNumCores());
+  }
+
+  /* seed cost of an operator, by operator class */
+  static double seed_cost(pico::Operator *op) {
+    switch (op->operator_class()) {
+      case pico::INPUT:
+      case pico::OUTPUT:
+        return 1; /* I/O-bound */
+      case pico::REDUCE:
+      case pico::FOLDREDUCE:
+        return 2; /* stateful */
+      case pico::MAP:
+      case pico::FMAP:
+      case pico::BMAP:
+      case pico::BFMAP:
+        return 4; /* compute-bound */
+      default:
+        return 1;
+    }
+  }
+
+  /*
+   * Assigns the degree of the operators with no explicit degree.
+   */
+  void plan() {
+    unsigned fixed = 0;
+    std::vector<const unit_t *> autos;
+    for (auto &u : units) {
+      unsigned par = 0;
+      bool seq = true;
+      for (auto op : u) {
+        if (!op->auto_pardeg()) par = std::max(par, op->pardeg());
+        seq = seq && op->sequential();
+      }
+      if (seq)
+        assign(u, 1);
+      else if (par) {
+        /* the unit runs at its highest explicit degree */
+        assign(u, par);
+        fixed += par;
+      } else
+        autos.push_back(&u);
+    }
+    if (autos.empty()) return;
+
+    std::vector<double> w = costs(autos);
+    double total = 0;
+    for (auto c : w) total += c;
+    unsigned avail = budget > fixed ? budget - fixed : 0;
+
+    /* largest-remainder apportionment, at least one worker each */
+    std::vector<unsigned> par(autos.size());
+    std::vector<std::pair<double, size_t>> rem;
+    unsigned given = 0;
+    for (size_t i = 0; i < autos.size(); ++i) {
+      double share = avail * w[i] / total;
+      par[i] = std::max(1u, (unsigned)share);
+      given += par[i];
+      rem.emplace_back(share - std::floor(share), i);
+    }
+    std::stable_sort(rem.begin(), rem.end(),
+                     [](const std::pair<double, size_t> &a,
+                        const std::pair<double, size_t> &b) {
+                       return a.first > b.first;
+                     });
+    for (auto &r : rem) {
+      if (given >= avail) break;
+      ++par[r.second];
+      ++given;
+    }
+
+    for (size_t i = 0; i < autos.size(); ++i) assign(*autos[i], par[i]);
+  }
+
+  /* plans a small job, with a single worker per operator */
+  void plan_small() {
+    budget = 1;
+    small = true;
+    plan();
+  }
+
+  bool small_job() const {
+    auto env = std::getenv("PICO_INLINE");
+    return env ? atoi(env) : small_hint;
+  }
+
+  /*
+   * Prepares the operators for a calibration run: the executor charges the
+   * busy time of the nodes implementing each operator to its counter.
+   */
+  void start_calibration() {
+    for (auto op : ops)
+      op->busy_counter() = std::make_shared<std::atomic<unsigned long long>>(0);
+  }
+
+  /*
+   * Stores the costs measured by a calibration run into the operators.
+   * Operators implemented by the same nodes (e.g., fused) share a counter,
+   * that is split among them by seed cost.
+   */
+  void end_calibration() {
+    std::map<std::atomic<unsigned long long> *, std::vector<pico::Operator *>>
+        groups;
+    for (auto op : ops)
+      if (op->busy_counter()) groups[op->busy_counter().get()].push_back(op);
+    for (auto &g : groups) {
+      double seeds = 0;
+      for (auto op : g.second) seeds += seed_cost(op);
+      double busy = g.first->load() * 1e-9;
+      for (auto op : g.second) op->cost(busy * seed_cost(op) / seeds);
+    }
+    for (auto op : ops) op->busy_counter().reset();
+  }
+
+  void print(std::ostream &os) const {
+    os << "=== Parallelism Plan (budget: " << budget << " threads";
+    os << (small ? ", small job)\n" : ")\n");
+    for (auto op : ops) {
+      std::string name = op->name_short();
+      std::replace(name.begin(), name.end(), '\n', ' ');
+      os << "  " << name << ": " << op->pardeg();
+      if (!op->auto_pardeg())
+        os << " (fixed)";
+      else if (op->sequential())
+        os << " (sequential)";
+      else if (op->cost())
+        os << " (cost " << op->cost() << " s)";
+      os << "\n";
+    }
+  }
+
+ private:
+  typedef std::vector<pico::Operator *> unit_t;
+
+  unsigned budget;
+  pico::StructureType st;
+  bool small_hint, small = false;
+  std::vector<pico::Operator *> ops;
+  std::vector<unit_t> units;  // operators sharing the same workers
+
+  void collect(const pico::Pipe &p) {
+    auto t = p.term_node_type();
+    if (t == pico::Pipe::TO) {
+      /* detect the fused groups, as the executor does */
+      auto &s = p.children();
+      auto it = s.begin();
+      while (it != s.end()) {
+        pico::base_UnaryOperator *source;
+        std::vector<pico::base_UnaryOperator *> run;
+        size_t fused = pico::match_fused(it, s.end(), st, source, run);
+        if (fused) {
+          unit_t u;
+          if (source) u.push_back(source);
+          u.insert(u.end(), run.begin(), run.end());
+          add_unit(u);
+          it += fused;
+        } else
+          collect(**it++);
+      }
+      return;
+    }
+    if (t == pico::Pipe::OPERATOR || t == pico::Pipe::PAIR)
+      add_unit(unit_t{p.get_operator_ptr()});
+    for (auto c : p.children()) collect(*c);
+  }
+
+  void add_unit(const unit_t &u) {
+    ops.insert(ops.end(), u.begin(), u.end());
+    units.push_back(u);
+  }
+
+  /* plans the operators of a unit with no explicit degree */
+  static void assign(const unit_t &u, unsigned par) {
+    for (auto op : u)
+      if (op->auto_pardeg()) op->plan_pardeg(par);
+  }
+
+  /*
+   * The cost of each unit: the sum of the measured costs of its operators if
+   * available, of their seed costs otherwise.
+   * Operators with no measured cost (e.g., not profiled) get their seed cost,
+   * scaled to the measured ones.
+   */
+  std::vector<double> costs(const std::vector<const unit_t *> &autos) {
+    double measured = 0, seeds = 0;
+    for (auto u : autos)
+      for (auto op : *u)
+        if (op->cost()) {
+          measured += op->cost();
+          seeds += seed_cost(op);
+        }
+    double scale = measured ? measured / seeds : 1;
+
+    std::vector<double> res;
+    for (auto u : autos) {
+      double c = 0;
+      for (auto op : *u) c += op->cost() ? op->cost() : seed_cost(op) * scale;
+      res.push_back(c);
+    }
+    return res;
+  }
+};
+
+/*
+ * Charges the busy time of the filters within a node to a counter.
+ */
+static void profile_node(ff::ff_node *n, std::atomic<unsigned long long> *c) {
+  if (auto f = dynamic_cast<sync_handler_filter *>(n)) f->profile(c);
+  if (auto farm = dynamic_cast<ff::ff_farm *>(n)) {
+    if (farm->getEmitter()) profile_node(farm->getEmitter(), c);
+    for (auto w : farm->getWorkers()) profile_node(w, c);
+    if (farm->getCollector()) profile_node(farm->getCollector(), c);
+  } else if (auto pipe = dynamic_cast<ff::ff_pipeline *>(n))
+    for (auto s : pipe->getStages()) profile_node(s, c);
+}
+
+/*
+ * In calibration runs, charges the stages of a pipeline from the given one
+ * on to the operators of the sub-terms they implement.
+ * Compound sub-terms are profiled when their own stages are built.
+ */
+template <typename ItType>
+static void profile_stages(ff::ff_pipeline &p, size_t from, ItType first,
+                           ItType last) {
+  std::vector<pico::Operator *> ops;
+  for (auto it = first; it != last; ++it) {
+    if ((*it)->term_node_type() != pico::Pipe::OPERATOR) return;
+    ops.push_back((*it)->get_operator_ptr());
+  }
+  if (ops.empty() || !ops.front()->busy_counter()) return;
+
+  /* operators sharing the stages share the counter */
+  auto counter = ops.front()->busy_counter();
+  for (auto op : ops) op->busy_counter() = counter;
+  auto &stages = p.getStages();
+  for (size_t i = from; i < stages.size(); ++i)
+    profile_node(stages[i], counter.get());
+}
+
+#endif /* PICO_FF_IMPLEMENTATION_PARALLELISMPLANNER_HPP_ */
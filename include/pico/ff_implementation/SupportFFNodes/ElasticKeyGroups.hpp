@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FF_IMPLEMENTATION_SUPPORTFFNODES_ELASTICKEYGROUPS_HPP_
+#define FF_IMPLEMENTATION_SUPPORTFFNODES_ELASTICKEYGROUPS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <ff/farm.hpp>
+
+#include "pico/Internals/Microbatch.hpp"
+#include "pico/Internals/utils.hpp"
+#include "pico/ff_implementation/defs.hpp"
+#include "pico/ff_implementation/ff_config.hpp"
+
+#include "base_nodes.hpp"
+
+/* number of key groups, i.e., the units of keyed state moved across workers */
+#define KEY_GROUPS 128
+
+/*
+ * elastic farms are resized at most once per period, in milliseconds
+ * (PICO_ELASTIC_PERIOD if set)
+ */
+#define ELASTIC_PERIOD_MS 100
+
+/* scaling thresholds: backlog in micro-batches per worker, utilization */
+#define ELASTIC_GROW_BACKLOG 4
+#define ELASTIC_GROW_UTIL 0.9
+#define ELASTIC_SHRINK_UTIL 0.3
+
+static inline unsigned elastic_period_ms() {
+  auto env = std::getenv("PICO_ELASTIC_PERIOD");
+  return (unsigned)(env ? atoi(env) : ELASTIC_PERIOD_MS);
+}
+
+template <typename K>
+static inline unsigned key_group(const K &k) {
+  return std::hash<K>{}(k) % KEY_GROUPS;
+}
+
+/*
+ * The control token moving a key group: the releasing worker hands the state
+ * of the group off, then the acquiring worker takes it over.
+ * Moves of each group are numbered, so that a worker never takes back the
+ * state it just released.
+ */
+struct keygroup_move : public pico::base_microbatch {
+  keygroup_move(unsigned group_, unsigned long long move_, bool release_)
+      : base_microbatch(nil_tag(), PICO_KEYGROUP_MOVE),
+        group(group_),
+        move(move_),
+        release(release_) {}
+
+  unsigned group;
+  unsigned long long move;
+  bool release;
+};
+
+/* the load of the workers of an elastic farm, as seen by the emitter */
+class elastic_stats {
+ public:
+  elastic_stats(unsigned nw) : workers(new worker_t[nw]) {}
+
+  /* to be called by the workers, for each data micro-batch */
+  void processed(unsigned w, std::chrono::steady_clock::duration busy) {
+    using std::chrono::nanoseconds;
+    workers[w].busy += std::chrono::duration_cast<nanoseconds>(busy).count();
+    workers[w].done.fetch_add(1, std::memory_order_release);
+  }
+
+  unsigned long long done(unsigned w) const {
+    return workers[w].done.load(std::memory_order_acquire);
+  }
+
+  unsigned long long busy_ns(unsigned w) const { return workers[w].busy; }
+
+ private:
+  struct alignas(64) worker_t {
+    std::atomic<unsigned long long> done{0}, busy{0};
+  };
+
+  std::unique_ptr<worker_t[]> workers;
+};
+
+/*
+ * The states of moving key groups, handed off between workers.
+ * The acquiring worker blocks until the state is released, since the
+ * releasing worker may be behind by a long backlog.
+ */
+template <typename State>
+class keygroup_handoff {
+ public:
+  keygroup_handoff() : slots(new slot_t[KEY_GROUPS]) {}
+
+  void release(const keygroup_move &m, State *s) {
+    auto &slot(slots[m.group]);
+    {
+      std::lock_guard<std::mutex> lock(slot.mtx);
+      assert(slot.epoch.load() == 2 * m.move);
+      slot.state = s;
+      slot.epoch.store(2 * m.move + 1, std::memory_order_release);
+    }
+    slot.cv.notify_one();
+  }
+
+  /* waits for the releasing worker to hand the state off */
+  State *acquire(const keygroup_move &m) {
+    auto &slot(slots[m.group]);
+    auto released = [&] {
+      return slot.epoch.load(std::memory_order_acquire) == 2 * m.move + 1;
+    };
+    if (!released()) {
+      std::unique_lock<std::mutex> lock(slot.mtx);
+      slot.cv.wait(lock, released);
+    }
+    auto res = slot.state;
+    slot.epoch.store(2 * m.move + 2, std::memory_order_release);
+    return res;
+  }
+
+ private:
+  struct slot_t {
+    std::atomic<unsigned long long> epoch{0};
+    State *state = nullptr;
+    std::mutex mtx;
+    std::condition_variable cv;
+  };
+
+  std::unique_ptr<slot_t[]> slots;
+};
+
+/*
+ * The emitter of an elastic keyed farm.
+ *
+ * Keys are hashed to key groups, routed to their owner worker. Upon each
+ * period (checked on data and on c-stream boundaries), the number of active
+ * workers is adjusted by the load of the active ones: it grows if they are
+ * backlogged or saturated, it shrinks if they are mostly idle. Resizing moves
+ * the minimum number of key groups: a new worker takes groups from the most
+ * loaded ones, while the groups of a retired worker are spread over the least
+ * loaded ones.
+ *
+ * Moves are sent to the workers in band with data, so that the stream is never
+ * stopped: each group is released after the data routed to its old owner and
+ * acquired before the data routed to the new one.
+ */
+template <typename TokenType>
+class ElasticByKeyEmitter : public base_emitter {
+  typedef typename TokenType::datatype DataType;
+  typedef typename DataType::keytype keytype;
+  typedef pico::Microbatch<TokenType> mb_t;
+
+ public:
+  ElasticByKeyEmitter(unsigned nw_, std::shared_ptr<elastic_stats> stats_)
+      : base_emitter(nw_),
+        nw(nw_),
+        active(nw_),
+        stats(stats_),
+        resize_period(elastic_period_ms()),
+        owner(KEY_GROUPS),
+        moves(KEY_GROUPS, 0),
+        sent(nw_, 0),
+        last_busy(nw_, 0),
+        last_check(std::chrono::steady_clock::now()) {
+    for (unsigned g = 0; g < KEY_GROUPS; ++g) owner[g] = g * nw / KEY_GROUPS;
+  }
+
+  void cstream_begin_callback(pico::base_microbatch::tag_t tag) {
+    rescale();
+    auto &s(tag_state[tag]);
+    for (unsigned dst = 0; dst < nw; ++dst)
+      s.worker_mb[dst] = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+  }
+
+  void kernel(pico::base_microbatch *in_mb) {
+    rescale();
+    auto in_microbatch = reinterpret_cast<mb_t *>(in_mb);
+    auto tag = in_mb->tag();
+    auto &s(tag_state[tag]);
+    for (auto tt : *in_microbatch) {
+      auto dst = owner[key_group(tt.Key())];
+      new (s.worker_mb[dst]->allocate()) DataType(tt);
+      s.worker_mb[dst]->commit();
+      if (s.worker_mb[dst]->full()) send(s, dst);
+    }
+    DELETE(in_microbatch);
+  }
+
+  void cstream_end_callback(pico::base_microbatch::tag_t tag) {
+    rescale();
+    auto &s(tag_state[tag]);
+    for (unsigned i = 0; i < nw; ++i) {
+      if (!s.worker_mb[i]->empty())
+        send_data_to(s.worker_mb[i], i);
+      else
+        DELETE(s.worker_mb[i]);  // spurious microbatch
+    }
+    tag_state.erase(tag);
+  }
+
+  unsigned active_workers() const { return active; }
+
+ private:
+  struct w_state {
+    std::unordered_map<unsigned, mb_t *> worker_mb;
+  };
+
+  unsigned nw, active;
+  std::shared_ptr<elastic_stats> stats;
+  std::chrono::milliseconds resize_period;
+  std::vector<unsigned> owner;
+  std::vector<unsigned long long> moves, sent, last_busy;
+  std::chrono::steady_clock::time_point last_check;
+  std::unordered_map<pico::base_microbatch::tag_t, w_state> tag_state;
+
+  void send_data_to(mb_t *mb, unsigned dst) {
+    send_mb_to(mb, dst);
+    ++sent[dst];
+  }
+
+  void send(w_state &s, unsigned dst) {
+    auto tag = s.worker_mb[dst]->tag();
+    send_data_to(s.worker_mb[dst], dst);
+    s.worker_mb[dst] = NEW<mb_t>(tag, pico::global_params.MICROBATCH_SIZE);
+  }
+
+  void rescale() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - last_check;
+    if (elapsed < resize_period) return;
+    last_check = now;
+
+    using std::chrono::nanoseconds;
+    double period = std::chrono::duration_cast<nanoseconds>(elapsed).count();
+    double backlog = 0, util = 0;
+    for (unsigned w = 0; w < nw; ++w) {
+      auto busy = stats->busy_ns(w);
+      if (w < active) {
+        backlog += sent[w] - stats->done(w);
+        util += (busy - last_busy[w]) / period;
+      }
+      last_busy[w] = busy;
+    }
+    backlog /= active;
+    util /= active;
+
+    if (active < nw &&
+        (backlog > ELASTIC_GROW_BACKLOG || util > ELASTIC_GROW_UTIL))
+      grow();
+    else if (active > 1 && backlog == 0 && util < ELASTIC_SHRINK_UTIL)
+      shrink();
+  }
+
+  /* activates a worker, taking key groups from the most loaded ones */
+  void grow() {
+    auto count = groups_per_worker();
+    unsigned target = KEY_GROUPS / (active + 1);
+    flush();
+    while (count[active] < target) {
+      auto most = std::max_element(count.begin(), count.begin() + active);
+      unsigned from = most - count.begin(), g = KEY_GROUPS - 1;
+      while (owner[g] != from) --g;
+      move(g, active);
+      --*most;
+      ++count[active];
+    }
+    ++active;
+  }
+
+  /* retires the last active worker, spreading its key groups */
+  void shrink() {
+    auto count = groups_per_worker();
+    --active;
+    flush();
+    for (unsigned g = 0; g < KEY_GROUPS; ++g)
+      if (owner[g] == active) {
+        auto least = std::min_element(count.begin(), count.begin() + active);
+        ++*least;
+        move(g, least - count.begin());
+      }
+  }
+
+  std::vector<unsigned> groups_per_worker() const {
+    std::vector<unsigned> res(nw, 0);
+    for (auto w : owner) ++res[w];
+    return res;
+  }
+
+  /* sends out the pending micro-batches, before moving their key groups */
+  void flush() {
+    for (auto &s : tag_state)
+      for (unsigned dst = 0; dst < nw; ++dst)
+        if (!s.second.worker_mb[dst]->empty()) send(s.second, dst);
+  }
+
+  void move(unsigned g, unsigned to) {
+    auto m = moves[g]++;
+    send_mb_to(NEW<keygroup_move>(g, m, true), owner[g]);
+    send_mb_to(NEW<keygroup_move>(g, m, false), to);
+    owner[g] = to;
+  }
+};
+
+#endif /* FF_IMPLEMENTATION_SUPPORTFFNODES_ELASTICKEYGROUPS_HPP_ */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FF_IMPLEMENTATION_SUPPORTFFNODES_FARMWIRING_HPP_
+#define FF_IMPLEMENTATION_SUPPORTFFNODES_FARMWIRING_HPP_
+
+#include <typeinfo>
+#include <vector>
+
+#include <ff/farm.hpp>
+#include <ff/pipeline.hpp>
+
+#include "base_nodes.hpp"
+#include "collectors.hpp"
+#include "emitters.hpp"
+#include "farms.hpp"
+
+/*
+ * Connects two consecutive non-ordering farms worker to worker, by dropping
+ * the collector of the first farm and the emitter of the second one, so that
+ * no serial node sits between them:
+ * - 1:1 if the farms have the same number of workers
+ * - all-to-all otherwise, each upstream worker broadcasting sync tokens to
+ *   the downstream workers, that handle each token once
+ *
+ * Only farms that merely forward micro-batches through the dropped nodes can
+ * be connected (e.g., not keyed or reducing farms).
+ * Returns the connected node, or nullptr if the farms cannot be connected.
+ */
+
+static bool forwarding_output(NonOrderingFarm *f) {
+  auto c = f->getCollector();
+  return c && typeid(*c) == typeid(ForwardingCollector);
+}
+
+static bool forwarding_input(NonOrderingFarm *f) {
+  auto e = f->getEmitter();
+  if (!e || typeid(*e) != typeid(ForwardingEmitter)) return false;
+  for (auto w : f->getWorkers())
+    if (!dynamic_cast<base_filter *>(w) ||
+        dynamic_cast<base_sync_duplicate *>(w))
+      return false;
+  return true;
+}
+
+static ff::ff_node *wire_1to1(NonOrderingFarm *l, NonOrderingFarm *r) {
+  auto &lw = l->getWorkers();
+  auto &rw = r->getWorkers();
+  std::vector<ff::ff_node *> w;
+  for (size_t i = 0; i < lw.size(); ++i) {
+    auto p = new ff::ff_pipeline();
+    p->add_stage(lw[i]);
+    p->add_stage(rw[i]);
+    p->cleanup_nodes();
+    w.push_back(p);
+  }
+
+  auto res = new NonOrderingFarm();
+  res->setEmitterF(l->getEmitter());
+  res->add_workers(w);
+  res->setCollectorF(r->getCollector());
+  if (l->scheduling_ondemand()) res->set_scheduling_ondemand();
+  res->cleanup_all();
+
+  /*
+   * the kept nodes are now owned by the wired farm and its pipelines, so the
+   * farms are deleted with no node, then the dropped nodes
+   */
+  auto dropped_collector = l->getCollector();
+  auto dropped_emitter = r->getEmitter();
+  l->release_nodes();
+  r->release_nodes();
+  delete l;
+  delete r;
+  delete dropped_collector;
+  delete dropped_emitter;
+  return res;
+}
+
+static ff::ff_node *wire_a2a(NonOrderingFarm *l, NonOrderingFarm *r) {
+  for (auto w : r->getWorkers())
+    dynamic_cast<base_filter *>(w)->sync_fanin(l->getWorkers().size());
+
+  /* upstream workers route to downstream ones as the dropped emitter would */
+  auto emitter = reinterpret_cast<ForwardingEmitter *>(r->getEmitter());
+  auto combined_farm = ff::combine_farms<ForwardingEmitter, ForwardingEmitter>(
+      *l, emitter, *r, nullptr, false);
+
+  auto res = new ff::ff_pipeline();
+  res->add_stage(combined_farm);
+  res->cleanup_nodes();
+  return res;
+}
+
+static ff::ff_node *wire_farms(ff::ff_node *left, ff::ff_node *right) {
+  auto l = dynamic_cast<NonOrderingFarm *>(left);
+  auto r = dynamic_cast<NonOrderingFarm *>(right);
+  if (!l || !r || !forwarding_output(l) || !forwarding_input(r))
+    return nullptr;
+  if (l->getWorkers().size() == r->getWorkers().size())
+    return wire_1to1(l, r);
+  return wire_a2a(l, r);
+}
+
+#endif /* FF_IMPLEMENTATION_SUPPORTFFNODES_FARMWIRING_HPP_ */
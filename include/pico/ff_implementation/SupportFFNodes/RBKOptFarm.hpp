@@ -30,6 +30,9 @@
 #include "pico/Internals/utils.hpp"
 
 #include "pico/ff_implementation/SupportFFNodes/PReduceCollector.hpp"
+#include "pico/ff_implementation/SupportFFNodes/collectors.hpp"
+#include "pico/ff_implementation/SupportFFNodes/emitters.hpp"
+#include "pico/ff_implementation/SupportFFNodes/farms.hpp"
 #include "pico/ff_implementation/ff_config.hpp"
 
 /*
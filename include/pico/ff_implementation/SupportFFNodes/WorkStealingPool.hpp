@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FF_IMPLEMENTATION_SUPPORTFFNODES_WORKSTEALINGPOOL_HPP_
+#define FF_IMPLEMENTATION_SUPPORTFFNODES_WORKSTEALINGPOOL_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "pico/Internals/Microbatch.hpp"
+
+/* capacity (in micro-batches) of each work-stealing queue */
+#define WS_QUEUE_CAPACITY 1024
+
+/*
+ * A bounded lock-free queue, with per-cell sequence numbers (Vyukov's).
+ * Safe for any number of producers and consumers; the work-stealing pool has
+ * a single producer (the emitter) and a consumer per worker.
+ */
+template <typename T>
+class ws_queue {
+  struct cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+ public:
+  ws_queue(size_t capacity) : cells(new cell[capacity]), mask(capacity - 1) {
+    assert(capacity && !(capacity & mask));  // power of two
+    for (size_t i = 0; i < capacity; ++i)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  /* returns false if full */
+  bool push(const T &x) {
+    cell *c;
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells[pos & mask];
+      size_t seq = c->seq.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (!dif) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed))
+          break;
+      } else if (dif < 0)
+        return false;
+      else
+        pos = tail.load(std::memory_order_relaxed);
+    }
+    c->data = x;
+    c->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* returns false if empty */
+  bool pop(T &x) {
+    cell *c;
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells[pos & mask];
+      size_t seq = c->seq.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (!dif) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed))
+          break;
+      } else if (dif < 0)
+        return false;
+      else
+        pos = head.load(std::memory_order_relaxed);
+    }
+    x = c->data;
+    c->seq.store(pos + mask + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::unique_ptr<cell[]> cells;
+  size_t mask;
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+/*
+ * The micro-batches pending in a work-stealing farm: a queue per worker, that
+ * the emitter fills round-robin (skipping full queues) and workers drain by
+ * taking from their own queue first, then stealing from the other ones.
+ */
+class ws_pool {
+ public:
+  struct task {
+    pico::base_microbatch *mb;
+    unsigned long long seq;  // for reordering
+  };
+
+  ws_pool(unsigned nw_) : nw(nw_), ticket_(pico::base_microbatch::nil_tag()) {
+    for (unsigned i = 0; i < nw; ++i)
+      queues.emplace_back(new ws_queue<task>(WS_QUEUE_CAPACITY));
+  }
+
+  /*
+   * Called by the emitter only.
+   * Returns the worker whose queue got the task.
+   */
+  unsigned push(const task &t) {
+    for (;;) {
+      for (unsigned k = 0; k < nw; ++k) {
+        unsigned i = next;
+        next = (next + 1) % nw;
+        if (queues[i]->push(t)) return i;
+      }
+      /* all queues are full, wait for the workers */
+      std::this_thread::yield();
+    }
+  }
+
+  /* takes a task from the queue of worker i, or steals one */
+  bool take(unsigned i, task &t) {
+    for (unsigned k = 0; k < nw; ++k)
+      if (queues[(i + k) % nw]->pop(t)) return true;
+    return false;
+  }
+
+  /*
+   * The token waking a worker up upon pushing a task: it carries no data and
+   * is never deleted.
+   */
+  pico::base_microbatch *ticket() { return &ticket_; }
+
+ private:
+  unsigned nw, next = 0;
+  std::vector<std::unique_ptr<ws_queue<task>>> queues;
+  pico::base_microbatch ticket_;
+};
+
+#endif /* FF_IMPLEMENTATION_SUPPORTFFNODES_WORKSTEALINGPOOL_HPP_ */
@@ -21,9 +21,10 @@
 #ifndef PICO_FF_IMPLEMENTATION_BASE_NODES_HPP_
 #define PICO_FF_IMPLEMENTATION_BASE_NODES_HPP_
 
-#ifdef TRACE_PICO
+#include <atomic>
 #include <chrono>
-#endif
+#include <unordered_map>
+#include <vector>
 
 #include <ff/multinode.hpp>
 #include <ff/node.hpp>
@@ -31,6 +32,7 @@
 #include "pico/Internals/Microbatch.hpp"
 #include "pico/Internals/utils.hpp"
 
+#include "pico/ff_implementation/NumaTopology.hpp"
 #include "pico/ff_implementation/defs.hpp"
 
 #include "farms.hpp"
@@ -78,6 +80,27 @@ class sync_handler_filter : public sync_handler {
  public:
   virtual ~sync_handler_filter() {}
 
+  /*
+   * Sets the number of upstream nodes the filter receives sync tokens from
+   * (e.g., the workers of a farm connected all-to-all with this one).
+   * Each token is handled once: upon the first begin and the last end.
+   */
+  void sync_fanin(unsigned n) { fanin = n; }
+
+  /*
+   * Charges the time spent in processing tokens to a counter (in ns), that is
+   * updated at the end of each run (e.g., for calibrating the parallelism).
+   */
+  void profile(std::atomic<unsigned long long> *counter) {
+    busy_counter = counter;
+  }
+
+  /*
+   * Restricts the node to a set of CPUs (e.g., a NUMA node) at the beginning
+   * of each run, so that the memory it first touches is local to them.
+   */
+  void place(const std::vector<int> *cpus) { placement = cpus; }
+
  protected:
   virtual void begin_callback() {}
 
@@ -110,6 +133,9 @@ class sync_handler_filter : public sync_handler {
 #ifdef TRACE_PICO
     auto t0 = std::chrono::high_resolution_clock::now();
 #endif
+    std::chrono::steady_clock::time_point p0;
+    if (busy_counter) p0 = std::chrono::steady_clock::now();
+    bool end = false;
     if (!is_sync(in->payload())) {
 #ifdef TRACE_PICO
       tag_cnt[in->tag()].rcvd_data++;
@@ -119,9 +145,20 @@ class sync_handler_filter : public sync_handler {
 #ifdef TRACE_PICO
       tag_cnt[in->tag()].rcvd_sync++;
 #endif
+      end = (in->payload() == PICO_END);
+      if (placement && in->payload() == PICO_BEGIN) pin_thread(*placement);
       handle_sync(in);
       DELETE(in);
     }
+    if (busy_counter) {
+      busy += std::chrono::steady_clock::now() - p0;
+      if (end) {
+        using std::chrono::nanoseconds;
+        busy_counter->fetch_add(
+            std::chrono::duration_cast<nanoseconds>(busy).count());
+        busy = busy.zero();
+      }
+    }
 #ifdef TRACE_PICO
     auto t1 = std::chrono::high_resolution_clock::now();
     svcd += (t1 - t0);
@@ -129,9 +166,17 @@ class sync_handler_filter : public sync_handler {
   }
 
  private:
+  std::atomic<unsigned long long> *busy_counter = nullptr;
+  const std::vector<int> *placement = nullptr;
+  std::chrono::steady_clock::duration busy{0};
+  unsigned fanin = 1, begins = 0, ends = 0;
+  std::unordered_map<pico::base_microbatch::tag_t, unsigned> cstream_begins;
+  std::unordered_map<pico::base_microbatch::tag_t, unsigned> cstream_ends;
+
   virtual void handle_begin(pico::base_microbatch::tag_t tag) {
     // fprintf(stderr, "> %p begin tag=%llu\n", this, tag);
     assert(tag == pico::base_microbatch::nil_tag());
+    if (fanin > 1 && begins++) return;
     send_mb(make_sync(tag, PICO_BEGIN));
     begin_callback();
   }
@@ -139,18 +184,30 @@ class sync_handler_filter : public sync_handler {
   virtual void handle_end(pico::base_microbatch::tag_t tag) {
     // fprintf(stderr, "> %p end tag=%llu\n", this, tag);
     assert(tag == pico::base_microbatch::nil_tag());
+    if (fanin > 1) {
+      assert(ends < begins);
+      if (++ends < fanin) return;
+      begins = ends = 0;
+    }
     end_callback();
     send_mb(make_sync(tag, PICO_END));
   }
 
   virtual void handle_cstream_begin(pico::base_microbatch::tag_t tag) {
     // fprintf(stderr, "> %p c-begin tag=%llu\n", this, tag);
+    if (fanin > 1 && cstream_begins[tag]++) return;
     if (propagate_cstream_sync()) begin_cstream(tag);
     cstream_begin_callback(tag);
   }
 
   virtual void handle_cstream_end(pico::base_microbatch::tag_t tag) {
     // fprintf(stderr, "> %p c-end tag=%llu\n", this, tag);
+    if (fanin > 1) {
+      assert(cstream_ends[tag] < cstream_begins[tag]);
+      if (++cstream_ends[tag] < fanin) return;
+      cstream_begins.erase(tag);
+      cstream_ends.erase(tag);
+    }
     cstream_end_callback(tag);
     if (propagate_cstream_sync()) end_cstream(tag);
   }
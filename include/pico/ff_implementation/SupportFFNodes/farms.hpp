@@ -31,6 +31,27 @@ class NonOrderingFarm : public ff::ff_farm {
   using lb_t = ff::ff_farm::lb_t;
   void setEmitterF(ff::ff_node* f) { this->add_emitter(f); }
   void setCollectorF(ff::ff_node* f) { this->add_collector(f); }
+
+  /* records the scheduling policy, so that rewired farms can keep it */
+  void set_scheduling_ondemand() {
+    ff::ff_farm::set_scheduling_ondemand();
+    ondemand = true;
+  }
+
+  bool scheduling_ondemand() const { return ondemand; }
+
+  /*
+   * Gives up the ownership of the emitter, the workers and the collector:
+   * they are not deleted along with the farm.
+   */
+  void release_nodes() {
+    cleanup_emitter(false);
+    cleanup_workers(false);
+    cleanup_collector(false);
+  }
+
+ private:
+  bool ondemand = false;
 };
 
 /*
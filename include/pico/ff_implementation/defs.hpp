@@ -35,6 +35,9 @@ static char *PICO_CSTREAM_END = (char *)(PICO_EOS - 0xe);
 static char *PICO_CSTREAM_FROM_LEFT = (char *)(PICO_EOS - 0xf);
 static char *PICO_CSTREAM_FROM_RIGHT = (char *)(PICO_EOS - 0x10);
 
+/* moves a key group between the workers of an elastic farm */
+static char *PICO_KEYGROUP_MOVE = (char *)(PICO_EOS - 0x11);
+
 static inline bool is_sync(char *token) {
   return token <= PICO_BEGIN && token >= PICO_CSTREAM_END;
 }
@@ -27,18 +27,29 @@
 
 /* basic */
 #include "pico/FlatMapCollector.hpp"
+#include "pico/FormatBuffer.hpp"
 #include "pico/KeyValue.hpp"
+#include "pico/Param.hpp"
 #include "pico/Pipe.hpp"
 #include "pico/SemanticGraph.hpp"
+#include "pico/Session.hpp"
 #include "pico/WindowPolicy.hpp"
 
 /* operators */
 #include "pico/Operators/FlatMap.hpp"
 #include "pico/Operators/FoldReduce.hpp"
+#include "pico/Operators/InOut/ReadBinary.hpp"
+#include "pico/Operators/InOut/ReadCSV.hpp"
 #include "pico/Operators/InOut/ReadFromFile.hpp"
+#include "pico/Operators/InOut/ReadFromLog.hpp"
 #include "pico/Operators/InOut/ReadFromSocket.hpp"
+#include "pico/Operators/InOut/ReadFromSockets.hpp"
 #include "pico/Operators/InOut/ReadFromStdIn.hpp"
+#include "pico/Operators/InOut/ReadJsonLines.hpp"
+#include "pico/Operators/InOut/WriteBinary.hpp"
 #include "pico/Operators/InOut/WriteToDisk.hpp"
+#include "pico/Operators/InOut/WriteToLog.hpp"
+#include "pico/Operators/InOut/WriteToSocket.hpp"
 #include "pico/Operators/InOut/WriteToStdOut.hpp"
 #include "pico/Operators/JoinFlatMapByKey.hpp"
 #include "pico/Operators/Map.hpp"
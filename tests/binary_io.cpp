@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/basic_pipes.hpp"
+#include "common/io.hpp"
+
+typedef pico::KeyValue<char, int> KV;
+
+/* text pairs -> binary file -> text pairs */
+static std::vector<std::string> binary_round_trip(
+    std::string input_file, pico::ReadBinary<KV> bin_reader) {
+  std::string bin_file = "pairs.bin";
+  std::string output_file = "output.txt";
+
+  /* small blocks, to exercise splitting among workers */
+  auto to_binary = pipe_pairs_creator<KV>(input_file).add(
+      pico::WriteBinary<KV>(bin_file).block_size(1 << 10));
+  to_binary.run();
+
+  auto from_binary =
+      pico::Pipe().add(bin_reader).add(pico::WriteToDisk<KV>(output_file));
+  from_binary.run();
+
+  auto output_lines = read_lines(output_file);
+  std::sort(output_lines.begin(), output_lines.end());
+  return output_lines;
+}
+
+TEST_CASE("write and read binary", "write and read binary tag") {
+  std::string input_file = "./testdata/pairs.txt";
+
+  pico::ReadBinary<KV> reader("pairs.bin");
+  auto observed = binary_round_trip(input_file, reader);
+
+  auto expected = read_lines(input_file);
+  std::sort(expected.begin(), expected.end());
+
+  REQUIRE(expected == observed);
+}
+
+TEST_CASE("read binary key range", "read binary key range tag") {
+  std::string input_file = "./testdata/pairs.txt";
+
+  auto reader = pico::ReadBinary<KV>("pairs.bin").key_range('b', 'd');
+  auto observed = binary_round_trip(input_file, reader);
+
+  std::vector<std::string> expected;
+  for (auto &line : read_lines(input_file)) {
+    auto k = KV::from_string(line).Key();
+    if (k >= 'b' && k <= 'd') expected.push_back(line);
+  }
+  std::sort(expected.begin(), expected.end());
+
+  REQUIRE(expected == observed);
+}
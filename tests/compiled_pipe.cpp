@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+typedef pico::KeyValue<char, int> KV;
+
+TEST_CASE("compiled pipe", "compiled pipe tag") {
+  std::string output_file = "output.txt";
+
+  pico::Param<std::string> input_file;
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToDisk<std::string> writer(output_file);
+
+  auto p = pico::Pipe()
+               .add(reader)
+               .add(pico::Map<std::string, std::string>(
+                   [](std::string& s) { return s; }))
+               .add(writer);
+
+  /* run the same executor on different inputs */
+  pico::CompiledPipe compiled(p);
+  for (auto in : {"./testdata/lines.txt", "./testdata/pairs.txt",
+                  "./testdata/lines.txt"}) {
+    input_file.bind(in);
+    compiled.run();
+
+    auto expected = read_lines(in);
+    auto observed = read_lines(output_file);
+    std::sort(expected.begin(), expected.end());
+    std::sort(observed.begin(), observed.end());
+
+    REQUIRE(expected == observed);
+  }
+}
+
+TEST_CASE("compiled pipe plain input", "compiled pipe tag") {
+  std::string input_file = "./testdata/pairs.txt";
+  std::string bin_file = "pairs.bin";
+  std::string output_file = "output.txt";
+
+  /* a plain (non-parametric) input and a binary output */
+  auto p = pico::Pipe()
+               .add(pico::ReadFromFile(input_file))
+               .add(pico::Map<std::string, KV>(
+                   [](std::string line) { return KV::from_string(line); }))
+               .add(pico::WriteBinary<KV>(bin_file));
+  auto from_binary = pico::Pipe()
+                         .add(pico::ReadBinary<KV>(bin_file))
+                         .add(pico::WriteToDisk<KV>(output_file));
+
+  auto expected = read_lines(input_file);
+  std::sort(expected.begin(), expected.end());
+
+  /* each run reads the whole input again, and rewrites the output */
+  pico::CompiledPipe compiled(p);
+  for (unsigned run = 0; run < 3; ++run) {
+    compiled.run();
+    from_binary.run();
+
+    auto observed = read_lines(output_file);
+    std::sort(observed.begin(), observed.end());
+
+    REQUIRE(expected == observed);
+  }
+}
@@ -18,8 +18,10 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include <catch.hpp>
 
@@ -69,3 +71,70 @@ TEST_CASE("flatmap", "flatmap tag") {
 
   REQUIRE(duplicated_lines == output_lines);
 }
+
+TEST_CASE("flatmap work stealing", "flatmap tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToDisk<std::string> writer(output_file);
+
+  /* duplicate, then concatenate each line with itself */
+  auto io_file_pipe =
+      pico::Pipe()
+          .add(reader)
+          .add(pico::FlatMap<std::string, std::string>(duplicate)
+                   .work_stealing())
+          .add(pico::Map<std::string, std::string>(
+                   [](std::string& s) { return s + s; })
+                   .work_stealing())
+          .add(writer);
+
+  io_file_pipe.run();
+
+  std::vector<std::string> expected;
+  for (auto& line : read_lines(input_file)) {
+    expected.push_back(line + line);
+    expected.push_back(line + line);
+  }
+  auto output_lines = read_lines(output_file);
+
+  std::sort(expected.begin(), expected.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(expected == output_lines);
+}
+
+TEST_CASE("flatmap work stealing ordered stream", "flatmap tag") {
+  auto input = read_lines("./testdata/lines.txt");
+
+  /* irregular cost per line, so that idle workers steal */
+  auto slow_twice = [](std::string& s) {
+    if (s.size() % 4 == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    return s + s;
+  };
+  auto p = pico::Pipe()
+               .add(pico::FlatMap<std::string, std::string>(duplicate, 4)
+                        .work_stealing())
+               .add(pico::Map<std::string, std::string>(slow_twice, 4)
+                        .work_stealing());
+
+  std::vector<std::string> expected, observed;
+  for (auto& line : input) {
+    expected.push_back(line + line);
+    expected.push_back(line + line);
+  }
+
+  pico::Session<std::string> session(p, pico::StructureType::STREAM);
+  std::thread producer([&]() {
+    for (auto& s : input) session.push(s);
+    session.close();
+  });
+  std::string s;
+  while (session.pull(s)) observed.push_back(s);
+  producer.join();
+
+  /* stolen micro-batches are reordered before leaving the farm */
+  REQUIRE(expected == observed);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+/* follows a file to stdout, until idle */
+static void follow_to_stdout(std::string fname, std::string checkpoint,
+                             std::string output_file) {
+  auto coutbuf = std::cout.rdbuf();
+  std::ofstream out(output_file);
+  std::cout.rdbuf(out.rdbuf());
+
+  auto follow_pipe = pico::Pipe()
+                         .add(pico::ReadFromFile(fname).follow(500).checkpoint(
+                             checkpoint))
+                         .add(pico::WriteToStdOut<std::string>());
+  follow_pipe.run();
+
+  std::cout.rdbuf(coutbuf);
+  out.close();
+}
+
+TEST_CASE("follow file", "follow file tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string followed_file = "followed.txt";
+  std::string checkpoint = "followed.ckpt";
+  std::string output_file = "output.txt";
+  remove(followed_file.c_str());
+  remove(checkpoint.c_str());
+
+  /* append the input lines in bursts, rotating the file halfway */
+  auto input_lines = read_lines(input_file);
+  std::thread appender([&]() {
+    std::ofstream out(followed_file);
+    for (size_t i = 0; i < input_lines.size(); ++i) {
+      out << input_lines[i] << "\n";
+      if (i % 100 == 99) {
+        out.flush();
+        usleep(10000);
+      }
+      if (i == input_lines.size() / 2) {
+        out.close();
+        rename(followed_file.c_str(), (followed_file + ".1").c_str());
+        out.open(followed_file);
+      }
+    }
+  });
+
+  follow_to_stdout(followed_file, checkpoint, output_file);
+  appender.join();
+
+  REQUIRE(input_lines == read_lines(output_file));
+
+  /* resume from the checkpoint: only new lines are read */
+  std::ofstream(followed_file, std::ios::app) << "appended\n";
+  follow_to_stdout(followed_file, checkpoint, output_file);
+
+  REQUIRE(read_lines(output_file) == std::vector<std::string>{"appended"});
+}
+
+TEST_CASE("follow file filtered", "follow file tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+  std::string needle = "a";
+
+  auto coutbuf = std::cout.rdbuf();
+  std::ofstream out(output_file);
+  std::cout.rdbuf(out.rdbuf());
+
+  /* the filter is applied by the following reader */
+  auto reader = pico::ReadFromFile(input_file).follow(200);
+  pico::Pipe()
+      .add(reader.where_contains(needle))
+      .add(pico::WriteToStdOut<std::string>())
+      .run();
+
+  std::cout.rdbuf(coutbuf);
+  out.close();
+
+  std::vector<std::string> expected;
+  for (auto &line : read_lines(input_file))
+    if (line.find(needle) != std::string::npos) expected.push_back(line);
+
+  REQUIRE(expected == read_lines(output_file));
+}
@@ -18,7 +18,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <functional>
 #include <iostream>
+#include <regex>
 #include <string>
 
 #include <catch.hpp>
@@ -50,3 +52,244 @@ TEST_CASE("read and write", "read and write tag") {
 
   REQUIRE(input_lines == output_lines);
 }
+
+TEST_CASE("read and write merged", "read and write merged tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+
+  /* write by parallel shards, merged into a single file */
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToDisk<std::string> writer(output_file);
+
+  auto io_file_pipe = pico::Pipe().add(reader).add(writer.merged(4));
+
+  io_file_pipe.run();
+
+  /* forget the order and compare */
+  auto input_lines = read_lines(input_file);
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+
+TEST_CASE("read and write sharded", "read and write sharded tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+  constexpr unsigned shards = 4;
+
+  /* write one file per parallel writer */
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToDisk<std::string> writer(output_file);
+
+  auto io_file_pipe = pico::Pipe().add(reader).add(writer.sharded(shards));
+
+  io_file_pipe.run();
+
+  /* forget the order and compare */
+  auto input_lines = read_lines(input_file);
+  std::vector<std::string> output_lines;
+  for (unsigned i = 0; i < shards; ++i) {
+    auto shard_lines = read_lines(output_file + "." + std::to_string(i));
+    output_lines.insert(output_lines.end(), shard_lines.begin(),
+                        shard_lines.end());
+  }
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+
+TEST_CASE("read and write wired", "read and write wired tag") {
+  /*
+   * readers wired to merged writers worker to worker, with no collector nor
+   * emitter in between (the farms are rebuilt while wiring)
+   */
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+  unsigned readers = 0;
+
+  SECTION("1:1") { readers = 4; }
+  SECTION("all-to-all") { readers = 2; }
+
+  pico::ReadFromFile reader(input_file, readers);
+  pico::WriteToDisk<std::string> writer(output_file);
+
+  auto io_file_pipe = pico::Pipe().add(reader).add(writer.merged(4));
+
+  io_file_pipe.run();
+
+  /* forget the order and compare */
+  auto input_lines = read_lines(input_file);
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+
+TEST_CASE("read and write formatted", "read and write formatted tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+
+  /* format each line directly into the output buffer */
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToDisk<std::string> writer(
+      output_file, [](std::string& line, pico::FormatBuffer& out) {
+        out << line.size() << ' ' << line;
+      });
+
+  auto io_file_pipe = pico::Pipe().add(reader).add(writer);
+
+  io_file_pipe.run();
+
+  auto input_lines = read_lines(input_file);
+  for (auto& line : input_lines)
+    line = std::to_string(line.size()) + " " + line;
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+
+TEST_CASE("read multiple files", "read multiple files tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+  constexpr unsigned shards = 4;
+
+  /* split the input into shards */
+  auto split_pipe =
+      pico::Pipe()
+          .add(pico::ReadFromFile(input_file))
+          .add(pico::WriteToDisk<std::string>(output_file).sharded(shards));
+  split_pipe.run();
+
+  auto input_lines = read_lines(input_file);
+  std::sort(input_lines.begin(), input_lines.end());
+
+  /* read the shards back, both as a list and as a glob pattern */
+  std::vector<std::string> shard_files;
+  for (unsigned i = 0; i < shards; ++i)
+    shard_files.push_back(output_file + "." + std::to_string(i));
+  for (auto reader : {pico::ReadFromFile(shard_files),
+                      pico::ReadFromFile(output_file + ".?")}) {
+    auto merge_pipe = pico::Pipe().add(reader).add(
+        pico::WriteToDisk<std::string>(output_file));
+    merge_pipe.run();
+
+    auto output_lines = read_lines(output_file);
+    std::sort(output_lines.begin(), output_lines.end());
+    REQUIRE(input_lines == output_lines);
+  }
+}
+
+TEST_CASE("read filtered", "read filtered tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+
+  auto filtered_lines = [&](std::function<bool(const std::string&)> p) {
+    std::vector<std::string> res;
+    for (auto& line : read_lines(input_file))
+      if (p(line)) res.push_back(line);
+    std::sort(res.begin(), res.end());
+    return res;
+  };
+
+  SECTION("where contains") {
+    auto io_file_pipe =
+        pico::Pipe()
+            .add(pico::ReadFromFile(input_file).where_contains("ab"))
+            .add(pico::WriteToDisk<std::string>(output_file));
+    io_file_pipe.run();
+
+    auto output_lines = read_lines(output_file);
+    std::sort(output_lines.begin(), output_lines.end());
+    REQUIRE(output_lines == filtered_lines([](const std::string& line) {
+              return line.find("ab") != std::string::npos;
+            }));
+  }
+
+  SECTION("where matches") {
+    auto io_file_pipe =
+        pico::Pipe()
+            .add(pico::ReadFromFile(input_file).where_matches("^a.* b"))
+            .add(pico::WriteToDisk<std::string>(output_file));
+    io_file_pipe.run();
+
+    auto output_lines = read_lines(output_file);
+    std::sort(output_lines.begin(), output_lines.end());
+    REQUIRE(output_lines == filtered_lines([](const std::string& line) {
+              return std::regex_search(line, std::regex("^a.* b"));
+            }));
+  }
+}
+
+#ifdef PICO_HAVE_ZLIB
+TEST_CASE("read and write gzip", "read and write gzip tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string compressed_file = "output.txt.gz";
+  std::string output_file = "output.txt";
+
+  /* compress by parallel writers, into a multi-block file */
+  auto compress_pipe = pico::Pipe()
+                           .add(pico::ReadFromFile(input_file))
+                           .add(pico::WriteToDisk<std::string>(compressed_file)
+                                    .merged());
+  compress_pipe.run();
+
+  /* decompress by parallel readers */
+  auto decompress_pipe = pico::Pipe()
+                             .add(pico::ReadFromFile(compressed_file))
+                             .add(pico::WriteToDisk<std::string>(output_file));
+  decompress_pipe.run();
+
+  auto input_lines = read_lines(input_file);
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+#endif
+
+#ifdef PICO_HAVE_ZSTD
+TEST_CASE("read and write zstd", "read and write zstd tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string large_file = "large.txt";
+  std::string compressed_file = "output.txt.zst";
+  std::string output_file = "output.txt";
+
+  /* an input spanning several frames, each larger than the read buffer */
+  auto lines = read_lines(input_file);
+  std::vector<std::string> input_lines;
+  {
+    std::ofstream large(large_file);
+    while (input_lines.size() < 100000)
+      for (auto& line : lines) {
+        auto copy = std::to_string(input_lines.size()) + " " + line;
+        large << copy << "\n";
+        input_lines.push_back(copy);
+      }
+  }
+
+  /* compress by parallel writers, into a multi-frame file */
+  pico::Pipe()
+      .add(pico::ReadFromFile(large_file))
+      .add(pico::WriteToDisk<std::string>(compressed_file).merged())
+      .run();
+
+  /* decompress by parallel readers */
+  pico::Pipe()
+      .add(pico::ReadFromFile(compressed_file))
+      .add(pico::WriteToDisk<std::string>(output_file))
+      .run();
+
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+/* a node of a fake sysfs tree under root, with the given cpulist */
+static void fake_node(std::string root, unsigned n, std::string cpulist) {
+  auto dir = root + "/sys/devices/system/node/node" + std::to_string(n);
+  system(("mkdir -p " + dir).c_str());
+  std::ofstream(dir + "/cpulist") << cpulist << "\n";
+}
+
+struct dummy_node : ff::ff_node {
+  void *svc(void *t) { return t; }
+};
+
+TEST_CASE("numa placement", "numa placement tag") {
+  std::string root = "numa_root";
+  system(("rm -rf " + root).c_str());
+
+  /* a source, a farm (emitter, 4 workers and collector) and a sink */
+  dummy_node source, emitter, collector, sink, workers[4];
+  std::vector<ff::ff_node *> w;
+  for (auto &n : workers) w.push_back(&n);
+  ff::ff_farm farm;
+  farm.add_emitter(&emitter);
+  farm.add_workers(w);
+  farm.add_collector(&collector);
+  ff::ff_pipeline p;
+  p.add_stage(&source);
+  p.add_stage(&farm);
+  p.add_stage(&sink);
+
+  SECTION("two nodes") {
+    fake_node(root, 0, "0-1");
+    fake_node(root, 1, "2-3,8-9");
+    numa_topology topology(root);
+
+    REQUIRE(topology.nodes() == 2);
+    REQUIRE(topology.cpus(0) == std::vector<int>{0, 1});
+    REQUIRE(topology.cpus(1) == std::vector<int>{2, 3, 8, 9});
+    REQUIRE(topology.ncpus() == 6);
+
+    /*
+     * 8 threads, in contiguous blocks sized by the share of CPUs of each
+     * node: ceil(8 * 2 / 6) = 3 threads, then the rest
+     */
+    NumaPlacement placement(&p, topology);
+    REQUIRE(placement.assignment() ==
+            std::vector<unsigned>{0, 0, 0, 1, 1, 1, 1, 1});
+  }
+
+  SECTION("no numa information") {
+    /* a single node with all the cores, and no placement */
+    numa_topology topology(root);
+    REQUIRE(topology.nodes() == 1);
+    REQUIRE(topology.ncpus() == (unsigned)ff_realNumCores());
+
+    NumaPlacement placement(&p, topology);
+    REQUIRE(placement.assignment().empty());
+  }
+
+  system(("rm -rf " + root).c_str());
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+typedef pico::KeyValue<char, int> KV;
+
+static auto duplicate = [](std::string& in,
+                           pico::FlatMapCollector<std::string>& collector) {
+  collector.add(in);
+  collector.add(in);
+};
+
+/* the operators of a pipe, in term order */
+static void operators(const pico::Pipe& p, std::vector<pico::Operator*>& res) {
+  if (p.term_node_type() == pico::Pipe::OPERATOR)
+    res.push_back(p.get_operator_ptr());
+  for (auto c : p.children()) operators(*c, res);
+}
+
+TEST_CASE("parallelism plan", "parallelism plan tag") {
+  pico::ReadFromFile reader("./testdata/pairs.txt");
+  pico::WriteToDisk<KV> writer("output.txt",
+                               [](KV in) { return in.to_string(); });
+
+  auto p = pico::Pipe()
+               .add(reader)
+               .add(pico::Map<std::string, KV>(
+                   [](std::string line) { return KV::from_string(line); }))
+               .add(pico::ReduceByKey<KV>(
+                   [](int v1, int v2) { return v1 + v2; }))
+               .add(writer);
+
+  std::vector<pico::Operator*> ops;
+  operators(p, ops);
+  REQUIRE(ops.size() == 4);
+
+  ParallelismPlanner planner(p, p.structure_type(), 16);
+  planner.plan();
+
+  /*
+   * The map is fused into the reader, and the pair is charged once; the
+   * sequential writer is not charged.
+   */
+  REQUIRE(ops[0]->pardeg() == ops[1]->pardeg());
+  REQUIRE(ops[3]->pardeg() == 1);
+  REQUIRE(ops[1]->pardeg() + ops[2]->pardeg() == 16);
+
+  /* the compute-bound group gets more workers */
+  REQUIRE(ops[1]->pardeg() > ops[2]->pardeg());
+}
+
+TEST_CASE("parallelism plan opt-in", "parallelism plan tag") {
+  pico::ReadFromFile reader("./testdata/lines.txt");
+  pico::WriteToDisk<std::string> writer("output.txt");
+
+  auto p = pico::Pipe()
+               .add(reader)
+               .add(pico::FlatMap<std::string, std::string>(duplicate))
+               .add(writer);
+
+  std::vector<pico::Operator*> ops;
+  operators(p, ops);
+
+  /* with no planning, operators run at the default degree */
+  REQUIRE(!p.planning());
+  for (auto op : ops) REQUIRE(op->pardeg() == pico::def_par());
+  if (!std::getenv("PICO_THREADS"))
+    REQUIRE(!ParallelismPlanner::enabled(p));
+
+  p.plan();
+  REQUIRE(ParallelismPlanner::enabled(p));
+
+  /* copies of the pipe are planned as well */
+  auto q = pico::Pipe(p);
+  REQUIRE(ParallelismPlanner::enabled(q));
+}
+
+TEST_CASE("parallelism plan fused group", "parallelism plan tag") {
+  pico::ReadFromFile reader("./testdata/lines.txt");
+  pico::WriteToDisk<std::string> writer("output.txt");
+
+  auto map = pico::Map<std::string, std::string>(
+      [](std::string& s) { return s + s; });
+
+  SECTION("automatic degrees") {
+    auto p = pico::Pipe()
+                 .add(reader)
+                 .add(map)
+                 .add(pico::FlatMap<std::string, std::string>(duplicate))
+                 .add(writer);
+    std::vector<pico::Operator*> ops;
+    operators(p, ops);
+
+    ParallelismPlanner planner(p, p.structure_type(), 8);
+    planner.plan();
+
+    /* the whole budget goes to the workers of the group */
+    REQUIRE(ops[0]->pardeg() == 8);
+    REQUIRE(ops[1]->pardeg() == 8);
+    REQUIRE(ops[2]->pardeg() == 8);
+    REQUIRE(ops[3]->pardeg() == 1);
+  }
+
+  SECTION("explicit degree") {
+    auto p = pico::Pipe()
+                 .add(reader)
+                 .add(map)
+                 .add(pico::FlatMap<std::string, std::string>(duplicate, 2))
+                 .add(writer);
+    std::vector<pico::Operator*> ops;
+    operators(p, ops);
+
+    ParallelismPlanner planner(p, p.structure_type(), 8);
+    planner.plan();
+
+    /* the group runs at the explicit degree of its member */
+    REQUIRE(ops[0]->pardeg() == 2);
+    REQUIRE(ops[1]->pardeg() == 2);
+    REQUIRE(ops[2]->pardeg() == 2);
+    REQUIRE(ops[3]->pardeg() == 1);
+  }
+}
+
+TEST_CASE("parallelism plan small job", "parallelism plan tag") {
+  pico::ReadFromFile reader("./testdata/lines.txt");
+  pico::WriteToDisk<std::string> writer("output.txt");
+
+  auto p = pico::Pipe()
+               .add(reader)
+               .add(pico::Map<std::string, std::string>(
+                   [](std::string& s) { return s + s; }))
+               .add(pico::FlatMap<std::string, std::string>(duplicate, 2))
+               .add(writer);
+
+  std::vector<pico::Operator*> ops;
+  operators(p, ops);
+
+  /* a group with no explicit degree, and a reduce */
+  auto q = pico::Pipe()
+               .add(pico::ReadFromFile("./testdata/pairs.txt"))
+               .add(pico::Map<std::string, KV>(
+                   [](std::string line) { return KV::from_string(line); }))
+               .add(pico::ReduceByKey<KV>(
+                   [](int v1, int v2) { return v1 + v2; }))
+               .add(pico::WriteToDisk<KV>(
+                   "output.txt", [](KV in) { return in.to_string(); }));
+
+  std::vector<pico::Operator*> reduce_ops;
+  operators(q, reduce_ops);
+
+  /* small-job planning is opt-in, whatever the size of the inputs */
+  if (!std::getenv("PICO_INLINE")) {
+    REQUIRE(!ParallelismPlanner(p, p.structure_type(), 16).small_job());
+    REQUIRE(!ParallelismPlanner(q, q.structure_type(), 16).small_job());
+  }
+
+  p.small_job();
+  q.small_job();
+  ParallelismPlanner planner(p, p.structure_type(), 16);
+  REQUIRE(planner.small_job());
+  planner.plan_small();
+  ParallelismPlanner reduce_planner(q, q.structure_type(), 16);
+  REQUIRE(reduce_planner.small_job());
+  reduce_planner.plan_small();
+
+  /* a single worker per group, unless explicit */
+  REQUIRE(ops[0]->pardeg() == 2);
+  REQUIRE(ops[1]->pardeg() == 2);
+  REQUIRE(ops[2]->pardeg() == 2);
+  REQUIRE(ops[3]->pardeg() == 1);
+  for (auto op : reduce_ops) REQUIRE(op->pardeg() == 1);
+}
+
+TEST_CASE("parallelism plan trailing stateless operator",
+          "parallelism plan tag") {
+  /* an open pipe (e.g., run by a Session) ending with a map */
+  auto p = pico::Pipe()
+               .add(pico::ReduceByKey<KV>(
+                   [](int v1, int v2) { return v1 + v2; }))
+               .add(pico::Map<KV, std::string>(
+                   [](KV& kv) { return kv.to_string(); }));
+  auto& s = p.children();
+  REQUIRE(s.size() == 2);
+
+  /* the map is a run by itself, that is fused (i.e., sequential) if small */
+  pico::base_UnaryOperator* source;
+  std::vector<pico::base_UnaryOperator*> run;
+  REQUIRE(pico::match_fused(s.end() - 1, s.end(), pico::StructureType::STREAM,
+                            source, run) == 1);
+  REQUIRE(!source);
+  REQUIRE(run.size() == 1);
+}
+
+TEST_CASE("parallelism plan small job run", "parallelism plan tag") {
+  std::string input_file = "./testdata/pairs.txt";
+  std::string output_file = "output.txt";
+
+  /* a fused chain with a reduce, run by a single sequential node */
+  auto p = pico::Pipe()
+               .add(pico::ReadFromFile(input_file))
+               .add(pico::Map<std::string, KV>(
+                   [](std::string line) { return KV::from_string(line); }))
+               .add(pico::Map<KV, KV>(
+                   [](KV& in) { return KV(in.Key(), in.Value() * 10); }))
+               .add(pico::ReduceByKey<KV>(
+                   [](int v1, int v2) { return v1 + v2; }))
+               .add(pico::WriteToDisk<KV>(
+                   output_file, [](KV in) { return in.to_string(); }));
+  p.small_job();
+  p.run();
+
+  std::unordered_map<char, int> expected;
+  for (auto& line : read_lines(input_file)) {
+    auto kv = KV::from_string(line);
+    expected[kv.Key()] += kv.Value() * 10;
+  }
+  std::unordered_map<char, int> observed;
+  for (auto& line : read_lines(output_file)) {
+    auto kv = KV::from_string(line);
+    observed[kv.Key()] = kv.Value();
+  }
+
+  REQUIRE(expected == observed);
+}
+
+TEST_CASE("parallelism plan calibration", "parallelism plan tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToDisk<std::string> writer(output_file);
+
+  auto p = pico::Pipe()
+               .add(reader)
+               .add(pico::FlatMap<std::string, std::string>(duplicate))
+               .add(writer);
+
+  /* measure, then run by the measured costs */
+  p.calibrate();
+  p.run();
+
+  auto observed = read_lines(output_file);
+  std::sort(observed.begin(), observed.end());
+
+  std::vector<std::string> expected;
+  for (auto& line : read_lines(input_file)) {
+    expected.push_back(line);
+    expected.push_back(line);
+  }
+  std::sort(expected.begin(), expected.end());
+
+  REQUIRE(expected == observed);
+}
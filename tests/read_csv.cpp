@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+/* writes a CSV file with quoted fields, returns the expected records */
+static std::vector<std::string> write_csv(std::string fname) {
+  std::vector<std::string> expected;
+  std::ofstream out(fname);
+  out << "name,id,price,flag\n";
+  for (int i = 0; i < 1000; ++i) {
+    std::string name = "item" + std::to_string(i);
+    if (i % 3 == 0) {
+      /* quoted, with delimiters and escaped quotes */
+      name = "it,\"em\"" + std::to_string(i);
+      out << "\"it,\"\"em\"\"" << i << "\"";
+    } else
+      out << name;
+    out << "," << i << "," << i << ".5," << (i % 2 ? "true" : "0");
+    out << (i % 5 ? "\n" : "\r\n");
+    expected.push_back(name + " " + std::to_string(i));
+  }
+  out << "bad,line\n";
+  std::sort(expected.begin(), expected.end());
+  return expected;
+}
+
+TEST_CASE("read csv", "read csv tag") {
+  std::string input_file = "input.csv";
+  std::string output_file = "output.txt";
+  auto expected = write_csv(input_file);
+
+  typedef std::tuple<std::string, int, double, bool> record_t;
+  auto reader = pico::ReadCSV<std::string, int, double, bool>(input_file)
+                    .skip_header();
+  auto test_pipe =
+      pico::Pipe()
+          .add(reader)
+          .add(pico::Map<record_t, std::string>([](record_t r) {
+            /* check the numeric fields against the id */
+            int id = std::get<1>(r);
+            bool good = std::get<2>(r) == id + 0.5 && std::get<3>(r) == id % 2;
+            return std::get<0>(r) + " " + (good ? std::to_string(id) : "?");
+          }))
+          .add(pico::WriteToDisk<std::string>(output_file));
+
+  test_pipe.run();
+
+  auto observed = read_lines(output_file);
+  std::sort(observed.begin(), observed.end());
+
+  REQUIRE(expected == observed);
+}
+
+TEST_CASE("read csv columns", "read csv columns tag") {
+  std::string input_file = "input.csv";
+  std::string output_file = "output.txt";
+  auto expected = write_csv(input_file);
+
+  /* project the id and name columns, in reverse order */
+  typedef std::tuple<int, std::string> record_t;
+  auto reader = pico::ReadCSV<int, std::string>(input_file)
+                    .skip_header()
+                    .columns({1, 0});
+  auto test_pipe =
+      pico::Pipe()
+          .add(reader)
+          .add(pico::Map<record_t, std::string>([](record_t r) {
+            return std::get<1>(r) + " " + std::to_string(std::get<0>(r));
+          }))
+          .add(pico::WriteToDisk<std::string>(output_file));
+
+  test_pipe.run();
+
+  auto observed = read_lines(output_file);
+  std::sort(observed.begin(), observed.end());
+
+  REQUIRE(expected == observed);
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+/*
+ * connects to a local port (retrying until the listener is up) and sends
+ * the given lines
+ */
+static void send_lines(int port, std::vector<std::string> lines) {
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  int fd;
+  while (true) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr))) break;
+    close(fd);
+    usleep(10000);
+  }
+  std::string data;
+  for (auto &line : lines) data += line + "\n";
+  for (size_t sent = 0; sent < data.size();) {
+    auto n = write(fd, data.data() + sent, data.size() - sent);
+    assert(n > 0);
+    sent += n;
+  }
+  close(fd);
+}
+
+/* a socket listening on an ephemeral local port */
+static int listen_local(int &port) {
+  struct sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  REQUIRE(!bind(fd, (struct sockaddr *)&addr, sizeof(addr)));
+  REQUIRE(!listen(fd, 1));
+  getsockname(fd, (struct sockaddr *)&addr, &len);
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+/* serves raw bytes to the first connection accepted on fd */
+static void serve_data(int fd, std::string data) {
+  int conn = accept(fd, NULL, NULL);
+  assert(conn >= 0);
+  for (size_t sent = 0; sent < data.size();) {
+    auto n = write(conn, data.data() + sent, data.size() - sent);
+    assert(n > 0);
+    sent += n;
+  }
+  close(conn);
+  close(fd);
+}
+
+/* serves the given lines to the first connection accepted on fd */
+static void serve_lines(int fd, std::vector<std::string> lines) {
+  std::string data;
+  for (auto &line : lines) data += line + "\n";
+  serve_data(fd, data);
+}
+
+/* reads a stream from a local server, returns the items in order */
+static std::vector<std::string> read_socket(std::string data,
+                                            size_t read_size) {
+  std::string output_file = "output.txt";
+  int port, fd = listen_local(port);
+  std::thread server(serve_data, fd, data);
+
+  /* redirect stdout to output file */
+  auto coutbuf = std::cout.rdbuf();  // save old buf
+  std::ofstream out(output_file);
+  std::cout.rdbuf(out.rdbuf());  // redirect
+
+  pico::ReadFromSocket reader("localhost", port, '\n', read_size);
+  pico::WriteToStdOut<std::string> writer;
+  pico::Pipe().add(reader).add(writer).run();
+
+  /* undo stdout redirection */
+  std::cout.rdbuf(coutbuf);
+  out.close();
+  server.join();
+
+  return read_lines(output_file);
+}
+
+TEST_CASE("read from sockets", "read from sockets tag") {
+  /*
+   * - producers emulated by threads, each streaming a slice of a file to the
+   *   listening port
+   * - output inspected by redirecting stdout to a file
+   */
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+  constexpr unsigned connections = 4;
+
+  /* listen on an ephemeral port, known once the pipeline is running */
+  pico::ReadFromSockets reader(0, connections, '\n', 2);
+
+  auto input_lines = read_lines(input_file);
+  std::vector<std::thread> producers;
+  for (unsigned i = 0; i < connections; ++i) {
+    std::vector<std::string> slice;
+    for (size_t j = i; j < input_lines.size(); j += connections)
+      slice.push_back(input_lines[j]);
+    producers.emplace_back([&reader, slice]() {
+      int port;
+      while (!(port = reader.bound_port())) usleep(1000);
+      send_lines(port, slice);
+    });
+  }
+
+  /* redirect stdout to output file */
+  auto coutbuf = std::cout.rdbuf();  // save old buf
+  std::ofstream out(output_file);
+  std::cout.rdbuf(out.rdbuf());  // redirect
+
+  /* build the pipeline */
+  pico::WriteToStdOut<std::string> writer;
+
+  auto test_pipe = pico::Pipe().add(reader.per_connection()).add(writer);
+
+  /* execute the pipeline */
+  test_pipe.run();
+
+  /* undo stdout redirection */
+  std::cout.rdbuf(coutbuf);
+  out.close();
+  for (auto &p : producers) p.join();
+
+  /* forget the order and compare */
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+
+TEST_CASE("read from sockets connect mode", "read from sockets tag") {
+  /*
+   * - servers emulated by threads, each streaming a slice of a file to the
+   *   connection accepted on an ephemeral port
+   * - output inspected by redirecting stdout to a file
+   */
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+  constexpr unsigned connections = 4;
+
+  auto input_lines = read_lines(input_file);
+  std::vector<std::pair<std::string, int>> endpoints;
+  std::vector<std::thread> servers;
+  for (unsigned i = 0; i < connections; ++i) {
+    std::vector<std::string> slice;
+    for (size_t j = i; j < input_lines.size(); j += connections)
+      slice.push_back(input_lines[j]);
+    int port, fd = listen_local(port);
+    endpoints.emplace_back("localhost", port);
+    servers.emplace_back(serve_lines, fd, slice);
+  }
+
+  /* redirect stdout to output file */
+  auto coutbuf = std::cout.rdbuf();  // save old buf
+  std::ofstream out(output_file);
+  std::cout.rdbuf(out.rdbuf());  // redirect
+
+  /* build and execute the pipeline */
+  pico::ReadFromSockets reader(endpoints, '\n', 2);
+  pico::WriteToStdOut<std::string> writer;
+  pico::Pipe().add(reader).add(writer).run();
+
+  /* undo stdout redirection */
+  std::cout.rdbuf(coutbuf);
+  out.close();
+  for (auto &s : servers) s.join();
+
+  /* forget the order and compare */
+  auto output_lines = read_lines(output_file);
+  std::sort(input_lines.begin(), input_lines.end());
+  std::sort(output_lines.begin(), output_lines.end());
+
+  REQUIRE(input_lines == output_lines);
+}
+
+TEST_CASE("read from socket", "read from socket tag") {
+  std::vector<std::string> items;
+  for (unsigned i = 0; i < 100; ++i)
+    items.push_back(std::string(i % 40 + 1, 'a' + i % 26));
+  std::string data;
+  for (auto &item : items) data += item + "\n";
+
+  SECTION("items larger than the read size, split across reads") {
+    /* most items span several 16-byte reads */
+    REQUIRE(read_socket(data, 16) == items);
+  }
+
+  SECTION("items larger than the default read size") {
+    std::string large(3 * SOCKET_READ_SIZE + 1, 'x');
+    items.push_back(large);
+    items.push_back("after");
+    data += large + "\nafter\n";
+    REQUIRE(read_socket(data, SOCKET_READ_SIZE) == items);
+  }
+
+  SECTION("unterminated trailing item") {
+    /* the last item is emitted at the end of the stream */
+    items.push_back("tail");
+    REQUIRE(read_socket(data + "tail", 16) == items);
+  }
+}
@@ -18,6 +18,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <iostream>
 #include <string>
 
@@ -31,18 +34,17 @@ TEST_CASE("read from stdin and write", "read from stdin and write tag") {
   std::string input_file = "./testdata/lines.txt";
   std::string output_file = "output.txt";
 
-  /* redirect input file to stdin */
-  auto cinbuf = std::cin.rdbuf();  // save old buf
-  std::ifstream in(input_file);
-  std::cin.rdbuf(in.rdbuf());  // redirect
+  /* redirect input file to stdin (read at the file descriptor level) */
+  int stdin_fd = dup(STDIN_FILENO);
+  int in = open(input_file.c_str(), O_RDONLY);
+  dup2(in, STDIN_FILENO);
+  close(in);
 
   /* redirect stdout to output file */
   auto coutbuf = std::cout.rdbuf();  // save old buf
   std::ofstream out(output_file);
   std::cout.rdbuf(out.rdbuf());  // redirect
 
-  std::cin.tie(0);  // untie cin and cout
-
   /* define i/o operators from/to file */
   pico::ReadFromStdIn reader('\n');
   pico::WriteToStdOut<std::string> writer;
@@ -56,10 +58,9 @@ TEST_CASE("read from stdin and write", "read from stdin and write tag") {
 
   /* undo redirection */
   std::cout.rdbuf(coutbuf);
-  std::cin.rdbuf(cinbuf);
   out.close();
-  in.close();
-  std::cin.tie(&std::cout);  // tie again cin and cout
+  dup2(stdin_fd, STDIN_FILENO);
+  close(stdin_fd);
 
   /* forget the order and compare */
   auto input_lines = read_lines(input_file);
@@ -69,3 +70,32 @@ TEST_CASE("read from stdin and write", "read from stdin and write tag") {
 
   REQUIRE(input_lines == output_lines);
 }
+
+TEST_CASE("read from stdin in parallel, ordered",
+          "read from stdin in parallel, ordered tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string output_file = "output.txt";
+
+  int stdin_fd = dup(STDIN_FILENO);
+  int in = open(input_file.c_str(), O_RDONLY);
+  dup2(in, STDIN_FILENO);
+  close(in);
+
+  auto coutbuf = std::cout.rdbuf();
+  std::ofstream out(output_file);
+  std::cout.rdbuf(out.rdbuf());
+
+  /* split lines by parallel workers, preserving the input order */
+  auto io_file_pipe = pico::Pipe()
+                          .add(pico::ReadFromStdIn('\n', 4).ordered())
+                          .add(pico::WriteToStdOut<std::string>());
+
+  io_file_pipe.run();
+
+  std::cout.rdbuf(coutbuf);
+  out.close();
+  dup2(stdin_fd, STDIN_FILENO);
+  close(stdin_fd);
+
+  REQUIRE(read_lines(input_file) == read_lines(output_file));
+}
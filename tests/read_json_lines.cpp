@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+TEST_CASE("read json lines", "read json lines tag") {
+  std::string input_file = "input.json";
+  std::string output_file = "output.txt";
+
+  /* write records with nested, escaped and irrelevant fields */
+  std::vector<std::string> expected;
+  {
+    std::ofstream out(input_file);
+    for (int i = 0; i < 1000; ++i) {
+      out << "{\"id\": " << i << ", \"meta\": {\"a\": [1, {\"}\": \"]\"}]}, ";
+      out << "\"user\": {\"name\": \"u\\\"" << i << "\", \"score\": " << i;
+      out << ".5}, \"ok\": " << (i % 2 ? "true" : "false") << "}\n";
+      expected.push_back("u\"" + std::to_string(i) + " " + std::to_string(i));
+    }
+    out << "{\"id\": 1000}\n";  // missing fields
+  }
+  std::sort(expected.begin(), expected.end());
+
+  typedef std::tuple<std::string, int, double, bool> record_t;
+  pico::ReadJsonLines<std::string, int, double, bool> reader(
+      input_file, {"user.name", "id", "user.score", "ok"});
+  auto test_pipe =
+      pico::Pipe()
+          .add(reader)
+          .add(pico::Map<record_t, std::string>([](record_t r) {
+            /* check the other fields against the id */
+            int id = std::get<1>(r);
+            bool good = std::get<2>(r) == id + 0.5 && std::get<3>(r) == id % 2;
+            return std::get<0>(r) + " " + (good ? std::to_string(id) : "?");
+          }))
+          .add(pico::WriteToDisk<std::string>(output_file));
+
+  test_pipe.run();
+
+  auto observed = read_lines(output_file);
+  std::sort(observed.begin(), observed.end());
+
+  REQUIRE(expected == observed);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+/* replays a log into a file, returns the sorted lines */
+static std::vector<std::string> replay(pico::ReadFromLog reader) {
+  std::string output_file = "output.txt";
+  auto replay_pipe =
+      pico::Pipe().add(reader).add(pico::WriteToDisk<std::string>(output_file));
+  replay_pipe.run();
+
+  auto output_lines = read_lines(output_file);
+  std::sort(output_lines.begin(), output_lines.end());
+  return output_lines;
+}
+
+/* the records of a log from an offset on, read by scanning each partition */
+static std::vector<std::string> scan(std::string log, pico::log_offset_t off) {
+  std::vector<std::string> res;
+  for (unsigned p = 0; p < pico::log_partitions(log); ++p) {
+    pico::log_partition_reader reader(log, p);
+    reader.seek(0);
+    const char *rec;
+    uint32_t len;
+    for (pico::log_offset_t i = 0; reader.next(rec, len); ++i)
+      if (i >= off) res.emplace_back(rec, len);
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+TEST_CASE("write and replay log", "write and replay log tag") {
+  std::string input_file = "./testdata/lines.txt";
+  std::string log = "lines.log";
+  system(("rm -rf " + log).c_str());
+
+  /* small segments, to exercise segment rolling and index lookups */
+  auto to_log = pico::Pipe()
+                    .add(pico::ReadFromFile(input_file))
+                    .add(pico::WriteToLog(log, 4).segment_size(1 << 12));
+  to_log.run();
+
+  auto input_lines = read_lines(input_file);
+  std::sort(input_lines.begin(), input_lines.end());
+
+  SECTION("replay from the beginning") {
+    REQUIRE(replay(pico::ReadFromLog(log)) == input_lines);
+  }
+
+  SECTION("replay from an offset") {
+    REQUIRE(replay(pico::ReadFromLog(log).from_offset(0)) == input_lines);
+    REQUIRE(replay(pico::ReadFromLog(log).from_offset(1 << 30)).empty());
+
+    /* a mid-log offset, falling within a later segment */
+    auto suffix = scan(log, 150);
+    REQUIRE(!suffix.empty());
+    REQUIRE(suffix.size() < input_lines.size());
+    REQUIRE(replay(pico::ReadFromLog(log).from_offset(150)) == suffix);
+  }
+
+  SECTION("replay from committed offsets") {
+    pico::ReadFromLog reader = pico::ReadFromLog(log).from_committed("g");
+    REQUIRE(replay(reader) == input_lines);
+    REQUIRE(replay(reader).empty());
+
+    /* append again: only the new items are replayed */
+    to_log.run();
+    REQUIRE(replay(reader) == input_lines);
+  }
+
+  SECTION("append after a torn segment") {
+    /* a trailing incomplete record, as left by a crashed writer */
+    std::string dir = pico::log_partition_dir(log, 0);
+    auto segment = pico::log_segment_file(dir, pico::log_segments(dir).back(),
+                                          ".log");
+    FILE *f = fopen(segment.c_str(), "ab");
+    REQUIRE(f);
+    uint32_t len = 100;
+    fwrite(&len, sizeof(len), 1, f);
+    fwrite("torn", 1, 4, f);
+    fclose(f);
+
+    to_log.run();
+    auto twice = input_lines;
+    twice.insert(twice.end(), input_lines.begin(), input_lines.end());
+    std::sort(twice.begin(), twice.end());
+    REQUIRE(replay(pico::ReadFromLog(log)) == twice);
+  }
+}
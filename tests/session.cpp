@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+TEST_CASE("session", "session tag") {
+  auto p = pico::Pipe().add(pico::Map<std::string, std::string>(
+      [](std::string& s) { return s + "!"; }));
+
+  auto input = read_lines("./testdata/lines.txt");
+  std::vector<std::string> expected, observed;
+  for (auto& s : input) expected.push_back(s + "!");
+
+  /* push from a thread, while pulling the output */
+  pico::Session<std::string> session(p);
+  std::thread producer([&]() {
+    for (auto& s : input) session.push(s);
+    session.close();
+  });
+  std::string s;
+  while (session.pull(s)) observed.push_back(s);
+  producer.join();
+
+  /* stream structure preserves the pushing order */
+  REQUIRE(session.done());
+  REQUIRE(expected == observed);
+}
+
+TEST_CASE("session concurrent pulls", "session tag") {
+  auto p = pico::Pipe().add(pico::Map<std::string, std::string>(
+      [](std::string& s) { return s + "!"; }));
+
+  pico::Session<std::string> session(p);
+
+  /* a puller waiting for output does not block the others */
+  std::string x, y;
+  bool pulled = false;
+  std::thread puller([&]() { pulled = session.pull(x); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  REQUIRE(!session.try_pull(y));
+  REQUIRE(!session.done());
+
+  session.push("a");
+  session.flush();
+  puller.join();
+  REQUIRE(pulled);
+  REQUIRE(x == "a!");
+
+  session.close();
+  while (session.pull(y)) {
+  }
+  REQUIRE(session.done());
+}
+
+TEST_CASE("session dropped before the end", "session tag") {
+  auto p = pico::Pipe().add(pico::Map<std::string, std::string>(
+      [](std::string& s) { return s + "!"; }));
+
+  auto input = read_lines("./testdata/lines.txt");
+  input.resize(100);
+
+  /* neither closed nor fully pulled: the destructor drains the output */
+  pico::Session<std::string> session(p);
+  session.push(input);
+  session.flush();
+  std::string s;
+  REQUIRE(session.pull(s));
+  REQUIRE(s == input.front() + "!");
+}
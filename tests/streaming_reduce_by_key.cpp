@@ -18,7 +18,13 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <catch.hpp>
 
@@ -108,3 +114,61 @@ TEST_CASE("streaming reduce by key", "streaming reduce by key tag") {
 
   REQUIRE(expected == observed);
 }
+
+/* windowed sums per key, fed by an application with a varying rate */
+static std::unordered_map<char, std::vector<int>> windowed_sums(
+    pico::ReduceByKey<KV> reduce) {
+  auto input = read_lines("./testdata/pairs.txt");
+  auto p = pico::Pipe()
+               .add(pico::Map<std::string, KV>([](std::string line) {
+                 return KV::from_string(line);
+               }))
+               .add(reduce);
+
+  pico::Session<std::string, KV> session(p, pico::StructureType::STREAM);
+  std::thread producer([&]() {
+    /* idle, burst, then idle again */
+    size_t third = input.size() / 3;
+    for (size_t i = 0; i < input.size(); ++i) {
+      session.push(input[i]);
+      if (i < third || i >= 2 * third) {
+        session.flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    session.close();
+  });
+
+  std::unordered_map<char, std::vector<int>> res;
+  KV kv;
+  while (session.pull(kv)) res[kv.Key()].push_back(kv.Value());
+  producer.join();
+
+  /* windows of moved keys may be collected from different workers */
+  for (auto &r : res) std::sort(r.second.begin(), r.second.end());
+  return res;
+}
+
+TEST_CASE("streaming reduce by key elastic", "streaming reduce by key tag") {
+  constexpr unsigned wsize = 2;
+
+  /* a slow kernel, so that the burst backlogs the workers */
+  auto slow_sum = [](int v1, int v2) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    return v1 + v2;
+  };
+
+  /*
+   * With a short resize period, the farm shrinks while idle, grows upon the
+   * burst and shrinks again, moving key groups across the workers.
+   */
+  setenv("PICO_ELASTIC_PERIOD", "2", 1);
+  auto elastic = windowed_sums(
+      pico::ReduceByKey<KV>(slow_sum, 4).window(wsize).elastic());
+  unsetenv("PICO_ELASTIC_PERIOD");
+
+  auto fixed = windowed_sums(pico::ReduceByKey<KV>(slow_sum, 4).window(wsize));
+
+  REQUIRE(!fixed.empty());
+  REQUIRE(elastic == fixed);
+}
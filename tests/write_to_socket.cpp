@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2019 alpha group, CS department, University of Torino.
+ * 
+ * This file is part of pico 
+ * (see https://github.com/alpha-unito/pico).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "pico/pico.hpp"
+
+#include "common/io.hpp"
+
+/* a socket listening on an ephemeral local port */
+static int listen_local(int &port) {
+  struct sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  REQUIRE(!bind(fd, (struct sockaddr *)&addr, sizeof(addr)));
+  REQUIRE(!listen(fd, 1));
+  getsockname(fd, (struct sockaddr *)&addr, &len);
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+/*
+ * accepts a connection on fd and stores the received data, sleeping for
+ * delay_us after each read of at most read_size bytes
+ */
+static std::string receive(int fd, size_t read_size, unsigned delay_us) {
+  std::string received;
+  int conn = accept(fd, NULL, NULL);
+  assert(conn >= 0);
+  std::vector<char> buf(read_size);
+  ssize_t n;
+  while ((n = read(conn, buf.data(), buf.size())) > 0) {
+    received.append(buf.data(), n);
+    if (delay_us) usleep(delay_us);
+  }
+  close(conn);
+  close(fd);
+  return received;
+}
+
+/* the non-empty lines of a string, sorted */
+static std::vector<std::string> sorted_lines(const std::string &s) {
+  std::vector<std::string> res;
+  std::istringstream stream(s);
+  for (std::string line; std::getline(stream, line);)
+    if (!line.empty()) res.push_back(line);
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+TEST_CASE("write to socket", "write to socket tag") {
+  /*
+   * - the receiver is emulated by a thread, accepting a connection on an
+   *   ephemeral port and storing the received data
+   */
+  std::string input_file = "./testdata/lines.txt";
+  auto input_lines = read_lines(input_file);
+  std::sort(input_lines.begin(), input_lines.end());
+
+  /* listen before the pipeline connects */
+  int port, listen_fd = listen_local(port);
+
+  pico::ReadFromFile reader(input_file);
+  pico::WriteToSocket<std::string> writer("localhost", port);
+
+  SECTION("fast receiver") {
+    auto received = std::async(std::launch::async, receive, listen_fd, 4096, 0);
+
+    /* small buffers to exercise batching */
+    pico::Pipe().add(reader).add(writer.buffer_size(1024)).run();
+
+    /* forget the order and compare */
+    REQUIRE(input_lines == sorted_lines(received.get()));
+  }
+
+  SECTION("slow receiver") {
+    /*
+     * a receiver much slower than the pipeline: the pending buffers fill up
+     * (SOCKET_PENDING_BUFFERS) and the writer must block rather than drop
+     * or reorder data
+     */
+    auto received =
+        std::async(std::launch::async, receive, listen_fd, 256, 100);
+
+    pico::Pipe().add(reader).add(writer.buffer_size(64)).run();
+
+    REQUIRE(input_lines == sorted_lines(received.get()));
+  }
+}
+
+TEST_CASE("write to socket linger", "write to socket tag") {
+  /*
+   * - a single item is streamed to the pipeline from a local server, that
+   *   keeps the input open until the item is received at the other end (or a
+   *   timeout expires)
+   * - the item only partially fills the output buffer, so it can only be
+   *   received while the input is open if the writer flushes the buffer once
+   *   the linger time has expired (SOCKET_LINGER_MS)
+   */
+  int in_port, in_fd = listen_local(in_port);
+  int out_port, out_fd = listen_local(out_port);
+  std::promise<void> item_received;
+  bool flushed = false;
+
+  std::thread server([&]() {
+    int conn = accept(in_fd, NULL, NULL);
+    assert(conn >= 0);
+    std::string item("linger\n");
+    auto n = write(conn, item.data(), item.size());
+    assert(n == (ssize_t)item.size());
+    (void)n;
+    auto status =
+        item_received.get_future().wait_for(std::chrono::seconds(10));
+    flushed = status == std::future_status::ready;
+    close(conn);
+    close(in_fd);
+  });
+
+  std::string received;
+  std::thread receiver([&]() {
+    int conn = accept(out_fd, NULL, NULL);
+    assert(conn >= 0);
+    char buf[4096];
+    ssize_t n;
+    bool notified = false;
+    while ((n = read(conn, buf, sizeof(buf))) > 0) {
+      received.append(buf, n);
+      if (!notified && received.find('\n') != std::string::npos) {
+        item_received.set_value();
+        notified = true;
+      }
+    }
+    close(conn);
+    close(out_fd);
+  });
+
+  /* a single-item micro-batch reaches the writer as soon as it is read */
+  auto mb_size = pico::global_params.MICROBATCH_SIZE;
+  pico::global_params.MICROBATCH_SIZE = 1;
+
+  pico::ReadFromSocket reader("localhost", in_port, '\n');
+  pico::WriteToSocket<std::string> writer("localhost", out_port);
+  pico::Pipe().add(reader).add(writer.linger(SOCKET_LINGER_MS)).run();
+
+  pico::global_params.MICROBATCH_SIZE = mb_size;
+  server.join();
+  receiver.join();
+
+  REQUIRE(flushed);
+  REQUIRE(received == "linger\n");
+}